@@ -0,0 +1,128 @@
+#include "archivelayout.h"
+
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QSet>
+
+#include "checksumindex.h"
+#include "imagevalidator.h"
+#include "ingestpipeline.h"
+#include "metadataindex.h"
+
+namespace archivelayout {
+
+QString toString(ArchiveLayout layout) {
+  switch (layout) {
+    case ArchiveLayout::Date:
+      return "Date";
+    case ArchiveLayout::HashPrefix:
+      return "HashPrefix";
+    case ArchiveLayout::Flat:
+    default:
+      return "Flat";
+  }
+}
+
+ArchiveLayout fromString(const QString &str) {
+  if (str == "Date") return ArchiveLayout::Date;
+  if (str == "HashPrefix") return ArchiveLayout::HashPrefix;
+  return ArchiveLayout::Flat;
+}
+
+QString relativePath(ArchiveLayout layout, const QString &fileName, const QByteArray &checksum,
+                     const QDateTime &time) {
+  switch (layout) {
+    case ArchiveLayout::Date:
+      return time.toString("yyyy/MM/dd/") + fileName;
+    case ArchiveLayout::HashPrefix: {
+      QByteArray hex = checksum.toHex();
+      if (hex.size() < 4) return fileName;
+      return QString::fromLatin1(hex.left(2)) + "/" + QString::fromLatin1(hex.mid(2, 2)) + "/" + fileName;
+    }
+    case ArchiveLayout::Flat:
+    default:
+      return fileName;
+  }
+}
+
+QDateTime timeFromFileName(const QString &fileName) {
+  return QDateTime::fromString(fileName.left(19), "yyyyMMdd_HHmmss_zzz");
+}
+
+void migrate(QPromise<MigrationResult> &promise, const QString &dirPath, ArchiveLayout layout) {
+  MigrationResult result;
+  QElapsedTimer timer;
+  timer.start();
+  QDir dir(dirPath);
+
+  QList<ChecksumIndex::Entry> entries = ChecksumIndex::readFile(dirPath);
+  MetadataIndex metadata;
+  metadata.load(dirPath);
+  QSet<QString> tracked;
+  for (const ChecksumIndex::Entry &entry : std::as_const(entries)) {
+    tracked.insert(entry.path);
+  }
+
+  // Images copied into the flat directory by hand are indexed on the way
+  const QStringList topLevel = dir.entryList(QDir::Files | QDir::NoDotAndDotDot);
+  for (const QString &name : topLevel) {
+    if (promise.isCanceled()) break;
+    if (name == ChecksumIndex::kFileName || tracked.contains(name)) continue;
+    ImageHeaderInfo header = imagevalidator::validateFile(dir.filePath(name));
+    if (!header.valid) continue;
+    QByteArray checksum = IngestPipeline::fileChecksum(dir.filePath(name));
+    if (checksum.isEmpty()) continue;
+    QFileInfo fi(dir.filePath(name));
+    entries.append({name, checksum, fi.size(), fi.lastModified().toSecsSinceEpoch()});
+    // Copied in by hand, so there is no source to record; the archive path is not one
+    metadata.append({name, header.size.width(), header.size.height(), header.format, fi.size(), QString(),
+                     QByteArray(), fi.lastModified().toMSecsSinceEpoch()});
+    result.indexed++;
+  }
+
+  promise.setProgressRange(0, entries.size());
+  QSet<QString> vacatedDirs;
+  for (int i = 0; i < entries.size(); ++i) {
+    if (promise.isCanceled()) break;
+
+    ChecksumIndex::Entry &entry = entries[i];
+    QString source = dir.filePath(entry.path);
+    QFileInfo fi(source);
+    // Stale entries are left for "Clean Checksums"
+    if (fi.isFile()) {
+      QDateTime time = timeFromFileName(fi.fileName());
+      if (!time.isValid()) time = fi.lastModified();
+      QString target = relativePath(layout, fi.fileName(), entry.checksum, time);
+      if (target != entry.path) {
+        QString destination = dir.filePath(target);
+        dir.mkpath(QFileInfo(target).path());
+        if (!QFile::exists(destination) && QFile::rename(source, destination)) {
+          QString parent = QFileInfo(entry.path).path();
+          if (parent != ".") vacatedDirs.insert(parent);
+          metadata.rename(entry.path, target);
+          entry.path = target;
+          result.moved++;
+        } else {
+          result.failed++;
+        }
+      }
+    }
+    promise.setProgressValue(i + 1);
+  }
+
+  // Partial migrations still record where the moved files went
+  ChecksumIndex::writeFile(dirPath, entries, &result.error);
+  metadata.compact();
+
+  // rmpath() only removes empty directories, so shared shards survive
+  for (const QString &parent : std::as_const(vacatedDirs)) {
+    dir.rmpath(parent);
+  }
+
+  result.elapsedMs = timer.elapsed();
+  promise.addResult(result);
+}
+
+}  // namespace archivelayout
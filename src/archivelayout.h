@@ -0,0 +1,38 @@
+#pragma once
+
+#include <QByteArray>
+#include <QDateTime>
+#include <QPromise>
+#include <QString>
+
+// How auto-saved files are distributed below the target directory.
+enum class ArchiveLayout { Flat, Date, HashPrefix };
+
+namespace archivelayout {
+
+QString toString(ArchiveLayout layout);
+ArchiveLayout fromString(const QString &str);
+
+// Relative path ('/'-separated) of `fileName` under the target directory:
+//   Flat:       <fileName>
+//   Date:       yyyy/MM/dd/<fileName>
+//   HashPrefix: <hex[0:2]>/<hex[2:4]>/<fileName>
+QString relativePath(ArchiveLayout layout, const QString &fileName, const QByteArray &checksum,
+                     const QDateTime &time);
+
+// Recovers the save time from the "yyyyMMdd_HHmmss_zzz_" prefix of an auto-saved file name.
+QDateTime timeFromFileName(const QString &fileName);
+
+struct MigrationResult {
+  int moved = 0;
+  int failed = 0;
+  int indexed = 0;
+  qint64 elapsedMs = 0;
+  QString error;
+};
+
+// Moves every indexed file (and untracked images at the top level) of `dir` to the
+// place `layout` expects and rewrites checksums.txt. Meant for QtConcurrent::run.
+void migrate(QPromise<MigrationResult> &promise, const QString &dir, ArchiveLayout layout);
+
+}  // namespace archivelayout
@@ -0,0 +1,101 @@
+#include "archivequota.h"
+
+#include <QDateTime>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <algorithm>
+
+#include "archivelayout.h"
+
+namespace archivequota {
+
+QString toString(EvictionPolicy policy) {
+  switch (policy) {
+    case EvictionPolicy::LeastRecentlyUsed:
+      return "LeastRecentlyUsed";
+    case EvictionPolicy::Oldest:
+    default:
+      return "Oldest";
+  }
+}
+
+EvictionPolicy fromString(const QString &str) {
+  if (str == "LeastRecentlyUsed") return EvictionPolicy::LeastRecentlyUsed;
+  return EvictionPolicy::Oldest;
+}
+
+void evict(QPromise<EvictionResult> &promise, const QString &dirPath, const QList<ChecksumIndex::Entry> &entries,
+           const Quota &quota, EvictionPolicy policy) {
+  EvictionResult result;
+  QElapsedTimer timer;
+  timer.start();
+  QDir dir(dirPath);
+
+  // Content shared by several names (blob store) only frees space with its last name
+  QHash<QByteArray, int> refCount;
+  QHash<QByteArray, qint64> sizeByChecksum;
+  qint64 bytes = 0;
+  struct Candidate {
+    qint64 key;
+    const ChecksumIndex::Entry *entry;
+  };
+  QList<Candidate> candidates;
+  candidates.reserve(entries.size());
+  for (const ChecksumIndex::Entry &entry : entries) {
+    if (refCount[entry.checksum]++ == 0) {
+      qint64 size = entry.size >= 0 ? entry.size : QFileInfo(dir.filePath(entry.path)).size();
+      sizeByChecksum.insert(entry.checksum, size);
+      bytes += size;
+    }
+    qint64 key = entry.savedAt;
+    if (key <= 0) {
+      // Indexed before save times were recorded: the name carries it, else the file does
+      QDateTime named = archivelayout::timeFromFileName(QFileInfo(entry.path).fileName());
+      key = named.isValid() ? named.toSecsSinceEpoch()
+                            : QFileInfo(dir.filePath(entry.path)).lastModified().toSecsSinceEpoch();
+    }
+    if (policy == EvictionPolicy::LeastRecentlyUsed) {
+      // Approximate with relatime/noatime mounts, but never earlier than the save itself
+      QDateTime lastRead = QFileInfo(dir.filePath(entry.path)).lastRead();
+      if (lastRead.isValid()) key = qMax(key, lastRead.toSecsSinceEpoch());
+    }
+    candidates.append({key, &entry});
+  }
+  std::stable_sort(candidates.begin(), candidates.end(),
+                   [](const Candidate &a, const Candidate &b) { return a.key < b.key; });
+
+  qint64 bytesTarget = quota.maxBytes > 0 ? quota.maxBytes / 10 * 9 : 0;
+  // At least one file stays, or small quotas could never be met
+  int filesTarget = quota.maxFiles > 0 ? qMax(1, int(qint64(quota.maxFiles) * 9 / 10)) : 0;
+  int files = entries.size();
+  auto overTarget = [&]() {
+    return (bytesTarget > 0 && bytes > bytesTarget) || (filesTarget > 0 && files > filesTarget);
+  };
+
+  for (const Candidate &candidate : std::as_const(candidates)) {
+    if (!overTarget() || promise.isCanceled()) break;
+    const ChecksumIndex::Entry &entry = *candidate.entry;
+    QString path = dir.filePath(entry.path);
+    if (!QFile::remove(path) && QFile::exists(path)) {
+      result.failed++;
+      continue;
+    }
+    result.removed.append(entry.path);
+    QString parent = QFileInfo(entry.path).path();
+    if (parent != ".") dir.rmpath(parent);
+    files--;
+    if (--refCount[entry.checksum] == 0) {
+      qint64 size = sizeByChecksum.value(entry.checksum);
+      bytes -= size;
+      result.freedBytes += size;
+    }
+  }
+
+  result.elapsedMs = timer.elapsed();
+  promise.addResult(result);
+}
+
+}  // namespace archivequota
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <QList>
+#include <QPromise>
+#include <QString>
+#include <QStringList>
+
+#include "checksumindex.h"
+
+// Which files go first when the auto-save directory is over its quota.
+enum class EvictionPolicy { Oldest, LeastRecentlyUsed };
+
+namespace archivequota {
+
+QString toString(EvictionPolicy policy);
+EvictionPolicy fromString(const QString &str);
+
+// Zero means unlimited
+struct Quota {
+  qint64 maxBytes = 0;
+  int maxFiles = 0;
+
+  bool isEnabled() const { return maxBytes > 0 || maxFiles > 0; }
+  bool isExceeded(qint64 bytes, int files) const {
+    return (maxBytes > 0 && bytes > maxBytes) || (maxFiles > 0 && files > maxFiles);
+  }
+};
+
+struct EvictionResult {
+  QStringList removed;
+  qint64 freedBytes = 0;
+  int failed = 0;
+  qint64 elapsedMs = 0;
+};
+
+// Deletes files of `dir` in `policy` order until usage is back to 90% of `quota`, so that
+// the next few saves do not trigger another eviction. `entries` is a snapshot of the
+// index. Meant for QtConcurrent::run.
+void evict(QPromise<EvictionResult> &promise, const QString &dir, const QList<ChecksumIndex::Entry> &entries,
+           const Quota &quota, EvictionPolicy policy);
+
+}  // namespace archivequota
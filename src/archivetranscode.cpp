@@ -0,0 +1,233 @@
+#include "archivetranscode.h"
+
+#include <QAtomicInt>
+#include <QDebug>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QImageReader>
+#include <QImageWriter>
+#include <QPainter>
+#include <QSemaphore>
+#include <QSet>
+#include <QThread>
+#include <QThreadPool>
+#include <QtConcurrent>
+#include <climits>
+
+#include "checksumindex.h"
+#include "ingestpipeline.h"
+
+namespace archivetranscode {
+
+namespace {
+
+const QString kStagingDirName = ".transcode";
+// The memory budget is handed out in units of this size
+const qint64 kBudgetUnit = 1024 * 1024;
+
+struct Job {
+  ImageMetadata source;
+  QString targetPath;  // relative
+  QString stagedPath;  // absolute, inside the staging directory
+  ImageMetadata staged;
+  QByteArray checksum;
+  bool ok = false;
+  QString error;
+};
+
+bool supportsAlpha(const QByteArray &format) { return format != "jpeg" && format != "jpg" && format != "bmp"; }
+
+void encode(const QDir &dir, const Options &options, Job &job) {
+  QImageReader reader(dir.filePath(job.source.path));
+  // Orientation lives in EXIF, which the new file will not carry
+  reader.setAutoTransform(true);
+  QImage image = reader.read();
+  if (image.isNull()) {
+    job.error = reader.errorString();
+    return;
+  }
+  if (image.hasAlphaChannel() && !supportsAlpha(options.format)) {
+    QImage flat(image.size(), QImage::Format_RGB32);
+    flat.fill(Qt::white);
+    QPainter painter(&flat);
+    painter.drawImage(0, 0, image);
+    painter.end();
+    image = flat;
+  }
+
+  QImageWriter writer(job.stagedPath, options.format);
+  writer.setQuality(options.quality);
+  if (!writer.write(image)) {
+    job.error = writer.errorString();
+    return;
+  }
+
+  job.checksum = IngestPipeline::fileChecksum(job.stagedPath);
+  if (job.checksum.isEmpty()) {
+    job.error = "Failed to calculate checksum";
+    return;
+  }
+  job.staged = job.source;
+  job.staged.path = job.targetPath;
+  job.staged.width = image.width();
+  job.staged.height = image.height();
+  job.staged.format = options.format;
+  job.staged.size = QFileInfo(job.stagedPath).size();
+  job.staged.pixelHash.clear();
+  job.ok = true;
+}
+
+}  // namespace
+
+QString suffixFor(const QByteArray &format) {
+  QByteArray lower = format.toLower();
+  if (lower == "jpeg") return "jpg";
+  if (lower == "tiff") return "tif";
+  return QString::fromLatin1(lower);
+}
+
+void transcode(QPromise<Result> &promise, const QString &dirPath, const QList<ImageMetadata> &candidates,
+               const Options &options) {
+  Result result;
+  QElapsedTimer timer;
+  timer.start();
+  QDir dir(dirPath);
+  QDir staging(dir.filePath(kStagingDirName));
+
+  // Leftovers of an interrupted batch never made it into the index
+  staging.removeRecursively();
+  if (!dir.mkpath(kStagingDirName)) {
+    result.error = "Failed to create " + staging.path();
+    promise.addResult(result);
+    return;
+  }
+
+  QString suffix = suffixFor(options.format);
+  QList<Job> jobs;
+  jobs.reserve(candidates.size());
+  QSet<QString> taken;
+  for (const ImageMetadata &candidate : candidates) {
+    QFileInfo fi(candidate.path);
+    QString base = fi.path() == "." ? fi.completeBaseName() : fi.path() + "/" + fi.completeBaseName();
+    QString target = base + "." + suffix;
+    for (int n = 1; taken.contains(target) || QFile::exists(dir.filePath(target)); ++n) {
+      target = QString("%1_%2.%3").arg(base).arg(n).arg(suffix);
+    }
+    taken.insert(target);
+
+    Job job;
+    job.source = candidate;
+    job.targetPath = target;
+    job.stagedPath = staging.filePath(QString("%1.%2").arg(jobs.size()).arg(suffix));
+    jobs.append(job);
+  }
+
+  // Every core encodes, but only as many images as fit the budget are decoded at once
+  const int budgetUnits = int(qBound<qint64>(1, options.memoryBudget / kBudgetUnit, INT_MAX));
+  QSemaphore budget(budgetUnits);
+  QThreadPool pool;
+  pool.setMaxThreadCount(QThread::idealThreadCount());
+  QAtomicInt done;
+  promise.setProgressRange(0, jobs.size());
+  auto canceled = [&]() { return promise.isCanceled() || (options.cancel && *options.cancel); };
+  QtConcurrent::blockingMap(&pool, jobs, [&](Job &job) {
+    if (canceled()) return;
+    // Decoded source plus the converted copy an encoder may make
+    qint64 pixels = qint64(job.source.width) * job.source.height;
+    qint64 bytes = pixels > 0 ? pixels * 4 * 2 : job.source.size * 8;
+    int cost = int(qBound<qint64>(1, (bytes + kBudgetUnit - 1) / kBudgetUnit, budgetUnits));
+    budget.acquire(cost);
+    encode(dir, options, job);
+    budget.release(cost);
+    promise.setProgressValue(++done);
+  });
+
+  auto abort = [&](const QString &error) {
+    staging.removeRecursively();
+    result.error = error;
+    result.elapsedMs = timer.elapsed();
+    promise.addResult(result);
+  };
+  if (canceled()) {
+    result.canceled = true;
+    abort("Canceled");
+    return;
+  }
+
+  // Commit: nothing below deletes an original before checksums.txt points at its replacement
+  QString error;
+  QList<ChecksumIndex::Entry> entries = ChecksumIndex::readFile(dirPath, &error);
+  if (!error.isEmpty()) {
+    abort(error);
+    return;
+  }
+  QHash<QString, int> rowByPath;
+  for (int i = 0; i < entries.size(); ++i) {
+    rowByPath.insert(entries[i].path, i);
+  }
+
+  QList<const Job *> moved;
+  auto rollback = [&]() {
+    for (const Job *job : std::as_const(moved)) {
+      QFile::remove(dir.filePath(job->targetPath));
+    }
+  };
+  for (const Job &job : std::as_const(jobs)) {
+    if (!job.ok) {
+      result.failed++;
+      qDebug() << "Transcode failed:" << job.source.path << job.error;
+      continue;
+    }
+    // Removed from the index while the batch ran
+    if (!rowByPath.contains(job.source.path)) continue;
+    dir.mkpath(QFileInfo(job.targetPath).path());
+    if (!QFile::rename(job.stagedPath, dir.filePath(job.targetPath))) {
+      rollback();
+      abort("Failed to move " + job.targetPath + " into place");
+      return;
+    }
+    moved.append(&job);
+  }
+
+  QStringList replacedPaths;
+  QList<ImageMetadata> replacements;
+  for (const Job *job : std::as_const(moved)) {
+    ChecksumIndex::Entry &entry = entries[rowByPath.value(job->source.path)];
+    result.bytesBefore += entry.size >= 0 ? entry.size : job->source.size;
+    entry.path = job->targetPath;
+    // Dedup and the URL cache still know the content by the digest it was saved under
+    if (entry.originalChecksum.isEmpty()) entry.originalChecksum = entry.checksum;
+    entry.checksum = job->checksum;
+    entry.size = job->staged.size;
+    result.bytesAfter += entry.size;
+    replacedPaths.append(job->source.path);
+    replacements.append(job->staged);
+  }
+  if (!ChecksumIndex::writeFile(dirPath, entries, &error)) {
+    rollback();
+    abort(error);
+    return;
+  }
+
+  // The sidecar is derived data: if this fails, loading drops and backfills rows
+  MetadataIndex metadata;
+  metadata.load(dirPath);
+  metadata.remove(replacedPaths);
+  metadata.append(replacements);
+  metadata.compact();
+
+  for (const QString &path : std::as_const(replacedPaths)) {
+    QFile::remove(dir.filePath(path));
+  }
+  staging.removeRecursively();
+
+  result.transcoded = moved.size();
+  result.committed = true;
+  result.elapsedMs = timer.elapsed();
+  promise.addResult(result);
+}
+
+}  // namespace archivetranscode
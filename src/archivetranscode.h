@@ -0,0 +1,48 @@
+#pragma once
+
+#include <QByteArray>
+#include <QList>
+#include <QPromise>
+#include <QString>
+#include <atomic>
+#include <memory>
+
+#include "metadataindex.h"
+
+namespace archivetranscode {
+
+struct Options {
+  QByteArray format = "jpeg";  // QImageWriter format name
+  int quality = 85;
+  // Decoded pixels allowed in flight across all workers
+  qint64 memoryBudget = 512LL * 1024 * 1024;
+  // Set from any thread to stop the batch. Unlike canceling the future this keeps the
+  // Result, and it is not looked at any more once originals are being replaced.
+  std::shared_ptr<std::atomic_bool> cancel;
+};
+
+struct Result {
+  int transcoded = 0;
+  int failed = 0;
+  qint64 bytesBefore = 0;
+  qint64 bytesAfter = 0;
+  bool committed = false;
+  bool canceled = false;
+  qint64 elapsedMs = 0;
+  QString error;
+};
+
+// File suffix written for a QImageWriter format ("jpeg" -> "jpg")
+QString suffixFor(const QByteArray &format);
+
+// Re-encodes `candidates` (rows of the metadata sidecar, so dimensions are known before
+// decoding) of `dir` into `options.format` on a pool of all cores. New files are staged
+// in .transcode/ and nothing replaces an original until every file has been encoded.
+// Files that failed to encode keep their original and are counted in Result::failed; the
+// rest are moved into place, checksums.txt and the metadata sidecar are rewritten, and
+// only after that are their originals deleted. Canceling, or a failure to move a file or
+// to write checksums.txt, leaves the archive as it was. Meant for QtConcurrent::run.
+void transcode(QPromise<Result> &promise, const QString &dir, const QList<ImageMetadata> &candidates,
+               const Options &options);
+
+}  // namespace archivetranscode
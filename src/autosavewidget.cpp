@@ -12,15 +12,20 @@
 #include <QDebug>
 #include <QDesktopServices>  // Added
 #include <QDir>
+#include <QDirIterator>
 #include <QElapsedTimer>
 #include <QFile>
 #include <QFileDialog>
 #include <QFileInfo>
+#include <QFutureWatcher>
 #include <QHBoxLayout>
 #include <QImageReader>
+#include <QImageWriter>
 #include <QLabel>
 #include <QLineEdit>
 #include <QListView>
+#include <QMenu>
+#include <QMimeData>
 #include <QPainter>
 #include <QPointer>
 #include <QProgressBar>
@@ -30,16 +35,33 @@
 #include <QSpinBox>
 #include <QStandardPaths>
 #include <QStyle>
+#include <QTabWidget>
 #include <QTemporaryFile>
+#include <QTimer>
 #include <QUrl>
 #include <QVBoxLayout>
+#include <QtConcurrent>
 
+#include "archivelayout.h"
+#include "archivequota.h"
+#include "archivetranscode.h"
+#include "blobstore.h"
+#include "checksumindex.h"
 #include "clipboardmanager.h"
+#include "contentindex.h"
+#include "directorywatcher.h"
 #include "downloadprogressmodel.h"
 #include "downloadqueue.h"
+#include "gallerymodel.h"
+#include "imagevalidator.h"
+#include "ingestpipeline.h"
+#include "netstats.h"
 #include "notificationmanager.h"
+#include "scrubber.h"
 #include "settingsmanager.h"
+#include "thumbnailcache.h"
 #include "utils.h"
+#include "watchfoldersource.h"
 
 // Delegate for rendering download items
 class DownloadProgressDelegate : public QAbstractItemDelegate {
@@ -61,8 +83,8 @@ class DownloadProgressDelegate : public QAbstractItemDelegate {
     QRect r = option.rect;
     r.adjust(5, 5, -5, -5);
 
-    QString url = index.data(DownloadProgressModel::UrlRole).toUrl().fileName();
-    if (url.isEmpty()) url = index.data(DownloadProgressModel::UrlRole).toUrl().toString();
+    // File name, else the full URL; the folded summary row has only this
+    QString url = index.data(Qt::DisplayRole).toString();
 
     int progress = index.data(DownloadProgressModel::ProgressRole).toInt();
     QString status = index.data(DownloadProgressModel::StatusRole).toString();
@@ -121,15 +143,80 @@ class DownloadProgressDelegate : public QAbstractItemDelegate {
   }
 };
 
-static const QString kChecksumFileName = "checksums.txt";
 static const QString kClearRecentPaths = "<Clear Recent Paths>";
+static const int kScrubPassIntervalDays = 7;
+// Older finished downloads are folded into one summary row
+static const int kMaxFinishedDownloadRows = 500;
 
 AutoSaveWidget::AutoSaveWidget(ClipboardManager* manager, QWidget* parent) : QWidget(parent), m_manager(manager) {
   m_downloadModel = new DownloadProgressModel(this);
+  m_downloadModel->setFinishedLimit(kMaxFinishedDownloadRows);
+  m_thumbnails = new ThumbnailCache(this);
+  m_galleryModel = new GalleryModel(m_thumbnails, this);
   m_downloadQueue = new DownloadQueue(1, this);
+  // Pages and videos are dropped once their headers or first bytes give them away
+  m_downloadQueue->setContentSniffer([](const QByteArray& contentType, const QByteArray& head) {
+    std::optional<bool> image =
+        head.isEmpty() ? imagevalidator::isImageContentType(contentType) : imagevalidator::looksLikeImage(head);
+    if (!image.has_value()) return DownloadQueue::Verdict::NeedMoreData;
+    return *image ? DownloadQueue::Verdict::Accept : DownloadQueue::Verdict::Reject;
+  });
+  connect(m_downloadQueue, &DownloadQueue::foregroundTrafficChanged, this, [this](bool detected) {
+    m_manager->logAction(detected ? "Downloads paused while other traffic uses the network."
+                                  : "Network is quiet again; downloads continue.",
+                         EventCategory::AutoSaveImage, EventLevel::Info);
+  });
+  m_dirWatcher = new DirectoryWatcher(this);
+  connect(m_dirWatcher, &DirectoryWatcher::changed, this, &AutoSaveWidget::onDirectoryChanged);
+  connect(m_dirWatcher, &DirectoryWatcher::watchLimitReached, this, [this](int unwatchedDirs) {
+    m_manager->logAction(QString("The system refused to watch %1 folder(s) of %2 (inotify watch limit?); files "
+                                 "added there from outside are picked up within a minute instead.")
+                             .arg(unwatchedDirs)
+                             .arg(m_dirWatcher->root()),
+                         EventCategory::AutoSaveImage, EventLevel::Warning);
+  });
+  m_watchSource = new WatchFolderSource(this);
+  connect(m_watchSource, &WatchFolderSource::filesArrived, this, &AutoSaveWidget::onWatchedFilesArrived);
+  m_scrubber = new Scrubber(this);
+  connect(m_scrubber, &Scrubber::mismatch, this,
+          [this](const QString& dir, const QString& path, const QByteArray& expected, const QByteArray& actual) {
+            QString filePath = QDir(dir).filePath(path);
+            QString message = actual.isEmpty() ? QString("Scrub could not read %1").arg(filePath)
+                                               : QString("Checksum mismatch for %1: expected %2, got %3")
+                                                     .arg(filePath, QString::fromLatin1(expected.toHex()),
+                                                          QString::fromLatin1(actual.toHex()));
+            m_manager->logAction(message, EventCategory::AutoSaveImage, EventLevel::Error);
+          });
+  connect(m_scrubber, &Scrubber::finished, this,
+          [this](const QString& dir, int verified, int mismatches, bool completed) {
+            if (completed) {
+              m_manager->logAction(
+                  QString("Verified %1 file(s) in %2: %3 mismatch(es).").arg(verified).arg(dir).arg(mismatches),
+                  EventCategory::AutoSaveImage, mismatches > 0 ? EventLevel::Error : EventLevel::Info);
+            }
+            updateScrubLabel();
+          });
+  m_scrubTimer = new QTimer(this);
+  m_scrubTimer->setInterval(10 * 60 * 1000);
+  connect(m_scrubTimer, &QTimer::timeout, this, &AutoSaveWidget::maybeScrub);
   setupUi();
   loadSettings();
+  QString error;
+  if (!m_contentIndex.load(&error)) {
+    m_manager->logAction("Failed to load content index: " + error, EventCategory::AutoSaveImage, EventLevel::Warning);
+  }
+  if (!m_urlCache.load(&error)) {
+    m_manager->logAction("Failed to load URL cache: " + error, EventCategory::AutoSaveImage, EventLevel::Warning);
+  }
   loadChecksums();
+  importRecentDirectories();
+  // Left in the journal until auto-save is enabled
+  m_restorePending = true;
+  restoreDownloads();
+
+  m_scrubTimer->start();
+  // Stay out of the way during startup
+  QTimer::singleShot(60 * 1000, this, &AutoSaveWidget::maybeScrub);
 
   connect(m_manager, &ClipboardManager::clipboardChanged, this, &AutoSaveWidget::onClipboardChanged);
 }
@@ -165,11 +252,71 @@ void AutoSaveWidget::setupUi() {
   m_cleanButton = new QPushButton("Clean Checksums", this);
   pathLayout->addWidget(m_cleanButton);
 
+  m_checkIndexButton = new QPushButton("Check", this);
+  m_checkIndexButton->setToolTip("Dry run: report orphaned checksum entries and untracked files.");
+  pathLayout->addWidget(m_checkIndexButton);
+
   m_rebuildButton = new QPushButton("Rebuild Checksums", this);
   pathLayout->addWidget(m_rebuildButton);
 
+  m_importButton = new QPushButton("Import Folder...", this);
+  m_importButton->setToolTip("Copy the images of a folder tree into the archive, skipping duplicates.");
+  pathLayout->addWidget(m_importButton);
+
   layout->addLayout(pathLayout);
 
+  // Row 2b: Directory Layout
+  auto layoutRow = new QHBoxLayout();
+  m_layoutLabel = new QLabel("Layout:", this);
+  layoutRow->addWidget(m_layoutLabel);
+  m_layoutCombo = new QComboBox(this);
+  m_layoutCombo->addItem("Flat", (int)ArchiveLayout::Flat);
+  m_layoutCombo->addItem("By Date (YYYY/MM/DD)", (int)ArchiveLayout::Date);
+  m_layoutCombo->addItem("By Hash Prefix (ab/cd)", (int)ArchiveLayout::HashPrefix);
+  layoutRow->addWidget(m_layoutCombo);
+  m_migrateButton = new QPushButton("Migrate Existing Files", this);
+  m_migrateButton->setToolTip("Move already saved files into the selected layout in the background.");
+  layoutRow->addWidget(m_migrateButton);
+  m_dedupLabel = new QLabel("Skip duplicates in:", this);
+  layoutRow->addWidget(m_dedupLabel);
+  m_dedupCombo = new QComboBox(this);
+  m_dedupCombo->addItem("This Directory", (int)DedupScope::CurrentDirectory);
+  m_dedupCombo->addItem("Recent Directories", (int)DedupScope::RecentPaths);
+  m_dedupCombo->addItem("All Known Directories", (int)DedupScope::AllDirectories);
+  layoutRow->addWidget(m_dedupCombo);
+  layoutRow->addStretch();
+  layout->addLayout(layoutRow);
+
+  // Row 2c: Re-encode saved files
+  auto transcodeRow = new QHBoxLayout();
+  m_transcodeLabel = new QLabel("Re-encode:", this);
+  transcodeRow->addWidget(m_transcodeLabel);
+  m_transcodeFromCombo = new QComboBox(this);
+  m_transcodeFromCombo->addItem("All Formats", QByteArray());
+  const QList<QByteArray> readable = QImageReader::supportedImageFormats();
+  for (const QByteArray& format : {QByteArray("png"), QByteArray("bmp"), QByteArray("jpeg"), QByteArray("webp")}) {
+    if (readable.contains(format)) m_transcodeFromCombo->addItem(QString::fromLatin1(format.toUpper()), format);
+  }
+  transcodeRow->addWidget(m_transcodeFromCombo);
+  transcodeRow->addWidget(new QLabel("to", this));
+  m_transcodeFormatCombo = new QComboBox(this);
+  const QList<QByteArray> writable = QImageWriter::supportedImageFormats();
+  for (const QByteArray& format : {QByteArray("jpeg"), QByteArray("webp"), QByteArray("png")}) {
+    if (writable.contains(format)) m_transcodeFormatCombo->addItem(QString::fromLatin1(format.toUpper()), format);
+  }
+  transcodeRow->addWidget(m_transcodeFormatCombo);
+  m_transcodeQualitySpinBox = new QSpinBox(this);
+  m_transcodeQualitySpinBox->setRange(1, 100);
+  m_transcodeQualitySpinBox->setValue(85);
+  m_transcodeQualitySpinBox->setPrefix("Quality ");
+  transcodeRow->addWidget(m_transcodeQualitySpinBox);
+  m_transcodeButton = new QPushButton("Transcode", this);
+  m_transcodeButton->setToolTip("Re-encode matching saved files on all cores. Originals are deleted only after "
+                                "the whole batch succeeded.");
+  transcodeRow->addWidget(m_transcodeButton);
+  transcodeRow->addStretch();
+  layout->addLayout(transcodeRow);
+
   // Row 3: Max Size
   auto sizeLayout = new QHBoxLayout();
   m_maxSizeLabel = new QLabel("Max Size (MB):", this);
@@ -179,10 +326,128 @@ void AutoSaveWidget::setupUi() {
   m_maxSizeSpinBox->setValue(30);
   m_maxSizeSpinBox->setMinimumWidth(120);  // UI Polish: Make it wider
   sizeLayout->addWidget(m_maxSizeSpinBox);
+  m_paranoidCheckBox = new QCheckBox("Fully decode images before saving", this);
+  m_paranoidCheckBox->setToolTip("Paranoid mode: decode every pixel instead of only checking the image header.");
+  sizeLayout->addWidget(m_paranoidCheckBox);
+  m_blobStoreCheckBox = new QCheckBox("Store each image once", this);
+  m_blobStoreCheckBox->setToolTip(
+      "Keep image content once under .blobs and save names as reflinks or hardlinks to it.\n"
+      "Copying a known image again then adds a new name without using more disk space.");
+  sizeLayout->addWidget(m_blobStoreCheckBox);
   sizeLayout->addStretch();
   layout->addLayout(sizeLayout);
 
-  // Row 4: Download Progress Area
+  // Row 3b: Quota
+  auto quotaLayout = new QHBoxLayout();
+  m_quotaLabel = new QLabel("Quota:", this);
+  quotaLayout->addWidget(m_quotaLabel);
+  m_quotaSizeSpinBox = new QSpinBox(this);
+  m_quotaSizeSpinBox->setRange(0, 100000000);
+  m_quotaSizeSpinBox->setSuffix(" MB");
+  m_quotaSizeSpinBox->setSpecialValueText("No size limit");
+  m_quotaSizeSpinBox->setMinimumWidth(120);
+  quotaLayout->addWidget(m_quotaSizeSpinBox);
+  m_quotaFilesSpinBox = new QSpinBox(this);
+  m_quotaFilesSpinBox->setRange(0, 100000000);
+  m_quotaFilesSpinBox->setSuffix(" files");
+  m_quotaFilesSpinBox->setSpecialValueText("No file limit");
+  m_quotaFilesSpinBox->setMinimumWidth(120);
+  quotaLayout->addWidget(m_quotaFilesSpinBox);
+  m_evictionCombo = new QComboBox(this);
+  m_evictionCombo->addItem("Evict Oldest", (int)EvictionPolicy::Oldest);
+  m_evictionCombo->addItem("Evict Least Recently Opened", (int)EvictionPolicy::LeastRecentlyUsed);
+  quotaLayout->addWidget(m_evictionCombo);
+  m_usageLabel = new QLabel(this);
+  quotaLayout->addWidget(m_usageLabel);
+  quotaLayout->addStretch();
+  layout->addLayout(quotaLayout);
+
+  // Row 3c: Background verification
+  auto scrubLayout = new QHBoxLayout();
+  m_scrubCheckBox = new QCheckBox("Verify archive in background", this);
+  m_scrubCheckBox->setToolTip(QString("Re-hash saved files against checksums.txt every %1 days at idle priority.")
+                                  .arg(kScrubPassIntervalDays));
+  scrubLayout->addWidget(m_scrubCheckBox);
+  m_scrubBandwidthSpinBox = new QSpinBox(this);
+  m_scrubBandwidthSpinBox->setRange(1, 1000);
+  m_scrubBandwidthSpinBox->setSuffix(" MB/s");
+  m_scrubBandwidthSpinBox->setMinimumWidth(120);
+  scrubLayout->addWidget(m_scrubBandwidthSpinBox);
+  m_scrubLabel = new QLabel(this);
+  scrubLayout->addWidget(m_scrubLabel);
+  scrubLayout->addStretch();
+  layout->addLayout(scrubLayout);
+
+  // Row 3d: Watch folders
+  auto watchLayout = new QHBoxLayout();
+  m_watchLabel = new QLabel(this);
+  watchLayout->addWidget(m_watchLabel);
+  m_addWatchButton = new QPushButton("Add Watch Folder...", this);
+  m_addWatchButton->setToolTip("Save new images written to this folder, e.g. by a screenshot tool.");
+  watchLayout->addWidget(m_addWatchButton);
+  m_clearWatchButton = new QPushButton("Clear", this);
+  watchLayout->addWidget(m_clearWatchButton);
+  watchLayout->addStretch();
+  layout->addLayout(watchLayout);
+
+  // Background task progress
+  auto progressLayout = new QHBoxLayout();
+  m_progressBar = new QProgressBar(this);
+  m_progressBar->setTextVisible(true);
+  m_progressBar->setVisible(false);
+  progressLayout->addWidget(m_progressBar);
+  m_cancelJobButton = new QPushButton("Cancel", this);
+  m_cancelJobButton->setVisible(false);
+  // Each job connects its own cancel; the click is taken once
+  connect(m_cancelJobButton, &QPushButton::clicked, this, [this]() {
+    m_cancelJobButton->setEnabled(false);
+  });
+  progressLayout->addWidget(m_cancelJobButton);
+  layout->addLayout(progressLayout);
+
+  // Row 4: Downloads and Gallery
+  m_viewTabs = new QTabWidget(this);
+  auto downloadsPage = new QWidget(m_viewTabs);
+  auto downloadsLayout = new QVBoxLayout(downloadsPage);
+  downloadsLayout->setContentsMargins(0, 0, 0, 0);
+
+  auto limitsLayout = new QHBoxLayout();
+  limitsLayout->addWidget(new QLabel("Parallel downloads:", this));
+  m_downloadConcurrencySpinBox = new QSpinBox(this);
+  m_downloadConcurrencySpinBox->setRange(1, 32);
+  limitsLayout->addWidget(m_downloadConcurrencySpinBox);
+  limitsLayout->addWidget(new QLabel("Per host:", this));
+  m_downloadsPerHostSpinBox = new QSpinBox(this);
+  m_downloadsPerHostSpinBox->setRange(0, 16);
+  m_downloadsPerHostSpinBox->setSpecialValueText("Unlimited");
+  m_downloadsPerHostSpinBox->setToolTip("Keeps one slow server from holding up downloads from other hosts.");
+  limitsLayout->addWidget(m_downloadsPerHostSpinBox);
+  limitsLayout->addStretch();
+  downloadsLayout->addLayout(limitsLayout);
+
+  auto bandwidthLayout = new QHBoxLayout();
+  bandwidthLayout->addWidget(new QLabel("Bandwidth:", this));
+  m_downloadBandwidthSpinBox = new QSpinBox(this);
+  m_downloadBandwidthSpinBox->setRange(0, 1000000);
+  m_downloadBandwidthSpinBox->setSuffix(" KB/s");
+  m_downloadBandwidthSpinBox->setSpecialValueText("Unlimited");
+  m_downloadBandwidthSpinBox->setToolTip("Shared by all downloads, so they leave room for other traffic.");
+  bandwidthLayout->addWidget(m_downloadBandwidthSpinBox);
+  bandwidthLayout->addWidget(new QLabel("Per download:", this));
+  m_perDownloadBandwidthSpinBox = new QSpinBox(this);
+  m_perDownloadBandwidthSpinBox->setRange(0, 1000000);
+  m_perDownloadBandwidthSpinBox->setSuffix(" KB/s");
+  m_perDownloadBandwidthSpinBox->setSpecialValueText("Unlimited");
+  bandwidthLayout->addWidget(m_perDownloadBandwidthSpinBox);
+  m_pauseOnForegroundCheckBox = new QCheckBox("Pause during other traffic", this);
+  m_pauseOnForegroundCheckBox->setToolTip(
+      "Holds downloads back while other programs use the network, e.g. a video call (Linux and macOS).");
+  // Without interface counters (Windows) there is nothing to detect other traffic with
+  m_pauseOnForegroundCheckBox->setVisible(netstats::isAvailable());
+  bandwidthLayout->addWidget(m_pauseOnForegroundCheckBox);
+  bandwidthLayout->addStretch();
+  downloadsLayout->addLayout(bandwidthLayout);
+
   m_downloadListView = new QListView(this);
   m_downloadListView->setModel(m_downloadModel);
   // m_downloadListView->setItemDelegate(new DownloadDelegate(m_downloadListView));
@@ -206,32 +471,101 @@ void AutoSaveWidget::setupUi() {
   // The DownloadDelegate above is a QAbstractItemDelegate.
 
   m_downloadListView->setItemDelegate(new DownloadProgressDelegate(this));
-  layout->addWidget(m_downloadListView);
+  m_downloadListView->setSelectionMode(QAbstractItemView::ExtendedSelection);
+  m_downloadListView->setContextMenuPolicy(Qt::CustomContextMenu);
+  connect(m_downloadListView, &QWidget::customContextMenuRequested, this, &AutoSaveWidget::onDownloadContextMenu);
+  downloadsLayout->addWidget(m_downloadListView);
 
   // Clear Finished Button
   m_clearFinishedButton = new QPushButton("Clear Finished Downloads", this);
   connect(m_clearFinishedButton, &QPushButton::clicked, m_downloadModel, &DownloadProgressModel::clearFinished);
-  layout->addWidget(m_clearFinishedButton);
+  downloadsLayout->addWidget(m_clearFinishedButton);
+  m_viewTabs->addTab(downloadsPage, "Downloads");
+
+  // Uniform sizes and batched layout keep 100k items cheap; only painted rows ask for thumbnails
+  m_galleryView = new QListView(this);
+  m_galleryView->setModel(m_galleryModel);
+  m_galleryView->setViewMode(QListView::IconMode);
+  m_galleryView->setIconSize(m_thumbnails->thumbnailSize());
+  m_galleryView->setGridSize(m_thumbnails->thumbnailSize() + QSize(24, 40));
+  m_galleryView->setUniformItemSizes(true);
+  m_galleryView->setResizeMode(QListView::Adjust);
+  m_galleryView->setMovement(QListView::Static);
+  m_galleryView->setLayoutMode(QListView::Batched);
+  m_galleryView->setBatchSize(1000);
+  m_galleryView->setTextElideMode(Qt::ElideMiddle);
+  m_galleryView->setSelectionMode(QAbstractItemView::ExtendedSelection);
+  connect(m_galleryView, &QListView::activated, this, [this](const QModelIndex& index) {
+    QDesktopServices::openUrl(QUrl::fromLocalFile(index.data(GalleryModel::FilePathRole).toString()));
+  });
+  m_viewTabs->addTab(m_galleryView, "Gallery");
+
+  layout->addWidget(m_viewTabs);
 
   connect(m_enableCheckBox, &QCheckBox::stateChanged, this, &AutoSaveWidget::onToggleChanged);
   connect(m_maxSizeSpinBox, QOverload<int>::of(&QSpinBox::valueChanged), this, &AutoSaveWidget::onMaxSizeChanged);
+  connect(m_paranoidCheckBox, &QCheckBox::toggled, this, &AutoSaveWidget::onParanoidToggled);
+  connect(m_blobStoreCheckBox, &QCheckBox::toggled, this, &AutoSaveWidget::onBlobStoreToggled);
+  connect(m_quotaSizeSpinBox, &QSpinBox::editingFinished, this, &AutoSaveWidget::onQuotaChanged);
+  connect(m_quotaFilesSpinBox, &QSpinBox::editingFinished, this, &AutoSaveWidget::onQuotaChanged);
+  connect(m_evictionCombo, QOverload<int>::of(&QComboBox::activated), this, &AutoSaveWidget::onQuotaChanged);
+  connect(m_scrubCheckBox, &QCheckBox::toggled, this, &AutoSaveWidget::onScrubSettingsChanged);
+  connect(m_scrubBandwidthSpinBox, &QSpinBox::editingFinished, this, &AutoSaveWidget::onScrubSettingsChanged);
+  connect(m_addWatchButton, &QPushButton::clicked, this, &AutoSaveWidget::onAddWatchFolderClicked);
+  connect(m_clearWatchButton, &QPushButton::clicked, this, &AutoSaveWidget::onClearWatchFoldersClicked);
+  connect(m_downloadConcurrencySpinBox, &QSpinBox::editingFinished, this, &AutoSaveWidget::onDownloadLimitsChanged);
+  connect(m_downloadsPerHostSpinBox, &QSpinBox::editingFinished, this, &AutoSaveWidget::onDownloadLimitsChanged);
+  connect(m_downloadBandwidthSpinBox, &QSpinBox::editingFinished, this, &AutoSaveWidget::onDownloadLimitsChanged);
+  connect(m_perDownloadBandwidthSpinBox, &QSpinBox::editingFinished, this, &AutoSaveWidget::onDownloadLimitsChanged);
+  connect(m_pauseOnForegroundCheckBox, &QCheckBox::toggled, this, &AutoSaveWidget::onDownloadLimitsChanged);
   connect(m_browseButton, &QPushButton::clicked, this, &AutoSaveWidget::onBrowseClicked);
   connect(m_openDirButton, &QPushButton::clicked, this, &AutoSaveWidget::onOpenDirClicked);
   connect(m_pathCombo, QOverload<int>::of(&QComboBox::activated), this, &AutoSaveWidget::onPathSelected);
   connect(m_cleanButton, &QPushButton::clicked, this, &AutoSaveWidget::onCleanClicked);
+  connect(m_checkIndexButton, &QPushButton::clicked, this, &AutoSaveWidget::onCheckIndexClicked);
   connect(m_rebuildButton, &QPushButton::clicked, this, &AutoSaveWidget::onRebuildClicked);
+  connect(m_importButton, &QPushButton::clicked, this, &AutoSaveWidget::onImportFolderClicked);
+  connect(m_layoutCombo, QOverload<int>::of(&QComboBox::activated), this, &AutoSaveWidget::onLayoutChanged);
+  connect(m_migrateButton, &QPushButton::clicked, this, &AutoSaveWidget::onMigrateClicked);
+  connect(m_transcodeButton, &QPushButton::clicked, this, &AutoSaveWidget::onTranscodeClicked);
+  connect(m_dedupCombo, QOverload<int>::of(&QComboBox::activated), this, &AutoSaveWidget::onDedupScopeChanged);
 }
 
 void AutoSaveWidget::onToggleChanged(int state) {
-  if (m_isRebuilding) return;
+  if (m_isBusy) return;
   qDebug() << state;
   m_isEnabled = (state == Qt::Checked);
+  updateWatchFolders();
+  restoreDownloads();
   m_pathCombo->setEnabled(m_isEnabled);
   m_browseButton->setEnabled(m_isEnabled);
   m_openDirButton->setEnabled(m_isEnabled);
   m_cleanButton->setEnabled(m_isEnabled);
+  m_checkIndexButton->setEnabled(m_isEnabled);
   m_rebuildButton->setEnabled(m_isEnabled);
+  m_importButton->setEnabled(m_isEnabled);
   m_maxSizeSpinBox->setEnabled(m_isEnabled);
+  m_paranoidCheckBox->setEnabled(m_isEnabled);
+  m_blobStoreCheckBox->setEnabled(m_isEnabled);
+  m_quotaSizeSpinBox->setEnabled(m_isEnabled);
+  m_quotaFilesSpinBox->setEnabled(m_isEnabled);
+  m_evictionCombo->setEnabled(m_isEnabled);
+  m_scrubCheckBox->setEnabled(m_isEnabled);
+  m_scrubBandwidthSpinBox->setEnabled(m_isEnabled);
+  m_addWatchButton->setEnabled(m_isEnabled);
+  m_clearWatchButton->setEnabled(m_isEnabled);
+  if (m_watchLabel) m_watchLabel->setEnabled(m_isEnabled);
+  if (m_quotaLabel) m_quotaLabel->setEnabled(m_isEnabled);
+  m_layoutCombo->setEnabled(m_isEnabled);
+  m_migrateButton->setEnabled(m_isEnabled);
+  m_transcodeFromCombo->setEnabled(m_isEnabled);
+  m_transcodeFormatCombo->setEnabled(m_isEnabled);
+  m_transcodeQualitySpinBox->setEnabled(m_isEnabled);
+  m_transcodeButton->setEnabled(m_isEnabled);
+  if (m_transcodeLabel) m_transcodeLabel->setEnabled(m_isEnabled);
+  m_dedupCombo->setEnabled(m_isEnabled);
+  if (m_dedupLabel) m_dedupLabel->setEnabled(m_isEnabled);
+  if (m_layoutLabel) m_layoutLabel->setEnabled(m_isEnabled);
   if (m_pathLabel) m_pathLabel->setEnabled(m_isEnabled);
   if (m_maxSizeLabel) m_maxSizeLabel->setEnabled(m_isEnabled);
   saveSettings();
@@ -243,6 +577,317 @@ void AutoSaveWidget::onMaxSizeChanged(int value) {
   saveSettings();
 }
 
+void AutoSaveWidget::onLayoutChanged(int index) {
+  m_layout = static_cast<ArchiveLayout>(m_layoutCombo->itemData(index).toInt());
+  saveSettings();
+}
+
+void AutoSaveWidget::onDedupScopeChanged(int index) {
+  m_dedupScope = static_cast<DedupScope>(m_dedupCombo->itemData(index).toInt());
+  saveSettings();
+}
+
+void AutoSaveWidget::onMigrateClicked() {
+  if (m_targetDir.isEmpty() || !QDir(m_targetDir).exists()) {
+    m_manager->logAction("Target directory invalid, cannot migrate.", EventCategory::AutoSaveImage, EventLevel::Error);
+    return;
+  }
+
+  setBusy(true);
+  beginRewrite(m_targetDir);
+  m_progressBar->setRange(0, 0);
+  m_progressBar->setFormat("Migrating files... %v/%m");
+  m_progressBar->setVisible(true);
+
+  QString targetDir = m_targetDir;
+  ArchiveLayout layout = m_layout;
+  auto watcher = new QFutureWatcher<archivelayout::MigrationResult>(this);
+  connect(watcher, &QFutureWatcherBase::progressRangeChanged, m_progressBar, &QProgressBar::setRange);
+  connect(watcher, &QFutureWatcherBase::progressValueChanged, m_progressBar, &QProgressBar::setValue);
+  connect(watcher, &QFutureWatcherBase::finished, this, [this, watcher, targetDir, layout]() {
+    archivelayout::MigrationResult result = watcher->result();
+    watcher->deleteLater();
+    m_progressBar->setVisible(false);
+    if (targetDir == m_targetDir) {
+      loadChecksums();
+    }
+    endRewrite();
+    setBusy(false);
+
+    if (!result.error.isEmpty()) {
+      m_manager->logAction("Migration could not write checksums: " + result.error, EventCategory::AutoSaveImage,
+                           EventLevel::Error);
+    }
+    m_manager->logAction(QString("Migrated %1 to %2 layout: %3 moved, %4 newly indexed, %5 failed. Time cost: %6 ms")
+                             .arg(targetDir, archivelayout::toString(layout))
+                             .arg(result.moved)
+                             .arg(result.indexed)
+                             .arg(result.failed)
+                             .arg(result.elapsedMs),
+                         EventCategory::AutoSaveImage, result.failed > 0 ? EventLevel::Warning : EventLevel::Info);
+  });
+  watcher->setFuture(QtConcurrent::run(&archivelayout::migrate, targetDir, layout));
+}
+
+void AutoSaveWidget::onTranscodeClicked() {
+  if (m_targetDir.isEmpty() || !QDir(m_targetDir).exists()) {
+    m_manager->logAction("Target directory invalid, cannot transcode.", EventCategory::AutoSaveImage,
+                         EventLevel::Error);
+    return;
+  }
+
+  archivetranscode::Options options;
+  options.format = m_transcodeFormatCombo->currentData().toByteArray();
+  options.quality = m_transcodeQualitySpinBox->value();
+  QString from = QString::fromLatin1(m_transcodeFromCombo->currentData().toByteArray());
+  QString to = QString::fromLatin1(options.format);
+  if (to.isEmpty()) return;
+
+  // Picked from the metadata sidecar; files without a known format are left alone
+  QList<ImageMetadata> candidates;
+  const QList<int> rows = m_metadata.filter([this, &from, &to](int row) {
+    QString format = m_metadata.format(row);
+    return !format.isEmpty() && format != to && (from.isEmpty() || format == from) &&
+           m_index.containsPath(m_metadata.path(row));
+  });
+  for (int row : rows) {
+    candidates.append(m_metadata.at(row));
+  }
+  if (candidates.isEmpty()) {
+    m_manager->logAction("No saved files to transcode.", EventCategory::AutoSaveImage, EventLevel::Info);
+    return;
+  }
+
+  // Can take hours; new clipboard images are held by beginRewrite() and written afterwards
+  setBusy(true, true);
+  beginRewrite(m_targetDir);
+  m_progressBar->setRange(0, candidates.size());
+  m_progressBar->setFormat("Transcoding files... %v/%m");
+  m_progressBar->setVisible(true);
+
+  QString targetDir = m_targetDir;
+  auto watcher = new QFutureWatcher<archivetranscode::Result>(this);
+  connect(watcher, &QFutureWatcherBase::progressRangeChanged, m_progressBar, &QProgressBar::setRange);
+  connect(watcher, &QFutureWatcherBase::progressValueChanged, m_progressBar, &QProgressBar::setValue);
+  // Only stops the encoding stage; once originals are being replaced the batch runs to the end
+  options.cancel = std::make_shared<std::atomic_bool>(false);
+  m_cancelJobButton->setEnabled(true);
+  m_cancelJobButton->setVisible(true);
+  connect(m_cancelJobButton, &QPushButton::clicked, watcher, [this, cancel = options.cancel]() {
+    *cancel = true;
+    m_progressBar->setFormat("Canceling...");
+  });
+  connect(watcher, &QFutureWatcherBase::finished, this, [this, watcher, targetDir, to]() {
+    archivetranscode::Result result = watcher->result();
+    watcher->deleteLater();
+    m_progressBar->setVisible(false);
+    if (targetDir == m_targetDir) {
+      loadChecksums();
+    }
+    endRewrite();
+    setBusy(false);
+
+    if (!result.committed) {
+      m_manager->logAction(result.canceled ? "Transcode canceled, no file was changed."
+                                           : "Transcode aborted, no file was changed: " + result.error,
+                           EventCategory::AutoSaveImage, result.canceled ? EventLevel::Info : EventLevel::Error);
+      return;
+    }
+    // Replaced originals may have been the last names of their blobs
+    if (m_useBlobStore && targetDir == m_targetDir) pruneBlobs();
+    m_manager->logAction(QString("Transcoded %1 file(s) in %2 to %3: %4 -> %5, %6 failed. Time cost: %7 ms")
+                             .arg(result.transcoded)
+                             .arg(targetDir, to.toUpper())
+                             .arg(utils::formatSize(result.bytesBefore), utils::formatSize(result.bytesAfter))
+                             .arg(result.failed)
+                             .arg(result.elapsedMs),
+                         EventCategory::AutoSaveImage, result.failed > 0 ? EventLevel::Warning : EventLevel::Info);
+  });
+  watcher->setFuture(QtConcurrent::run(&archivetranscode::transcode, targetDir, candidates, options));
+}
+
+void AutoSaveWidget::setBusy(bool busy, bool keepSaving) {
+  m_isBusy = busy;
+  m_savesWhileBusy = busy && keepSaving;
+  m_cancelJobButton->setVisible(false);
+  updateWatchPaused();
+  if (busy) {
+    m_enableCheckBox->setEnabled(false);
+    m_pathCombo->setEnabled(false);
+    m_browseButton->setEnabled(false);
+    m_openDirButton->setEnabled(false);
+    m_cleanButton->setEnabled(false);
+    m_checkIndexButton->setEnabled(false);
+    m_rebuildButton->setEnabled(false);
+    m_importButton->setEnabled(false);
+    m_maxSizeSpinBox->setEnabled(false);
+    m_paranoidCheckBox->setEnabled(false);
+    m_blobStoreCheckBox->setEnabled(false);
+    m_quotaSizeSpinBox->setEnabled(false);
+    m_quotaFilesSpinBox->setEnabled(false);
+    m_evictionCombo->setEnabled(false);
+    m_scrubCheckBox->setEnabled(false);
+    m_scrubBandwidthSpinBox->setEnabled(false);
+    m_addWatchButton->setEnabled(false);
+    m_clearWatchButton->setEnabled(false);
+    // Files may move under it; the cursor lets it pick up again later
+    m_scrubber->stop();
+    m_layoutCombo->setEnabled(false);
+    m_migrateButton->setEnabled(false);
+    m_transcodeFromCombo->setEnabled(false);
+    m_transcodeFormatCombo->setEnabled(false);
+    m_transcodeQualitySpinBox->setEnabled(false);
+    m_transcodeButton->setEnabled(false);
+    m_dedupCombo->setEnabled(false);
+  } else {
+    m_enableCheckBox->setEnabled(true);
+    // Restore enabled state based on checkbox
+    onToggleChanged(m_enableCheckBox->isChecked() ? Qt::Checked : Qt::Unchecked);
+
+    QList<QPair<QStringList, QStringList>> dirChanges;
+    dirChanges.swap(m_heldDirChanges);
+    for (const auto& [added, removed] : std::as_const(dirChanges)) {
+      onDirectoryChanged(added, removed);
+    }
+  }
+}
+
+void AutoSaveWidget::onAddWatchFolderClicked() {
+  QString dir = QFileDialog::getExistingDirectory(this, "Select Folder to Watch",
+                                                  QStandardPaths::writableLocation(QStandardPaths::PicturesLocation));
+  if (dir.isEmpty() || m_watchFolders.contains(dir)) return;
+  m_watchFolders.append(dir);
+  saveSettings();
+  updateWatchFolders();
+}
+
+void AutoSaveWidget::onClearWatchFoldersClicked() {
+  m_watchFolders.clear();
+  saveSettings();
+  updateWatchFolders();
+}
+
+void AutoSaveWidget::updateWatchFolders() {
+  // Watching the archive (or a folder containing it) would ingest our own saves again
+  QString target = QDir::cleanPath(m_targetDir);
+  QStringList folders;
+  QStringList skipped;
+  for (const QString& folder : std::as_const(m_watchFolders)) {
+    QString clean = QDir::cleanPath(folder);
+    bool overlaps = !target.isEmpty() && (clean == target || target.startsWith(clean + "/") ||
+                                          clean.startsWith(target + "/"));
+    (overlaps ? skipped : folders).append(clean);
+  }
+  m_watchSource->setFolders(m_isEnabled ? folders : QStringList());
+
+  if (m_watchFolders.isEmpty()) {
+    m_watchLabel->setText("Watch folders: none");
+  } else if (skipped.isEmpty()) {
+    m_watchLabel->setText(QString("Watch folders: %1").arg(m_watchFolders.size()));
+  } else {
+    m_watchLabel->setText(QString("Watch folders: %1 (%2 overlap the target directory and are ignored)")
+                              .arg(m_watchFolders.size())
+                              .arg(skipped.size()));
+  }
+  m_watchLabel->setToolTip(m_watchFolders.join("\n"));
+}
+
+void AutoSaveWidget::updateWatchPaused() {
+  // One batch in flight at a time; files settling meanwhile make up the next, bigger one
+  m_watchSource->setPaused(m_isBusy || m_isWatchIngesting);
+}
+
+void AutoSaveWidget::onWatchedFilesArrived(const QStringList& paths) {
+  if (!m_isEnabled) return;
+  IngestPipeline* pipeline = ingestLocalFiles(paths, 0);
+  if (!pipeline) return;
+
+  m_isWatchIngesting = true;
+  updateWatchPaused();
+  connect(pipeline, &IngestPipeline::finished, this, [this]() {
+    m_isWatchIngesting = false;
+    updateWatchPaused();
+  });
+}
+
+void AutoSaveWidget::onParanoidToggled(bool checked) {
+  m_paranoidValidation = checked;
+  saveSettings();
+}
+
+void AutoSaveWidget::onBlobStoreToggled(bool checked) {
+  m_useBlobStore = checked;
+  saveSettings();
+}
+
+void AutoSaveWidget::onQuotaChanged() {
+  m_quotaMB = m_quotaSizeSpinBox->value();
+  m_quotaFiles = m_quotaFilesSpinBox->value();
+  m_evictionPolicy = static_cast<EvictionPolicy>(m_evictionCombo->currentData().toInt());
+  saveSettings();
+  updateUsageLabel();
+  maybeEvict();
+}
+
+void AutoSaveWidget::onDownloadLimitsChanged() {
+  m_downloadConcurrency = m_downloadConcurrencySpinBox->value();
+  m_downloadsPerHost = m_downloadsPerHostSpinBox->value();
+  m_downloadBandwidthKB = m_downloadBandwidthSpinBox->value();
+  m_perDownloadBandwidthKB = m_perDownloadBandwidthSpinBox->value();
+  m_pauseOnForegroundTraffic = m_pauseOnForegroundCheckBox->isChecked();
+  m_downloadQueue->setMaxConcurrent(m_downloadConcurrency);
+  m_downloadQueue->setMaxPerHost(m_downloadsPerHost);
+  m_downloadQueue->setRateLimit({qint64(m_downloadBandwidthKB) * 1024, qint64(m_perDownloadBandwidthKB) * 1024});
+  m_downloadQueue->setPauseOnForegroundTraffic(m_pauseOnForegroundTraffic && netstats::isAvailable());
+  saveSettings();
+}
+
+void AutoSaveWidget::onScrubSettingsChanged() {
+  m_scrubEnabled = m_scrubCheckBox->isChecked();
+  m_scrubBandwidthMB = m_scrubBandwidthSpinBox->value();
+  m_scrubber->setBandwidthLimit(qint64(m_scrubBandwidthMB) * 1024 * 1024);
+  saveSettings();
+  if (m_scrubEnabled) {
+    maybeScrub();
+  } else {
+    m_scrubber->stop();
+  }
+  updateScrubLabel();
+}
+
+void AutoSaveWidget::maybeScrub() {
+  if (!m_isEnabled || !m_scrubEnabled || m_isBusy || m_scrubber->isRunning()) return;
+  if (m_targetDir.isEmpty() || m_index.size() == 0) return;
+
+  Scrubber::State state = Scrubber::loadState(m_targetDir);
+  bool due = !state.cursor.isEmpty() || !state.lastCompleted.isValid() ||
+             state.lastCompleted.daysTo(QDateTime::currentDateTime()) >= kScrubPassIntervalDays;
+  if (!due) return;
+
+  qDebug() << "Starting background scrub of" << m_targetDir << "from" << state.cursor;
+  m_scrubber->start(m_targetDir, m_index.entries());
+  updateScrubLabel();
+}
+
+void AutoSaveWidget::updateScrubLabel() {
+  if (m_scrubber->isRunning()) {
+    m_scrubLabel->setText("Verifying...");
+    return;
+  }
+  if (m_targetDir.isEmpty()) {
+    m_scrubLabel->clear();
+    return;
+  }
+  Scrubber::State state = Scrubber::loadState(m_targetDir);
+  if (!state.cursor.isEmpty()) {
+    m_scrubLabel->setText("Verification paused at " + state.cursor);
+  } else if (state.lastCompleted.isValid()) {
+    m_scrubLabel->setText("Last verified: " + state.lastCompleted.toString("yyyy-MM-dd HH:mm"));
+  } else {
+    m_scrubLabel->setText("Not verified yet");
+  }
+}
+
 void AutoSaveWidget::onBrowseClicked() {
   qDebug() << "clicked";
   QString dir = QFileDialog::getExistingDirectory(
@@ -320,73 +965,141 @@ void AutoSaveWidget::populatePathCombo() {
   m_pathCombo->blockSignals(blocked);
 }
 
-void AutoSaveWidget::onCleanClicked() {
+void AutoSaveWidget::onCleanClicked() { runClean(false); }
+
+void AutoSaveWidget::onCheckIndexClicked() { runClean(true); }
+
+void AutoSaveWidget::runClean(bool dryRun) {
   if (m_targetDir.isEmpty()) {
     m_manager->logAction("Cannot clean checksums: Target directory is not set.", EventCategory::AutoSaveImage,
                          EventLevel::Warning);
     return;
   }
 
-  QFile file(QDir(m_targetDir).filePath(kChecksumFileName));
-  if (!file.exists()) {
+  if (!QFile::exists(QDir(m_targetDir).filePath(ChecksumIndex::kFileName))) {
     m_manager->logAction("Checksums file not found.", EventCategory::AutoSaveImage, EventLevel::Info);
     return;
   }
 
-  if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
-    m_manager->logAction("Failed to open checksums file for reading.", EventCategory::AutoSaveImage, EventLevel::Error);
-    return;
-  }
+  setBusy(true);
+  // A check only reads checksums.txt; a clean rewrites it
+  if (!dryRun) beginRewrite(m_targetDir);
+  m_progressBar->setRange(0, 0);
+  m_progressBar->setFormat(dryRun ? "Checking checksums..." : "Cleaning checksums...");
+  m_progressBar->setVisible(true);
+
+  QString targetDir = m_targetDir;
+  auto watcher = new QFutureWatcher<ChecksumCleanReport>(this);
+  connect(watcher, &QFutureWatcherBase::finished, this, [this, watcher, targetDir]() {
+    ChecksumCleanReport report = watcher->result();
+    watcher->deleteLater();
+    m_progressBar->setVisible(false);
+    if (!report.dryRun && targetDir == m_targetDir) {
+      loadChecksums();
+    }
+    if (!report.dryRun) endRewrite();
+    setBusy(false);
+    if (!report.dryRun && targetDir == m_targetDir) {
+      pruneBlobs();
+    }
 
-  QStringList validLines;
-  QSet<QByteArray> validChecksums;
-  int removedCount = 0;
-
-  QTextStream in(&file);
-  while (!in.atEnd()) {
-    QString line = in.readLine();
-    if (line.trimmed().isEmpty()) continue;
-
-    int splitIndex = line.indexOf(": ");
-    if (splitIndex != -1) {
-      QString filename = line.left(splitIndex).trimmed();
-      if (QFile::exists(QDir(m_targetDir).filePath(filename))) {
-        validLines.append(line);
-        QString hashHex = line.mid(splitIndex + 2).trimmed();
-        validChecksums.insert(QByteArray::fromHex(hashHex.toUtf8()));
-      } else {
-        qDebug() << "Removed:" << filename;
-        removedCount++;
-      }
+    if (!report.error.isEmpty()) {
+      m_manager->logAction("Failed to clean checksums: " + report.error, EventCategory::AutoSaveImage,
+                           EventLevel::Error);
+      return;
     }
-  }
-  file.close();
 
-  if (removedCount > 0) {
-    if (file.open(QIODevice::WriteOnly | QIODevice::Text | QIODevice::Truncate)) {
-      QTextStream out(&file);
-      for (const QString& line : validLines) {
-        out << line << "\n";
+    // Full lists go to the debug output; the event log gets a sample
+    static const int kMaxListed = 20;
+    auto logPaths = [this](const QString& title, const QStringList& paths) {
+      qDebug() << title << paths;
+      for (int i = 0; i < qMin(paths.size(), kMaxListed); ++i) {
+        m_manager->logAction(QString("%1: %2").arg(title, paths[i]), EventCategory::AutoSaveImage, EventLevel::Info);
       }
-      file.close();
-
-      m_seenChecksums = validChecksums;
-      m_manager->logAction(QString("Cleaned checksums. Removed %1 non-existent entries.").arg(removedCount),
+      if (paths.size() > kMaxListed) {
+        m_manager->logAction(QString("%1: ... and %2 more").arg(title).arg(paths.size() - kMaxListed),
+                             EventCategory::AutoSaveImage, EventLevel::Info);
+      }
+    };
+
+    if (report.dryRun) {
+      logPaths("Orphaned entry", report.orphaned);
+      logPaths("Untracked file", report.untracked);
+      m_manager->logAction(QString("Checked %1 checksum entries: %2 orphaned, %3 untracked file(s). Time cost: %4 ms")
+                               .arg(report.total)
+                               .arg(report.orphaned.size())
+                               .arg(report.untracked.size())
+                               .arg(report.elapsedMs),
+                           EventCategory::AutoSaveImage, EventLevel::Info);
+    } else if (!report.orphaned.isEmpty()) {
+      m_manager->logAction(QString("Cleaned checksums. Removed %1 non-existent entries. Time cost: %2 ms")
+                               .arg(report.orphaned.size())
+                               .arg(report.elapsedMs),
                            EventCategory::AutoSaveImage, EventLevel::Info);
     } else {
-      m_manager->logAction("Failed to write cleaned checksums file.", EventCategory::AutoSaveImage, EventLevel::Error);
+      m_manager->logAction("No non-existent entries found in checksums.", EventCategory::AutoSaveImage,
+                           EventLevel::Info);
     }
-  } else {
-    m_manager->logAction("No non-existent entries found in checksums.", EventCategory::AutoSaveImage, EventLevel::Info);
-  }
+  });
+  watcher->setFuture(QtConcurrent::run(&ChecksumIndex::clean, targetDir, dryRun));
 }
 
 void AutoSaveWidget::onClearFinishedClicked() { m_downloadModel->clearFinished(); }
 
+void AutoSaveWidget::onDownloadContextMenu(const QPoint& pos) {
+  QHash<int, DownloadHandle> handles;  // by model id
+  bool anyPaused = false;
+  bool anyRunning = false;
+  for (const QModelIndex& index : m_downloadListView->selectionModel()->selectedIndexes()) {
+    int id = index.data(DownloadProgressModel::IdRole).toInt();
+    DownloadHandle handle = m_downloadHandles.value(id);
+    if (!handle.isValid()) continue;
+    handles.insert(id, handle);
+    if (index.data(DownloadProgressModel::IsPausedRole).toBool()) {
+      anyPaused = true;
+    } else {
+      anyRunning = true;
+    }
+  }
+  if (handles.isEmpty()) return;
+
+  QMenu menu(this);
+  QAction* nextAction = menu.addAction("Download Next");
+  QAction* pauseAction = menu.addAction("Pause");
+  pauseAction->setEnabled(anyRunning);
+  QAction* resumeAction = menu.addAction("Resume");
+  resumeAction->setEnabled(anyPaused);
+  menu.addSeparator();
+  QAction* cancelAction = menu.addAction("Cancel");
+
+  QAction* selected = menu.exec(m_downloadListView->viewport()->mapToGlobal(pos));
+  if (!selected) return;
+  // The model is updated first: resuming may start the download right away
+  for (auto it = handles.cbegin(); it != handles.cend(); ++it) {
+    if (selected == nextAction) {
+      it->setPriority(DownloadQueue::High);
+    } else if (selected == pauseAction) {
+      if (m_downloadQueue->isPaused(it->id())) continue;
+      m_downloadModel->setPaused(it.key(), true);
+      it->pause();
+    } else if (selected == resumeAction) {
+      if (!m_downloadQueue->isPaused(it->id())) continue;
+      m_downloadModel->setPaused(it.key(), false);
+      it->resume();
+    } else if (selected == cancelAction) {
+      it->cancel();
+    }
+  }
+}
+
 void AutoSaveWidget::onClipboardChanged() {
-  if (!m_isEnabled || m_isRebuilding) return;
+  if (!m_isEnabled || (m_isBusy && !m_savesWhileBusy)) return;
   qDebug() << "processing";
 
+  bool savedFromList = processUrlListContent();
+  if (savedFromList) {
+    return;
+  }
   bool savedFromText = processTextContent();
   if (savedFromText) {
     return;
@@ -398,6 +1111,231 @@ void AutoSaveWidget::onClipboardChanged() {
   qDebug() << "No valid content found in clipboard";
 }
 
+bool AutoSaveWidget::processUrlListContent() {
+  QList<QUrl> urls;
+  const QMimeData* mime = m_manager->mimeData();
+  bool fromUriList = mime && mime->hasUrls();
+  if (fromUriList) {
+    urls = mime->urls();
+  } else if (m_manager->hasText()) {
+    const QStringList lines = m_manager->latestText().split('\n', Qt::SkipEmptyParts);
+    for (const QString& line : lines) {
+      QString entry = line.trimmed();
+      // text/uri-list comment lines start with '#'
+      if (entry.isEmpty() || entry.startsWith('#')) continue;
+      QUrl url(entry);
+      bool isUrl = url.isLocalFile() || url.scheme() == "http" || url.scheme() == "https";
+      urls.append(isUrl ? url : QUrl::fromLocalFile(entry));
+    }
+  }
+
+  // Single entries keep going through the regular text path
+  if (urls.size() < 2) {
+    return false;
+  }
+
+  QStringList localPaths;
+  QList<QUrl> remoteUrls;
+  QSet<QString> seenEntries;
+  for (const QUrl& url : std::as_const(urls)) {
+    if (url.scheme() == "http" || url.scheme() == "https") {
+      if (!seenEntries.contains(url.toString())) {
+        seenEntries.insert(url.toString());
+        remoteUrls.append(url);
+      }
+    } else if (url.isLocalFile()) {
+      QString path = QFileInfo(url.toLocalFile()).absoluteFilePath();
+      // Plain multi-line text is only a batch if its lines name existing files
+      if (!fromUriList && !QFileInfo(path).isFile()) continue;
+      if (!seenEntries.contains(path)) {
+        seenEntries.insert(path);
+        localPaths.append(path);
+      }
+    }
+  }
+
+  if (localPaths.size() + remoteUrls.size() < 2) {
+    return false;
+  }
+
+  qDebug() << "Batch clipboard payload:" << localPaths.size() << "file(s)," << remoteUrls.size() << "URL(s)";
+
+  // A batch is backlog: anything copied on its own later goes ahead of it
+  for (const QUrl& url : std::as_const(remoteUrls)) {
+    handleRemoteUrl(url, QImage(), DownloadQueue::Low);
+  }
+
+  if (!localPaths.isEmpty()) {
+    ingestLocalFiles(localPaths, remoteUrls.size());
+  } else {
+    m_manager->logAction(QString("Batch: %1 URL(s) queued for download.").arg(remoteUrls.size()),
+                         EventCategory::AutoSaveImage, EventLevel::Info);
+  }
+  return true;
+}
+
+IngestPipeline* AutoSaveWidget::createIngestPipeline() {
+  if (m_targetDir.isEmpty() || !QDir(m_targetDir).exists()) {
+    m_manager->logAction("Target directory invalid or does not exist: " + m_targetDir, EventCategory::AutoSaveImage,
+                         EventLevel::Error);
+    return nullptr;
+  }
+
+  QString targetDir = m_targetDir;
+  auto pipeline = new IngestPipeline(targetDir, this);
+  pipeline->setMaxFileSize(qint64(m_maxSizeMB) * 1024 * 1024);
+  pipeline->setParanoid(m_paranoidValidation);
+  pipeline->setClaimFunc(
+      [this](const QByteArray& checksum) { return !findDuplicate(checksum) && m_index.reserve(checksum); });
+  pipeline->setNameFunc([this, targetDir, usedNames = QSet<QString>()](const IngestItem& item) mutable {
+    QFileInfo source(item.sourcePath);
+    QString name = targetFileName(source.fileName(), item.checksum);
+    // Files from different folders may share a name and a timestamp
+    for (int i = 1; usedNames.contains(name) || QFile::exists(QDir(targetDir).filePath(name)); ++i) {
+      QString suffix = source.suffix().isEmpty() ? QString() : "." + source.suffix();
+      name = targetFileName(QString("%1_%2%3").arg(source.completeBaseName()).arg(i).arg(suffix), item.checksum);
+    }
+    usedNames.insert(name);
+    // The copy lands on disk before the batch is indexed; the directory watcher leaves it alone
+    m_pendingIngestPaths.insert(QDir(targetDir).filePath(name));
+    return name;
+  });
+
+  if (m_useBlobStore) {
+    BlobStore store(targetDir);
+    pipeline->setCopyFunc([store](const IngestItem& item, const QString& destination, QString* error) {
+      return store.store(item.sourcePath, item.checksum, destination, error) != BlobStore::LinkKind::Failed;
+    });
+  } else {
+    // Sources are the user's files: reflink where possible, never hardlink
+    pipeline->setCopyFunc([](const IngestItem& item, const QString& destination, QString*) {
+      return BlobStore::cloneFile(item.sourcePath, destination, false) != BlobStore::LinkKind::Failed;
+    });
+  }
+
+  // The whole batch goes into the indexes at once; callers connect their own reporting after this
+  connect(pipeline, &IngestPipeline::finished, this, [this, targetDir](const IngestSummary& summary) {
+    QList<ChecksumIndex::Entry> entries;
+    QList<ImageMetadata> metadata;
+    QDateTime now = QDateTime::currentDateTime();
+    for (const IngestItem& item : summary.items) {
+      if (!item.fileName.isEmpty()) m_pendingIngestPaths.remove(QDir(targetDir).filePath(item.fileName));
+      if (item.status == IngestItem::Copied) {
+        entries.append({item.fileName, item.checksum, item.size, now.toSecsSinceEpoch()});
+        metadata.append({item.fileName, item.imageSize.width(), item.imageSize.height(), item.format, item.size,
+                         item.sourcePath, QByteArray(), now.toMSecsSinceEpoch()});
+      } else if (item.status == IngestItem::Failed && !item.fileName.isEmpty()) {
+        // Release the reservation so a later copy can retry
+        m_index.release(item.checksum);
+        qDebug() << "Batch copy failed:" << item.sourcePath << item.error;
+      }
+    }
+    appendChecksums(entries, targetDir);
+    appendMetadata(metadata, targetDir);
+  });
+  return pipeline;
+}
+
+IngestPipeline* AutoSaveWidget::ingestLocalFiles(const QStringList& paths, int queuedUrlCount) {
+  IngestPipeline* pipeline = createIngestPipeline();
+  if (!pipeline) return nullptr;
+
+  connect(pipeline, &IngestPipeline::finished, this, [this, pipeline, queuedUrlCount](const IngestSummary& summary) {
+    QString message = QString("Batch of %1 file(s): %2 saved (%3), %4 duplicate(s), %5 skipped, %6 failed.")
+                          .arg(summary.items.size())
+                          .arg(summary.copied)
+                          .arg(utils::formatSize(summary.bytesCopied))
+                          .arg(summary.duplicates)
+                          .arg(summary.invalid + summary.tooLarge)
+                          .arg(summary.failed);
+    if (queuedUrlCount > 0) {
+      message += QString(" %1 URL(s) queued for download.").arg(queuedUrlCount);
+    }
+    m_manager->logAction(message, EventCategory::AutoSaveImage,
+                         summary.failed > 0 ? EventLevel::Warning : EventLevel::Info);
+    pipeline->deleteLater();
+  });
+
+  pipeline->start(paths);
+  return pipeline;
+}
+
+void AutoSaveWidget::onImportFolderClicked() {
+  if (m_isBusy) return;
+  QString dir = QFileDialog::getExistingDirectory(this, "Select Folder to Import",
+                                                  QStandardPaths::writableLocation(QStandardPaths::PicturesLocation));
+  if (dir.isEmpty()) return;
+  QString target = QDir::cleanPath(m_targetDir);
+  QString source = QDir::cleanPath(dir);
+  if (source == target || source.startsWith(target + "/")) {
+    m_manager->logAction("The folder is already part of the target directory: " + dir, EventCategory::AutoSaveImage,
+                         EventLevel::Warning);
+    return;
+  }
+
+  IngestPipeline* pipeline = createIngestPipeline();
+  if (!pipeline) return;
+
+  // A large tree takes hours; the import only appends to the index, as a save does
+  setBusy(true, true);
+  m_progressBar->setRange(0, 0);
+  m_progressBar->setFormat("Importing...");
+  m_progressBar->setVisible(true);
+  m_cancelJobButton->setEnabled(true);
+  m_cancelJobButton->setVisible(true);
+  connect(m_cancelJobButton, &QPushButton::clicked, pipeline, &IngestPipeline::cancel);
+
+  // Polled rather than signalled: the workers only bump counters
+  qint64 startedAt = QDateTime::currentMSecsSinceEpoch();
+  auto rateText = [startedAt](const IngestStats& stats) {
+    double seconds = qMax<qint64>(1, QDateTime::currentMSecsSinceEpoch() - startedAt) / 1000.0;
+    return QString("%1 files/s, %2 MB/s")
+        .arg(stats.hashed / seconds, 0, 'f', 1)
+        .arg(stats.bytesHashed / seconds / 1024.0 / 1024.0, 0, 'f', 1);
+  };
+  auto statsTimer = new QTimer(pipeline);
+  statsTimer->setInterval(500);
+  connect(statsTimer, &QTimer::timeout, this, [this, pipeline, rateText]() {
+    IngestStats stats = pipeline->stats();
+    m_progressBar->setRange(0, qMax(1, stats.found));
+    m_progressBar->setValue(stats.hashed);
+    m_progressBar->setFormat(QString("Importing: %1/%2 hashed, %3 new (%4)")
+                                 .arg(stats.hashed)
+                                 .arg(stats.found)
+                                 .arg(stats.copied)
+                                 .arg(rateText(stats)));
+  });
+  statsTimer->start();
+
+  connect(pipeline, &IngestPipeline::finished, this, [this, pipeline, dir, rateText](const IngestSummary& summary) {
+    m_progressBar->setVisible(false);
+    setBusy(false);
+    QString message =
+        QString("%1: %2 of %3 file(s) saved (%4), %5 duplicate(s), %6 skipped, %7 failed in %8 ms (%9).")
+            .arg(summary.canceled ? "Import of " + dir + " canceled" : "Imported " + dir)
+            .arg(summary.copied)
+            .arg(summary.items.size())
+            .arg(utils::formatSize(summary.bytesCopied))
+            .arg(summary.duplicates)
+            .arg(summary.invalid + summary.tooLarge)
+            .arg(summary.failed)
+            .arg(summary.elapsedMs)
+            .arg(rateText(pipeline->stats()));
+    m_manager->logAction(message, EventCategory::AutoSaveImage,
+                         summary.failed > 0 ? EventLevel::Warning : EventLevel::Info);
+    pipeline->deleteLater();
+  });
+
+  pipeline->startTree(dir);
+}
+
+QString AutoSaveWidget::targetFileName(const QString& originalName, const QByteArray& checksum) const {
+  QDateTime now = QDateTime::currentDateTime();
+  QString timestamp = now.toString("yyyyMMdd_HHmmss_zzz");
+  QString namePart = originalName.isEmpty() ? "clipboard.jpg" : originalName;
+  return archivelayout::relativePath(m_layout, timestamp + "_" + namePart, checksum, now);
+}
+
 bool AutoSaveWidget::processTextContent() {
   if (!m_manager->hasText()) {
     return false;
@@ -408,7 +1346,7 @@ bool AutoSaveWidget::processTextContent() {
   qDebug() << "Checking text content" << text;
   QUrl url(text);
 
-  bool handled = handleRemoteUrl(url, m_manager->latestImage());
+  bool handled = handleRemoteUrl(url, m_manager->latestImage(), DownloadQueue::High);
   if (handled) {
     return true;
   }
@@ -427,7 +1365,22 @@ bool AutoSaveWidget::processImageContent() {
   return saveImage(image);
 }
 
-bool AutoSaveWidget::handleRemoteUrl(const QUrl& url, const QImage& fallbackImage) {
+void AutoSaveWidget::restoreDownloads() {
+  if (!m_restorePending || !m_isEnabled) return;
+  m_restorePending = false;
+
+  const QList<DownloadJournal::Entry> entries = m_downloadQueue->openJournal();
+  if (entries.isEmpty()) return;
+  // Queued again in their old order and priority; each continues from what it had received.
+  // The log line below is their one notification, progress is in the downloads list.
+  for (const DownloadJournal::Entry& entry : entries) {
+    handleRemoteUrl(entry.url, QImage(), entry.priority, false);
+  }
+  m_manager->logAction(QString("Resuming %1 download(s) left unfinished by the last session.").arg(entries.size()),
+                       EventCategory::AutoSaveImage, EventLevel::Info);
+}
+
+bool AutoSaveWidget::handleRemoteUrl(const QUrl& url, const QImage& fallbackImage, int priority, bool notify) {
   if (!(url.isValid() && (url.scheme() == "http" || url.scheme() == "https"))) {
     return false;
   }
@@ -439,15 +1392,24 @@ bool AutoSaveWidget::handleRemoteUrl(const QUrl& url, const QImage& fallbackImag
     fileName = "download";
   }
 
-  QPointer<Notification> notification =
-      NotificationManager::instance()->showProgressNotification("Downloading", fileName, EventLevel::Info);
+  QPointer<Notification> notification;
+  if (notify) {
+    notification = NotificationManager::instance()->showProgressNotification("Downloading", fileName, EventLevel::Info);
+  }
   if (notification) {
     notification->cancelExpiration();
   }
 
   int downloadId = m_downloadModel->addQueuedDownload(url);
 
-  m_downloadQueue->enqueue(
+  // Revalidate instead of downloading again, but only while the archived copy is still where dedup looks
+  UrlCache::Entry cached = m_urlCache.find(url);
+  DownloadQueue::Validators validators;
+  if (cached.isValid() && findDuplicate(cached.checksum)) {
+    validators = {cached.etag, cached.lastModified};
+  }
+
+  DownloadHandle handle = m_downloadQueue->enqueue(
       url, [this, downloadId]() { m_downloadModel->setConnecting(downloadId); },
       [this, downloadId, notification](qint64 bytesReceived, qint64 bytesTotal) {
         m_downloadModel->updateProgress(downloadId, bytesReceived, bytesTotal);
@@ -456,8 +1418,59 @@ bool AutoSaveWidget::handleRemoteUrl(const QUrl& url, const QImage& fallbackImag
           notification->setProgress(progress);
         }
       },
-      [this, downloadId, url, notification, fallbackImage](const QByteArray& data, bool success,
-                                                           const QString& errorString) {
+      [this, downloadId, url, notification, fallbackImage, priority, notify](const QByteArray& data, bool success,
+                                                                             const QString& errorString,
+                                                                             const DownloadQueue::Response& response) {
+        m_downloadHandles.remove(downloadId);
+
+        if (response.notModified) {
+          QString location;
+          QByteArray checksum = m_urlCache.find(url).checksum;
+          if (findDuplicate(checksum, &location)) {
+            m_downloadModel->setNotModified(downloadId);
+            if (notification) {
+              notification->setHasProgress(false);
+              notification->startExpiration(2000);
+            }
+            m_manager->logAction(QString("%1 not modified, %2. Skipping download.").arg(url.toString(), location),
+                                 EventCategory::AutoSaveImage, EventLevel::Info);
+            return;
+          }
+          // Removed from the archive while the request was out: without the archived copy to
+          // go by, this enqueues it without validators
+          m_downloadModel->setNotModified(downloadId);
+          if (notification) {
+            notification->setHasProgress(false);
+            notification->startExpiration(0);
+          }
+          m_manager->logAction("Cached copy of " + url.toString() + " is gone; downloading it again.",
+                               EventCategory::AutoSaveImage, EventLevel::Info);
+          handleRemoteUrl(url, fallbackImage, priority, notify);
+          return;
+        }
+
+        if (errorString == DownloadQueue::kCanceledError) {
+          m_downloadModel->setCanceled(downloadId);
+          if (notification) {
+            notification->setHasProgress(false);
+            notification->startExpiration(0);
+          }
+          m_manager->logAction("Download canceled: " + url.toString(), EventCategory::AutoSaveImage,
+                               EventLevel::Info);
+          return;
+        }
+
+        if (errorString == DownloadQueue::kRejectedError) {
+          m_downloadModel->setRejected(downloadId);
+          qDebug() << "Download stopped early, not an image:" << url.toString();
+          if (notification) {
+            notification->setHasProgress(false);
+            notification->startExpiration(2000);
+          }
+          if (!fallbackImage.isNull()) saveImage(fallbackImage);
+          return;
+        }
+
         m_downloadModel->setFinished(downloadId, success);
 
         if (!success) {
@@ -478,12 +1491,20 @@ bool AutoSaveWidget::handleRemoteUrl(const QUrl& url, const QImage& fallbackImag
 
         qDebug() << "Downloaded data size:" << data.size() << "byte(s) from" << url.toString();
 
-        if (!QImage::fromData(data).isNull()) {
+        ImageHeaderInfo header = imagevalidator::validateData(data, m_paranoidValidation);
+        if (header.valid) {
           QTemporaryFile tempFile;
           if (tempFile.open()) {
             tempFile.write(data);
             tempFile.close();
-            saveImage(tempFile, url.fileName(), url.toString());
+            if (saveImage(tempFile, url.fileName(), url.toString())) {
+              QByteArray checksum = QCryptographicHash::hash(data, QCryptographicHash::Md5);
+              QString error;
+              if (!m_urlCache.insert(url, {checksum, response.validators.etag, response.validators.lastModified},
+                                     &error)) {
+                qDebug() << "Failed to update URL cache:" << error;
+              }
+            }
 
             if (notification) {
               notification->setHasProgress(false);
@@ -494,7 +1515,7 @@ bool AutoSaveWidget::handleRemoteUrl(const QUrl& url, const QImage& fallbackImag
             qDebug() << "Failed to create temp file for URL image";
           }
         } else {
-          qDebug() << "Downloaded data is not a valid image";
+          qDebug() << "Downloaded data is not a valid image:" << header.error;
         }
 
         if (!fallbackImage.isNull()) {
@@ -506,7 +1527,9 @@ bool AutoSaveWidget::handleRemoteUrl(const QUrl& url, const QImage& fallbackImag
           notification->setHasProgress(false);
           notification->startExpiration(2000);
         }
-      });
+      },
+      priority, validators);
+  m_downloadHandles.insert(downloadId, handle);
 
   return true;
 }
@@ -515,10 +1538,10 @@ bool AutoSaveWidget::handleLocalPath(const QString& path) {
   QFileInfo fi(path);
   if (fi.exists() && fi.isFile()) {
     qDebug() << "Text identifies a file" << path;
-    QImageReader reader(path);
-    if (reader.canRead()) {
-      qint64 size = fi.size();
-      if (size > m_maxSizeMB * 1024 * 1024) {
+    qint64 size = fi.size();
+    if (size > m_maxSizeMB * 1024 * 1024) {
+      // Only report oversized files that look like images
+      if (imagevalidator::validateFile(path).valid) {
         qDebug() << "File size exceeds limit" << size;
         m_manager->logAction(QString("File size (%1 MB) exceeds limit (%2 MB): %3")
                                  .arg(size / 1024.0 / 1024.0, 0, 'f', 2)
@@ -526,24 +1549,24 @@ bool AutoSaveWidget::handleLocalPath(const QString& path) {
                                  .arg(path),
                              EventCategory::AutoSaveImage, EventLevel::Warning);
         return true;  // Found valid image file but skipped due to size
-      } else {
-        QImage img = reader.read();
-        if (!img.isNull()) {
-          qDebug() << "Image loaded from file" << path;
-          QFile file(path);
-          return saveImage(file, fi.fileName(), path);
-        } else {
-          qDebug() << "Failed to load image from file" << path;
-        }
       }
+      return false;
+    }
+
+    ImageHeaderInfo header = imagevalidator::validateFile(path, m_paranoidValidation);
+    if (header.valid) {
+      qDebug() << "Image header validated" << path << header.format << header.size;
+      QFile file(path);
+      return saveImage(file, fi.fileName(), path);
     } else {
-      qDebug() << "QImageReader cannot read file" << path;
+      qDebug() << "Not a valid image file" << path << header.error;
     }
   }
   return false;
 }
 
-bool AutoSaveWidget::saveImage(QFile& file, const QString& originalName, const QString& source) {
+bool AutoSaveWidget::saveImage(QFile& file, const QString& originalName, const QString& source,
+                               const QImage& decoded) {
   qDebug() << "Processing save for:" << source << originalName;
 
   if (m_targetDir.isEmpty() || !QDir(m_targetDir).exists()) {
@@ -582,26 +1605,47 @@ bool AutoSaveWidget::saveImage(QFile& file, const QString& originalName, const Q
     return false;
   }
 
-  if (m_seenChecksums.contains(checksum)) {
-    qDebug() << "Duplicate image detected (checksum match). Skipping." << source;
-    m_manager->logAction(QString("Duplicate image detected for %1. Skipping save.").arg(source),
+  QString duplicateLocation;
+  // With the blob store a repeated copy only costs a new name
+  bool linkDuplicate = m_useBlobStore && m_index.contains(checksum) && m_blobStore.contains(checksum);
+  if (!linkDuplicate && findDuplicate(checksum, &duplicateLocation)) {
+    qDebug() << "Duplicate image detected (checksum match). Skipping." << source << duplicateLocation;
+    m_manager->logAction(QString("Duplicate image detected for %1 (%2). Skipping save.").arg(source, duplicateLocation),
                          EventCategory::AutoSaveImage, EventLevel::Warning);
     return true;  // yes, TRUE
   }
 
   // Generate Destination Filename
-  QString timestamp = QDateTime::currentDateTime().toString("yyyyMMdd_HHmmss_zzz");
-  QString namePart = originalName.isEmpty() ? "clipboard.jpg" : originalName;
-  QString filename = timestamp + "_" + namePart;
+  QString filename = targetFileName(originalName, checksum);
   QString fullPath = QDir(m_targetDir).filePath(filename);
+  QDir(m_targetDir).mkpath(QFileInfo(filename).path());
 
   // Copy file
-  if (file.copy(fullPath)) {
-    qDebug() << "Image copied successfully to" << fullPath;
-    m_seenChecksums.insert(checksum);
-    appendChecksum(filename, checksum);
-    m_manager->logAction(QString("%1 -> %2 (%3)").arg(source, fullPath, utils::formatSize(imageSize)),
-                         EventCategory::AutoSaveImage, EventLevel::Info);
+  bool copied = false;
+  QString how;
+  if (m_useBlobStore) {
+    QString error;
+    BlobStore::LinkKind kind = m_blobStore.store(file.fileName(), checksum, fullPath, &error);
+    copied = kind != BlobStore::LinkKind::Failed;
+    how = linkDuplicate ? QString("duplicate, %1").arg(BlobStore::toString(kind)) : BlobStore::toString(kind);
+    if (!copied) qDebug() << "Blob store failed:" << error;
+  } else {
+    copied = file.copy(fullPath);
+  }
+
+  if (copied) {
+    qDebug() << "Image copied successfully to" << fullPath << how;
+    QDateTime now = QDateTime::currentDateTime();
+    appendChecksums({{filename, checksum, imageSize, now.toSecsSinceEpoch()}});
+    // A header read; the pixels are only hashed when they were decoded anyway
+    ImageHeaderInfo header = imagevalidator::validateFile(fullPath);
+    appendMetadata({{filename, header.size.width(), header.size.height(), header.format, imageSize, source,
+                     QByteArray(), now.toMSecsSinceEpoch()}});
+    if (!decoded.isNull()) hashPixels(m_targetDir, filename, decoded);
+    QString sizeText = utils::formatSize(imageSize);
+    if (!how.isEmpty()) sizeText += ", " + how;
+    m_manager->logAction(QString("%1 -> %2 (%3)").arg(source, fullPath, sizeText), EventCategory::AutoSaveImage,
+                         EventLevel::Info);
     return true;
   } else {
     qDebug() << "Failed to copy image to" << fullPath;
@@ -623,7 +1667,7 @@ bool AutoSaveWidget::saveImage(const QImage& image) {
   if (tempFile.open()) {
     image.save(&tempFile, "JPG");
     tempFile.close();
-    return saveImage(tempFile, "clipboard.jpg", "<Clipboard Image>");
+    return saveImage(tempFile, "clipboard.jpg", "<Clipboard Image>", image);
   } else {
     qDebug() << "Failed to create temp file for clipboard image";
     m_manager->logAction("Failed to create temp file for clipboard image", EventCategory::AutoSaveImage,
@@ -632,12 +1676,52 @@ bool AutoSaveWidget::saveImage(const QImage& image) {
   }
 }
 
+void AutoSaveWidget::hashPixels(const QString& dir, const QString& path, const QImage& image) {
+  // A format conversion plus MD5 over every pixel: too slow for the GUI thread on large screenshots
+  auto watcher = new QFutureWatcher<QByteArray>(this);
+  connect(watcher, &QFutureWatcherBase::finished, this, [this, watcher, dir, path]() {
+    QByteArray hash = watcher->result();
+    watcher->deleteLater();
+    if (hash.isEmpty()) return;
+
+    // Still held back by a rewrite of the directory
+    if (dir == m_rewriteDir) {
+      for (ImageMetadata& item : m_heldMetadata) {
+        if (item.path != path) continue;
+        item.pixelHash = hash;
+        return;
+      }
+    }
+    int row = m_metadata.dir() == dir ? m_metadata.rowOf(path) : -1;
+    if (row < 0) return;
+    ImageMetadata item = m_metadata.at(row);
+    item.pixelHash = hash;
+    appendMetadata({item});
+  });
+  watcher->setFuture(QtConcurrent::run(&MetadataIndex::pixelHash, image));
+}
+
 void AutoSaveWidget::loadSettings() {
   auto settings = m_manager->settingsManager();
   m_isEnabled = settings->autoSaveEnabled();
   m_targetDir = settings->autoSavePath();
   m_recentPaths = settings->recentAutoSavePaths();
   m_maxSizeMB = settings->autoSaveMaxSizeMB();
+  m_paranoidValidation = settings->autoSaveParanoidValidation();
+  m_useBlobStore = settings->autoSaveBlobStore();
+  m_quotaMB = settings->autoSaveQuotaMB();
+  m_quotaFiles = settings->autoSaveQuotaFiles();
+  m_evictionPolicy = settings->autoSaveEvictionPolicy();
+  m_scrubEnabled = settings->autoSaveScrubEnabled();
+  m_scrubBandwidthMB = settings->autoSaveScrubBandwidthMB();
+  m_layout = settings->autoSaveLayout();
+  m_dedupScope = settings->autoSaveDedupScope();
+  m_watchFolders = settings->autoSaveWatchFolders();
+  m_downloadConcurrency = settings->downloadConcurrency();
+  m_downloadsPerHost = settings->downloadsPerHost();
+  m_downloadBandwidthKB = settings->downloadBandwidthKB();
+  m_perDownloadBandwidthKB = settings->perDownloadBandwidthKB();
+  m_pauseOnForegroundTraffic = settings->downloadPauseOnForegroundTraffic();
 
   qDebug() << "Settings loaded. Enabled:" << m_isEnabled << "Path:" << m_targetDir << "MaxMB:" << m_maxSizeMB;
 
@@ -653,6 +1737,26 @@ void AutoSaveWidget::loadSettings() {
   }
 
   m_maxSizeSpinBox->setValue(m_maxSizeMB);
+  m_paranoidCheckBox->setChecked(m_paranoidValidation);
+  m_blobStoreCheckBox->setChecked(m_useBlobStore);
+  m_quotaSizeSpinBox->setValue(m_quotaMB);
+  m_quotaFilesSpinBox->setValue(m_quotaFiles);
+  m_evictionCombo->setCurrentIndex(qMax(0, m_evictionCombo->findData((int)m_evictionPolicy)));
+  m_scrubCheckBox->setChecked(m_scrubEnabled);
+  m_scrubBandwidthSpinBox->setValue(m_scrubBandwidthMB);
+  m_scrubber->setBandwidthLimit(qint64(m_scrubBandwidthMB) * 1024 * 1024);
+  m_layoutCombo->setCurrentIndex(qMax(0, m_layoutCombo->findData((int)m_layout)));
+  m_dedupCombo->setCurrentIndex(qMax(0, m_dedupCombo->findData((int)m_dedupScope)));
+  updateWatchFolders();
+  m_downloadConcurrencySpinBox->setValue(m_downloadConcurrency);
+  m_downloadsPerHostSpinBox->setValue(m_downloadsPerHost);
+  m_downloadBandwidthSpinBox->setValue(m_downloadBandwidthKB);
+  m_perDownloadBandwidthSpinBox->setValue(m_perDownloadBandwidthKB);
+  m_pauseOnForegroundCheckBox->setChecked(m_pauseOnForegroundTraffic);
+  m_downloadQueue->setMaxConcurrent(m_downloadConcurrency);
+  m_downloadQueue->setMaxPerHost(m_downloadsPerHost);
+  m_downloadQueue->setRateLimit({qint64(m_downloadBandwidthKB) * 1024, qint64(m_perDownloadBandwidthKB) * 1024});
+  m_downloadQueue->setPauseOnForegroundTraffic(m_pauseOnForegroundTraffic && netstats::isAvailable());
 
   // Update state
   m_pathCombo->setEnabled(m_isEnabled);
@@ -664,6 +1768,21 @@ void AutoSaveWidget::saveSettings() {
   settings->setAutoSaveEnabled(m_isEnabled);
   settings->setAutoSavePath(m_targetDir);
   settings->setAutoSaveMaxSizeMB(m_maxSizeMB);
+  settings->setAutoSaveParanoidValidation(m_paranoidValidation);
+  settings->setAutoSaveBlobStore(m_useBlobStore);
+  settings->setAutoSaveQuotaMB(m_quotaMB);
+  settings->setAutoSaveQuotaFiles(m_quotaFiles);
+  settings->setAutoSaveEvictionPolicy(m_evictionPolicy);
+  settings->setAutoSaveScrubEnabled(m_scrubEnabled);
+  settings->setAutoSaveScrubBandwidthMB(m_scrubBandwidthMB);
+  settings->setAutoSaveLayout(m_layout);
+  settings->setAutoSaveDedupScope(m_dedupScope);
+  settings->setAutoSaveWatchFolders(m_watchFolders);
+  settings->setDownloadConcurrency(m_downloadConcurrency);
+  settings->setDownloadsPerHost(m_downloadsPerHost);
+  settings->setDownloadBandwidthKB(m_downloadBandwidthKB);
+  settings->setPerDownloadBandwidthKB(m_perDownloadBandwidthKB);
+  settings->setDownloadPauseOnForegroundTraffic(m_pauseOnForegroundTraffic);
 }
 
 QByteArray AutoSaveWidget::calculateChecksum(QIODevice* device) {
@@ -680,40 +1799,421 @@ QByteArray AutoSaveWidget::calculateChecksum(QIODevice* device) {
 }
 
 void AutoSaveWidget::loadChecksums() {
-  m_seenChecksums.clear();
+  m_scrubber->stop();
+  m_index.clear();
+  m_metadata.clear();
+  m_blobStore.setRootDir(m_targetDir);
+  m_dirWatcher->setRoot(m_targetDir);
+  updateWatchFolders();
   if (m_targetDir.isEmpty()) return;
 
-  QFile file(QDir(m_targetDir).filePath(kChecksumFileName));
-  if (file.open(QIODevice::ReadOnly | QIODevice::Text)) {
-    QTextStream in(&file);
-    while (!in.atEnd()) {
-      QString line = in.readLine();
-      int splitIndex = line.indexOf(": ");
-      if (splitIndex != -1) {
-        QString hashHex = line.mid(splitIndex + 2).trimmed();
-        m_seenChecksums.insert(QByteArray::fromHex(hashHex.toUtf8()));
+  QString error;
+  bool loaded = m_index.load(m_targetDir, &error);
+  if (!loaded) {
+    qDebug() << "loadChecksums: Failed to open checksums.txt" << error;
+    m_manager->logAction("Failed to load checksums: " + error, EventCategory::AutoSaveImage, EventLevel::Warning);
+  }
+  qDebug() << "Loaded" << m_index.size() << "checksums";
+
+  // checksums.txt is the source of truth for its directory
+  if (loaded || !QFile::exists(QDir(m_targetDir).filePath(ChecksumIndex::kFileName))) {
+    if (!m_contentIndex.syncDirectory(m_targetDir, m_index.entries(), &error)) {
+      qDebug() << "loadChecksums: Failed to write content index" << error;
+    }
+  }
+
+  if (!m_metadata.load(m_targetDir, &error)) {
+    qDebug() << "loadChecksums: Failed to load metadata" << error;
+  }
+  // Files dropped by Clean or Rebuild while another directory was selected. Without the
+  // index every row would look stale, and the removal is journaled for good.
+  if (loaded) {
+    QStringList stale;
+    for (int row : m_metadata.filter([this](int row) { return !m_index.containsPath(m_metadata.path(row)); })) {
+      stale.append(m_metadata.path(row));
+    }
+    m_metadata.remove(stale);
+  }
+
+  m_galleryModel->setEntries(m_targetDir, m_index.entries());
+  updateUsageLabel();
+  updateScrubLabel();
+  backfillSizes();
+  backfillMetadata();
+}
+
+void AutoSaveWidget::backfillMetadata() {
+  // Files indexed without going through a save (watcher, Rebuild, older archives) get their
+  // header read once; the source and pixel hash of those are unknown
+  QList<ChecksumIndex::Entry> missing;
+  const QList<ChecksumIndex::Entry> entries = m_index.entries();
+  for (const ChecksumIndex::Entry& entry : entries) {
+    if (!m_metadata.contains(entry.path)) missing.append(entry);
+  }
+  if (missing.isEmpty()) return;
+
+  QString targetDir = m_targetDir;
+  auto watcher = new QFutureWatcher<QList<ImageMetadata>>(this);
+  connect(watcher, &QFutureWatcherBase::finished, this, [this, watcher, targetDir]() {
+    QList<ImageMetadata> items;
+    for (const ImageMetadata& item : watcher->result()) {
+      // Saved or removed in the meantime
+      if (!m_metadata.contains(item.path) && m_index.containsPath(item.path)) items.append(item);
+    }
+    watcher->deleteLater();
+    if (targetDir != m_metadata.dir()) return;
+    appendMetadata(items);
+  });
+  watcher->setFuture(QtConcurrent::run([targetDir, missing]() {
+    QList<ImageMetadata> items;
+    QDir dir(targetDir);
+    for (const ChecksumIndex::Entry& entry : missing) {
+      QImageReader reader(dir.filePath(entry.path));
+      QSize size = reader.size();
+      items.append({entry.path, size.width(), size.height(), reader.format(), entry.size, QString(), QByteArray(),
+                    entry.savedAt * 1000});
+    }
+    return items;
+  }));
+}
+
+void AutoSaveWidget::backfillSizes() {
+  if (m_index.unknownSizeCount() == 0) {
+    maybeEvict();
+    return;
+  }
+
+  // Entries written before sizes were recorded are measured once, then persisted
+  QStringList paths;
+  const QList<ChecksumIndex::Entry> entries = m_index.entries();
+  for (const ChecksumIndex::Entry& entry : entries) {
+    if (entry.size < 0) paths.append(entry.path);
+  }
+
+  QString targetDir = m_targetDir;
+  auto watcher = new QFutureWatcher<QHash<QString, qint64>>(this);
+  connect(watcher, &QFutureWatcherBase::finished, this, [this, watcher, targetDir]() {
+    const QHash<QString, qint64> sizes = watcher->result();
+    watcher->deleteLater();
+    if (targetDir != m_index.dir()) return;
+
+    for (auto it = sizes.cbegin(); it != sizes.cend(); ++it) {
+      m_index.setSize(it.key(), it.value());
+    }
+    // Measured again after the reload that ends the rewrite
+    if (m_rewriteDir == targetDir) return;
+    QString error;
+    if (!m_index.save(&error)) {
+      qDebug() << "backfillSizes: Failed to write checksums file" << error;
+    }
+    updateUsageLabel();
+    maybeEvict();
+  });
+  watcher->setFuture(QtConcurrent::run([targetDir, paths]() {
+    QHash<QString, qint64> sizes;
+    QDir dir(targetDir);
+    for (const QString& path : paths) {
+      QFileInfo fi(dir.filePath(path));
+      if (fi.isFile()) sizes.insert(path, fi.size());
+    }
+    return sizes;
+  }));
+}
+
+void AutoSaveWidget::updateUsageLabel() {
+  QString text = QString("Usage: %1 in %2 file(s)").arg(utils::formatSize(m_index.totalBytes())).arg(m_index.size());
+  if (m_index.unknownSizeCount() > 0) {
+    text += " (measuring...)";
+  }
+  archivequota::Quota quota{qint64(m_quotaMB) * 1024 * 1024, m_quotaFiles};
+  if (quota.isExceeded(m_index.totalBytes(), m_index.size())) {
+    text += m_isEvicting ? " - evicting..." : " - over quota";
+  }
+  m_usageLabel->setText(text);
+}
+
+void AutoSaveWidget::maybeEvict() {
+  archivequota::Quota quota{qint64(m_quotaMB) * 1024 * 1024, m_quotaFiles};
+  if (m_isEvicting || m_isBusy || m_targetDir.isEmpty() || m_index.unknownSizeCount() > 0) return;
+  if (!quota.isExceeded(m_index.totalBytes(), m_index.size())) return;
+
+  m_isEvicting = true;
+  updateUsageLabel();
+
+  QString targetDir = m_targetDir;
+  EvictionPolicy policy = m_evictionPolicy;
+  auto watcher = new QFutureWatcher<archivequota::EvictionResult>(this);
+  connect(watcher, &QFutureWatcherBase::finished, this, [this, watcher, targetDir]() {
+    archivequota::EvictionResult result = watcher->result();
+    watcher->deleteLater();
+    m_isEvicting = false;
+    if (targetDir == m_index.dir()) {
+      forgetPaths(result.removed);
+    }
+    updateUsageLabel();
+
+    m_manager->logAction(QString("Quota exceeded: evicted %1 file(s), freed %2. Time cost: %3 ms")
+                             .arg(result.removed.size())
+                             .arg(utils::formatSize(result.freedBytes))
+                             .arg(result.elapsedMs),
+                         EventCategory::AutoSaveImage, result.failed > 0 ? EventLevel::Warning : EventLevel::Info);
+    if (result.failed > 0) {
+      m_manager->logAction(QString("Failed to evict %1 file(s).").arg(result.failed), EventCategory::AutoSaveImage,
+                           EventLevel::Warning);
+    }
+  });
+  watcher->setFuture(QtConcurrent::run(&archivequota::evict, targetDir, m_index.entries(), quota, policy));
+}
+
+void AutoSaveWidget::forgetPaths(const QStringList& paths) {
+  m_galleryModel->removePaths(paths);
+  QStringList indexed;
+  QSet<QByteArray> checksums;
+  for (const QString& path : paths) {
+    if (!m_index.containsPath(path)) continue;
+    indexed.append(path);
+    checksums.insert(m_index.checksumFor(path));
+  }
+  if (indexed.isEmpty()) return;
+
+  // Appends drop lines rather than rewriting the files for every batch
+  QString error;
+  if (!m_index.drop(indexed, &error)) {
+    m_manager->logAction("Failed to write checksums file: " + error, EventCategory::AutoSaveImage, EventLevel::Error);
+  }
+  // Last name gone: the blob (if any) is unreferenced
+  for (const QByteArray& checksum : std::as_const(checksums)) {
+    if (!m_index.contains(checksum)) m_blobStore.release(checksum);
+  }
+  if (!m_contentIndex.drop(m_index.dir(), indexed, &error)) {
+    qDebug() << "Failed to write content index" << error;
+  }
+  m_metadata.remove(indexed);
+
+  qDebug() << "Dropped" << indexed.size() << "deleted file(s) from the index";
+  updateUsageLabel();
+}
+
+void AutoSaveWidget::importRecentDirectories() {
+  QStringList unknownDirs;
+  for (const QString& path : std::as_const(m_recentPaths)) {
+    if (!m_contentIndex.hasDirectory(path) && QFile::exists(QDir(path).filePath(ChecksumIndex::kFileName))) {
+      unknownDirs.append(path);
+    }
+  }
+  if (unknownDirs.isEmpty()) return;
+
+  using DirEntries = QList<QPair<QString, QList<ChecksumIndex::Entry>>>;
+  auto watcher = new QFutureWatcher<DirEntries>(this);
+  connect(watcher, &QFutureWatcherBase::finished, this, [this, watcher]() {
+    const DirEntries result = watcher->result();
+    watcher->deleteLater();
+    for (const auto& dirEntries : result) {
+      // The current directory may have been loaded meanwhile
+      QString error;
+      if (!m_contentIndex.hasDirectory(dirEntries.first) &&
+          !m_contentIndex.syncDirectory(dirEntries.first, dirEntries.second, &error)) {
+        qDebug() << "importRecentDirectories: Failed to write content index" << error;
       }
     }
+    qDebug() << "Imported" << result.size() << "recent directories into the content index";
+  });
+  watcher->setFuture(QtConcurrent::run([unknownDirs]() {
+    DirEntries result;
+    for (const QString& dir : unknownDirs) {
+      QString error;
+      QList<ChecksumIndex::Entry> entries = ChecksumIndex::readFile(dir, &error);
+      if (error.isEmpty()) result.append({dir, entries});
+    }
+    return result;
+  }));
+}
+
+void AutoSaveWidget::pruneBlobs() {
+  if (!QDir(m_targetDir).exists(BlobStore::kDirName)) return;
+
+  QSet<QByteArray> live;
+  const QList<ChecksumIndex::Entry> entries = m_index.entries();
+  for (const ChecksumIndex::Entry& entry : entries) live.insert(entry.checksum);
+
+  // Downloads and ingest batches keep storing blobs meanwhile; prune() leaves the ones
+  // written after this snapshot alone
+  QDateTime liveAt = QDateTime::currentDateTime();
+  QString targetDir = m_targetDir;
+  auto watcher = new QFutureWatcher<qint64>(this);
+  connect(watcher, &QFutureWatcherBase::finished, this, [this, watcher]() {
+    qint64 freed = watcher->result();
+    watcher->deleteLater();
+    if (freed > 0) {
+      m_manager->logAction(QString("Released %1 of unreferenced blobs.").arg(utils::formatSize(freed)),
+                           EventCategory::AutoSaveImage, EventLevel::Info);
+    }
+  });
+  watcher->setFuture(QtConcurrent::run(&BlobStore::prune, targetDir, live, liveAt));
+}
+
+bool AutoSaveWidget::findDuplicate(const QByteArray& checksum, QString* location) {
+  if (m_index.contains(checksum)) {
+    if (location) *location = "already in " + m_targetDir;
+    return true;
+  }
+  if (m_dedupScope == DedupScope::CurrentDirectory) return false;
+
+  QSet<QString> dirs;
+  if (m_dedupScope == DedupScope::RecentPaths) {
+    for (const QString& path : std::as_const(m_recentPaths)) dirs.insert(QDir::cleanPath(path));
+  }
+  // Other directories are only reconciled when they are loaded again; a file deleted or moved
+  // there since must not keep this one from being saved
+  for (;;) {
+    ContentIndex::Location found =
+        m_dedupScope == DedupScope::RecentPaths ? m_contentIndex.find(checksum, dirs) : m_contentIndex.find(checksum);
+    if (found.dir.isEmpty()) return false;
+
+    QString foundPath = QDir(found.dir).filePath(found.path);
+    if (QFile::exists(foundPath)) {
+      if (location) *location = "already saved as " + foundPath;
+      return true;
+    }
+    qDebug() << "findDuplicate: Dropping stale content index entry" << foundPath;
+    QString error;
+    if (!m_contentIndex.drop(found.dir, {found.path}, &error)) {
+      qDebug() << "findDuplicate: Failed to write content index" << error;
+    }
+  }
+}
+
+void AutoSaveWidget::appendChecksums(const QList<ChecksumIndex::Entry>& entries, const QString& dir) {
+  if (entries.isEmpty()) return;
+
+  QString effectiveDir = dir.isEmpty() ? m_index.dir() : dir;
+  if (!m_rewriteDir.isEmpty() && effectiveDir == m_rewriteDir) {
+    // The worker would overwrite the append; known in memory now, written by endRewrite()
+    m_heldChecksums.append(entries);
+    if (effectiveDir == m_index.dir()) {
+      QList<ChecksumIndex::Entry> fresh;
+      for (const ChecksumIndex::Entry& entry : entries) {
+        if (m_index.checksumFor(entry.path) == entry.checksum) continue;
+        m_index.insert(entry);
+        fresh.append(entry);
+      }
+      m_galleryModel->addEntries(fresh);
+    }
+    return;
+  }
+
+  QString error;
+  if (!m_contentIndex.add(dir.isEmpty() ? m_index.dir() : dir, entries, &error)) {
+    qDebug() << "appendChecksums: Failed to append to content index" << error;
+  }
+
+  bool ok = false;
+  if (dir.isEmpty() || dir == m_index.dir()) {
+    QList<ChecksumIndex::Entry> fresh;
+    for (const ChecksumIndex::Entry& entry : entries) {
+      if (m_index.checksumFor(entry.path) != entry.checksum) fresh.append(entry);
+    }
+    ok = m_index.append(entries, &error);
+    m_galleryModel->addEntries(fresh);
   } else {
-    qDebug() << "loadChecksums: Failed to open checksums.txt" << file.errorString();
-    m_manager->logAction("Failed to load checksums: " + file.errorString(), EventCategory::AutoSaveImage,
-                         EventLevel::Warning);
+    // The target directory changed while a batch was running
+    ok = ChecksumIndex::appendFile(dir, entries, &error);
   }
-  qDebug() << "Loaded" << m_seenChecksums.size() << "checksums";
+  if (!ok) {
+    qDebug() << "appendChecksums: Failed to open checksums.txt for appending" << error;
+    m_manager->logAction("Failed to append checksum: " + error, EventCategory::AutoSaveImage, EventLevel::Error);
+  }
+  updateUsageLabel();
+  maybeEvict();
 }
 
-void AutoSaveWidget::appendChecksum(const QString& filename, const QByteArray& checksum) {
-  if (m_targetDir.isEmpty()) return;
+void AutoSaveWidget::appendMetadata(const QList<ImageMetadata>& items, const QString& dir) {
+  if (items.isEmpty()) return;
 
-  QFile file(QDir(m_targetDir).filePath(kChecksumFileName));
-  if (file.open(QIODevice::WriteOnly | QIODevice::Append | QIODevice::Text)) {
-    QTextStream out(&file);
-    out << filename << ": " << checksum.toHex() << "\n";
+  if (!m_rewriteDir.isEmpty() && (dir.isEmpty() ? m_metadata.dir() : dir) == m_rewriteDir) {
+    m_heldMetadata.append(items);
+    return;
+  }
+
+  QString error;
+  bool ok = false;
+  if (dir.isEmpty() || dir == m_metadata.dir()) {
+    ok = m_metadata.append(items, &error);
   } else {
-    qDebug() << "appendChecksum: Failed to open checksums.txt for appending" << file.errorString();
-    m_manager->logAction("Failed to append checksum: " + file.errorString(), EventCategory::AutoSaveImage,
-                         EventLevel::Error);
+    MetadataIndex other;
+    ok = other.load(dir, &error) && other.append(items, &error);
+  }
+  if (!ok) {
+    qDebug() << "appendMetadata: Failed to write metadata" << error;
+  }
+}
+
+void AutoSaveWidget::beginRewrite(const QString& dir) { m_rewriteDir = dir; }
+
+void AutoSaveWidget::endRewrite() {
+  QString dir = m_rewriteDir;
+  m_rewriteDir.clear();
+  QList<ChecksumIndex::Entry> checksums;
+  QList<ImageMetadata> metadata;
+  checksums.swap(m_heldChecksums);
+  metadata.swap(m_heldMetadata);
+
+  // The index was reloaded from the rewritten file; what arrived meanwhile goes on top
+  appendChecksums(checksums, dir);
+  appendMetadata(metadata, dir);
+  if (!checksums.isEmpty()) qDebug() << "Wrote" << checksums.size() << "entries held during the rewrite of" << dir;
+}
+
+void AutoSaveWidget::onDirectoryChanged(const QStringList& added, const QStringList& removed) {
+  if (m_isBusy) {
+    // Replayed by setBusy(false), against the index as the job left it; paths it already
+    // accounts for are skipped then
+    m_heldDirChanges.append({added, removed});
+    return;
+  }
+  if (m_dirWatcher->root() != QDir::cleanPath(m_index.dir())) return;
+
+  forgetPaths(removed);
+
+  // Our own saves are indexed already, and ingest batches index theirs when they finish;
+  // only files dropped in from outside are left
+  QDir root(m_index.dir());
+  auto isOurs = [this, root](const QString& path) {
+    return m_index.containsPath(path) || m_pendingIngestPaths.contains(root.filePath(path));
+  };
+  QStringList untracked;
+  for (const QString& path : added) {
+    if (ChecksumIndex::isInternalPath(path) || isOurs(path)) continue;
+    untracked.append(path);
   }
+
+  if (untracked.isEmpty()) return;
+
+  QString targetDir = m_index.dir();
+  auto watcher = new QFutureWatcher<QList<ChecksumIndex::Entry>>(this);
+  connect(watcher, &QFutureWatcherBase::finished, this, [this, watcher, targetDir, isOurs]() {
+    QList<ChecksumIndex::Entry> entries;
+    for (const ChecksumIndex::Entry& entry : watcher->result()) {
+      if (!isOurs(entry.path)) entries.append(entry);
+    }
+    watcher->deleteLater();
+    if (targetDir != m_index.dir() || entries.isEmpty()) return;
+
+    appendChecksums(entries);
+    backfillMetadata();
+    qDebug() << "Directory watcher: indexed" << entries.size() << "new file(s)";
+  });
+  watcher->setFuture(QtConcurrent::run([targetDir, untracked]() {
+    QList<ChecksumIndex::Entry> entries;
+    QDir dir(targetDir);
+    for (const QString& path : untracked) {
+      if (!imagevalidator::validateFile(dir.filePath(path)).valid) continue;
+      QByteArray checksum = IngestPipeline::fileChecksum(dir.filePath(path));
+      QFileInfo fi(dir.filePath(path));
+      if (!checksum.isEmpty()) entries.append({path, checksum, fi.size(), fi.lastModified().toSecsSinceEpoch()});
+    }
+    return entries;
+  }));
 }
 
 void AutoSaveWidget::onRebuildClicked() {
@@ -722,17 +2222,17 @@ void AutoSaveWidget::onRebuildClicked() {
     return;
   }
 
-  m_isRebuilding = true;
-  m_enableCheckBox->setEnabled(false);
-  m_pathCombo->setEnabled(false);
-  m_browseButton->setEnabled(false);
-  m_openDirButton->setEnabled(false);
-  m_cleanButton->setEnabled(false);
-  m_rebuildButton->setEnabled(false);
-  m_maxSizeSpinBox->setEnabled(false);
+  setBusy(true);
 
   QDir dir(m_targetDir);
-  QStringList files = dir.entryList(QDir::Files | QDir::NoDotAndDotDot);
+  QStringList files;
+  QDirIterator it(m_targetDir, QDir::Files | QDir::NoDotAndDotDot, QDirIterator::Subdirectories);
+  while (it.hasNext()) {
+    QString relativePath = dir.relativeFilePath(it.next());
+    // Internal state (checksums.txt, dot directories) is not part of the archive
+    if (ChecksumIndex::isInternalPath(relativePath)) continue;
+    files.append(relativePath);
+  }
   int totalFiles = files.size();
 
   // Create Progress Dialog - Rebuild Checksums
@@ -744,8 +2244,7 @@ void AutoSaveWidget::onRebuildClicked() {
   QElapsedTimer timer;
   timer.start();
 
-  m_seenChecksums.clear();
-  QFile file(dir.filePath(kChecksumFileName));
+  QFile file(dir.filePath(ChecksumIndex::kFileName));
   if (file.open(QIODevice::WriteOnly | QIODevice::Text | QIODevice::Truncate)) {
     QTextStream out(&file);
 
@@ -755,8 +2254,6 @@ void AutoSaveWidget::onRebuildClicked() {
         break;
       }
 
-      if (filename == kChecksumFileName) continue;
-
       // Update label with counts
       progress.setLabelText(QString("Processed %1 of %2 images").arg(processed).arg(totalFiles));
 
@@ -767,8 +2264,12 @@ void AutoSaveWidget::onRebuildClicked() {
           QByteArray checksum = calculateChecksum(&file);
           file.close();
           if (!checksum.isEmpty()) {
-            m_seenChecksums.insert(checksum);
-            out << filename << ": " << checksum.toHex() << "\n";
+            QFileInfo fi(file);
+            ChecksumIndex::Entry entry{filename, checksum, fi.size(), fi.lastModified().toSecsSinceEpoch()};
+            // Hashing cannot recover what a transcoded file was saved as
+            ChecksumIndex::Entry previous = m_index.entry(filename);
+            if (previous.checksum == checksum) entry.originalChecksum = previous.originalChecksum;
+            out << ChecksumIndex::formatLine(entry) << "\n";
           } else {
             m_manager->logAction("Failed to calculate checksum for file: " + filename, EventCategory::AutoSaveImage,
                                  EventLevel::Warning);
@@ -780,6 +2281,7 @@ void AutoSaveWidget::onRebuildClicked() {
       QCoreApplication::processEvents();
     }
     file.close();
+    loadChecksums();
 
     if (progress.wasCanceled()) {
       m_manager->logAction("Rebuild checksums canceled by user.", EventCategory::AutoSaveImage, EventLevel::Info);
@@ -792,8 +2294,5 @@ void AutoSaveWidget::onRebuildClicked() {
     m_manager->logAction("Failed to open checksums file for writing.", EventCategory::AutoSaveImage, EventLevel::Error);
   }
 
-  m_isRebuilding = false;
-  m_enableCheckBox->setEnabled(true);
-  // Restore enabled state based on checkbox
-  onToggleChanged(m_enableCheckBox->isChecked() ? Qt::Checked : Qt::Unchecked);
+  setBusy(false);
 }
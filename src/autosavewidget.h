@@ -2,9 +2,19 @@
 
 #include <QByteArray>
 #include <QHash>
+#include <QList>
 #include <QSet>
 #include <QWidget>
 
+#include "archivelayout.h"
+#include "archivequota.h"
+#include "blobstore.h"
+#include "checksumindex.h"
+#include "contentindex.h"
+#include "downloadqueue.h"
+#include "metadataindex.h"
+#include "urlcache.h"
+
 class ClipboardManager;
 class QCheckBox;
 class QComboBox;
@@ -17,8 +27,15 @@ class QFile;
 class QScrollArea;
 class QVBoxLayout;
 class QListView;
+class QTabWidget;
+class GalleryModel;
+class ThumbnailCache;
 class DownloadProgressModel;
-class DownloadQueue;
+class DirectoryWatcher;
+class Scrubber;
+class WatchFolderSource;
+class IngestPipeline;
+class QTimer;
 
 class AutoSaveWidget : public QWidget {
   Q_OBJECT
@@ -30,27 +47,75 @@ class AutoSaveWidget : public QWidget {
  private slots:
   void onToggleChanged(int state);
   void onMaxSizeChanged(int value);
+  void onParanoidToggled(bool checked);
+  void onBlobStoreToggled(bool checked);
+  void onLayoutChanged(int index);
+  void onMigrateClicked();
+  void onTranscodeClicked();
+  void onDedupScopeChanged(int index);
+  void onQuotaChanged();
+  void onScrubSettingsChanged();
+  void onAddWatchFolderClicked();
+  void onClearWatchFoldersClicked();
   void onBrowseClicked();
   void onOpenDirClicked();
   void onPathSelected(int index);
   void onCleanClicked();
+  void onCheckIndexClicked();
   void onRebuildClicked();
+  void onImportFolderClicked();
   void onClipboardChanged();
   void onClearFinishedClicked();
+  void onDownloadLimitsChanged();
+  void onDownloadContextMenu(const QPoint &pos);
 
  private:
   void setupUi();
-  bool saveImage(QFile &file, const QString &originalName = QString(), const QString &source = QString());
+  // `decoded` are the pixels the file was encoded from, if any; they are hashed for the
+  // metadata on a worker once the file is saved
+  bool saveImage(QFile &file, const QString &originalName = QString(), const QString &source = QString(),
+                 const QImage &decoded = QImage());
   bool saveImage(const QImage &image);
+  void hashPixels(const QString &dir, const QString &path, const QImage &image);
   void loadSettings();
   void saveSettings();
   void loadChecksums();
-  void appendChecksum(const QString &filename, const QByteArray &checksum);
+  void appendChecksums(const QList<ChecksumIndex::Entry> &entries, const QString &dir = QString());
+  void appendMetadata(const QList<ImageMetadata> &items, const QString &dir = QString());
+  // Between these, appends to `dir` are held in memory while a worker rewrites its index files
+  void beginRewrite(const QString &dir);
+  void endRewrite();
+  void onDirectoryChanged(const QStringList &added, const QStringList &removed);
+  void importRecentDirectories();
+  void pruneBlobs();
+  void forgetPaths(const QStringList &paths);
+  void backfillSizes();
+  void backfillMetadata();
+  void maybeEvict();
+  void updateUsageLabel();
+  void maybeScrub();
+  void updateScrubLabel();
+  bool findDuplicate(const QByteArray &checksum, QString *location = nullptr);
   QByteArray calculateChecksum(QIODevice *device);
+  bool processUrlListContent();
   bool processTextContent();
   bool processImageContent();
-  bool handleRemoteUrl(const QUrl &url, const QImage &fallbackImage = QImage());
+  // Picks up the downloads the last session left unfinished, once auto-save is enabled
+  void restoreDownloads();
+  // `notify` shows a progress notification for this download
+  bool handleRemoteUrl(const QUrl &url, const QImage &fallbackImage = QImage(),
+                       int priority = DownloadQueue::Normal, bool notify = true);
   bool handleLocalPath(const QString &path);
+  IngestPipeline *createIngestPipeline();
+  IngestPipeline *ingestLocalFiles(const QStringList &paths, int queuedUrlCount);
+  void onWatchedFilesArrived(const QStringList &paths);
+  void updateWatchFolders();
+  void updateWatchPaused();
+  QString targetFileName(const QString &originalName, const QByteArray &checksum) const;
+  // `keepSaving`: clipboard images are still saved while the job runs; its writes to the
+  // index must not overwrite appends (see beginRewrite())
+  void setBusy(bool busy, bool keepSaving = false);
+  void runClean(bool dryRun);
   void updateRecentPaths(const QString &path);
   void populatePathCombo();
 
@@ -61,21 +126,90 @@ class AutoSaveWidget : public QWidget {
   QPushButton *m_browseButton = nullptr;
   QPushButton *m_openDirButton = nullptr;
   QPushButton *m_cleanButton = nullptr;
+  QPushButton *m_checkIndexButton = nullptr;
   QPushButton *m_rebuildButton = nullptr;
+  QPushButton *m_importButton = nullptr;
   QLabel *m_maxSizeLabel = nullptr;
   QSpinBox *m_maxSizeSpinBox = nullptr;
+  QCheckBox *m_paranoidCheckBox = nullptr;
+  QCheckBox *m_blobStoreCheckBox = nullptr;
+  QLabel *m_layoutLabel = nullptr;
+  QComboBox *m_layoutCombo = nullptr;
+  QPushButton *m_migrateButton = nullptr;
+  QLabel *m_transcodeLabel = nullptr;
+  QComboBox *m_transcodeFromCombo = nullptr;
+  QComboBox *m_transcodeFormatCombo = nullptr;
+  QSpinBox *m_transcodeQualitySpinBox = nullptr;
+  QPushButton *m_transcodeButton = nullptr;
+  QLabel *m_quotaLabel = nullptr;
+  QSpinBox *m_quotaSizeSpinBox = nullptr;
+  QSpinBox *m_quotaFilesSpinBox = nullptr;
+  QComboBox *m_evictionCombo = nullptr;
+  QLabel *m_usageLabel = nullptr;
+  QCheckBox *m_scrubCheckBox = nullptr;
+  QSpinBox *m_scrubBandwidthSpinBox = nullptr;
+  QLabel *m_scrubLabel = nullptr;
+  QLabel *m_dedupLabel = nullptr;
+  QComboBox *m_dedupCombo = nullptr;
+  QLabel *m_watchLabel = nullptr;
+  QPushButton *m_addWatchButton = nullptr;
+  QPushButton *m_clearWatchButton = nullptr;
   QProgressBar *m_progressBar = nullptr;
+  QPushButton *m_cancelJobButton = nullptr;  // shown by the background jobs that can stop early
 
+  QTabWidget *m_viewTabs = nullptr;
+  QListView *m_galleryView = nullptr;
+  GalleryModel *m_galleryModel = nullptr;
+  ThumbnailCache *m_thumbnails = nullptr;
   QListView *m_downloadListView = nullptr;
   DownloadProgressModel *m_downloadModel = nullptr;
   QPushButton *m_clearFinishedButton = nullptr;
+  QSpinBox *m_downloadConcurrencySpinBox = nullptr;
+  QSpinBox *m_downloadsPerHostSpinBox = nullptr;
+  QSpinBox *m_downloadBandwidthSpinBox = nullptr;
+  QSpinBox *m_perDownloadBandwidthSpinBox = nullptr;
+  QCheckBox *m_pauseOnForegroundCheckBox = nullptr;
 
   DownloadQueue *m_downloadQueue = nullptr;
+  QHash<int, DownloadHandle> m_downloadHandles;  // by download model id, until finished
+  DirectoryWatcher *m_dirWatcher = nullptr;
+  Scrubber *m_scrubber = nullptr;
+  QTimer *m_scrubTimer = nullptr;
+  WatchFolderSource *m_watchSource = nullptr;
 
   QString m_targetDir;
   QStringList m_recentPaths;
+  QStringList m_watchFolders;
+  bool m_isWatchIngesting = false;
+  int m_downloadConcurrency = 4;
+  int m_downloadsPerHost = 2;
+  int m_downloadBandwidthKB = 0;
+  int m_perDownloadBandwidthKB = 0;
+  bool m_pauseOnForegroundTraffic = false;
   bool m_isEnabled = false;
-  bool m_isRebuilding = false;
+  bool m_isBusy = false;
+  bool m_savesWhileBusy = false;
+  bool m_restorePending = false;  // the last session's downloads are waiting for auto-save
+  QString m_rewriteDir;
+  QList<ChecksumIndex::Entry> m_heldChecksums;
+  QList<ImageMetadata> m_heldMetadata;
+  QList<QPair<QStringList, QStringList>> m_heldDirChanges;  // (added, removed) batches
+  // Destinations (absolute) that running ingest batches copy to; indexed when the batch finishes
+  QSet<QString> m_pendingIngestPaths;
   int m_maxSizeMB = 30;
-  QSet<QByteArray> m_seenChecksums;
+  bool m_paranoidValidation = false;
+  bool m_useBlobStore = false;
+  int m_quotaMB = 0;
+  int m_quotaFiles = 0;
+  EvictionPolicy m_evictionPolicy = EvictionPolicy::Oldest;
+  bool m_isEvicting = false;
+  bool m_scrubEnabled = true;
+  int m_scrubBandwidthMB = 16;
+  ArchiveLayout m_layout = ArchiveLayout::Flat;
+  DedupScope m_dedupScope = DedupScope::CurrentDirectory;
+  ChecksumIndex m_index;
+  BlobStore m_blobStore;
+  ContentIndex m_contentIndex;
+  UrlCache m_urlCache;
+  MetadataIndex m_metadata;
 };
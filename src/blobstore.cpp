@@ -0,0 +1,163 @@
+#include "blobstore.h"
+
+#include <QtGlobal>
+
+#include <QDebug>
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QRandomGenerator>
+
+#if defined(Q_OS_WIN)
+#include <windows.h>
+#else
+#include <unistd.h>
+#if defined(Q_OS_LINUX)
+#include <fcntl.h>
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#elif defined(Q_OS_MACOS)
+#include <sys/clonefile.h>
+#endif
+#endif
+
+const QString BlobStore::kDirName = ".blobs";
+
+namespace {
+
+bool reflink(const QString &source, const QString &destination) {
+#if defined(Q_OS_LINUX) && defined(FICLONE)
+  int in = ::open(QFile::encodeName(source).constData(), O_RDONLY | O_CLOEXEC);
+  if (in < 0) return false;
+  int out = ::open(QFile::encodeName(destination).constData(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+  if (out < 0) {
+    ::close(in);
+    return false;
+  }
+  // Fails with EOPNOTSUPP / EXDEV outside btrfs, XFS (reflink=1) and friends
+  bool ok = ::ioctl(out, FICLONE, in) == 0;
+  ::close(out);
+  ::close(in);
+  if (!ok) ::unlink(QFile::encodeName(destination).constData());
+  return ok;
+#elif defined(Q_OS_MACOS)
+  return ::clonefile(QFile::encodeName(source).constData(), QFile::encodeName(destination).constData(), 0) == 0;
+#else
+  Q_UNUSED(source);
+  Q_UNUSED(destination);
+  return false;
+#endif
+}
+
+bool hardlink(const QString &source, const QString &destination) {
+#if defined(Q_OS_WIN)
+  return CreateHardLinkW(reinterpret_cast<LPCWSTR>(QDir::toNativeSeparators(destination).utf16()),
+                         reinterpret_cast<LPCWSTR>(QDir::toNativeSeparators(source).utf16()), nullptr);
+#else
+  return ::link(QFile::encodeName(source).constData(), QFile::encodeName(destination).constData()) == 0;
+#endif
+}
+
+}  // namespace
+
+QString BlobStore::blobPath(const QByteArray &checksum) const {
+  QString hex = QString::fromLatin1(checksum.toHex());
+  return QDir(m_rootDir).filePath(kDirName + "/" + hex.left(2) + "/" + hex);
+}
+
+bool BlobStore::contains(const QByteArray &checksum) const { return QFileInfo(blobPath(checksum)).isFile(); }
+
+bool BlobStore::put(const QString &sourcePath, const QByteArray &checksum, QString *error) const {
+  if (m_rootDir.isEmpty() || checksum.isEmpty()) return false;
+  if (contains(checksum)) return true;
+
+  QString path = blobPath(checksum);
+  QDir().mkpath(QFileInfo(path).path());
+  // Copy under a temporary name so a blob is either complete or absent
+  QString temp = path + ".part-" + QString::number(QRandomGenerator::global()->generate(), 16);
+  if (cloneFile(sourcePath, temp, false) == LinkKind::Failed) {
+    if (error) *error = "Failed to copy " + sourcePath + " into the blob store";
+    return false;
+  }
+  // Clones and copies may keep the source's time; prune() goes by when the blob was written
+  QFile written(temp);
+  if (written.open(QIODevice::ReadWrite)) {
+    written.setFileTime(QDateTime::currentDateTime(), QFileDevice::FileModificationTime);
+    written.close();
+  }
+  if (!QFile::rename(temp, path)) {
+    QFile::remove(temp);
+    // Another writer stored the same content first
+    if (contains(checksum)) return true;
+    if (error) *error = "Failed to commit blob " + path;
+    return false;
+  }
+  return true;
+}
+
+BlobStore::LinkKind BlobStore::link(const QByteArray &checksum, const QString &destination, QString *error) const {
+  LinkKind kind = cloneFile(blobPath(checksum), destination);
+  if (kind == LinkKind::Failed && error) {
+    *error = "Failed to link " + destination + " to its blob";
+  }
+  return kind;
+}
+
+BlobStore::LinkKind BlobStore::store(const QString &sourcePath, const QByteArray &checksum, const QString &destination,
+                                     QString *error) const {
+  if (!put(sourcePath, checksum, error)) return LinkKind::Failed;
+  LinkKind kind = link(checksum, destination, error);
+  // A prune may have taken an unreferenced blob between put() and link()
+  if (kind == LinkKind::Failed && !contains(checksum) && put(sourcePath, checksum, error)) {
+    kind = link(checksum, destination, error);
+  }
+  return kind;
+}
+
+bool BlobStore::release(const QByteArray &checksum) const {
+  if (m_rootDir.isEmpty() || checksum.isEmpty()) return false;
+  QString path = blobPath(checksum);
+  if (!QFile::remove(path)) return false;
+  QDir(m_rootDir).rmpath(QDir(m_rootDir).relativeFilePath(QFileInfo(path).path()));
+  return true;
+}
+
+qint64 BlobStore::prune(const QString &rootDir, const QSet<QByteArray> &live, const QDateTime &liveAt) {
+  // Some filesystems keep modification times at a two-second granularity
+  QDateTime cutoff = liveAt.addSecs(-2);
+  qint64 freed = 0;
+  QDirIterator it(QDir(rootDir).filePath(kDirName), QDir::Files | QDir::Hidden, QDirIterator::Subdirectories);
+  while (it.hasNext()) {
+    it.next();
+    QFileInfo fi = it.fileInfo();
+    // Temporary ".part-" files belong to writers that are still running
+    if (fi.fileName().contains('.')) continue;
+    if (live.contains(QByteArray::fromHex(fi.fileName().toLatin1()))) continue;
+    if (fi.lastModified() >= cutoff) continue;
+    qint64 size = fi.size();
+    if (QFile::remove(fi.filePath())) freed += size;
+  }
+  return freed;
+}
+
+BlobStore::LinkKind BlobStore::cloneFile(const QString &source, const QString &destination, bool allowHardLink) {
+  if (QFile::exists(destination)) return LinkKind::Failed;
+  if (reflink(source, destination)) return LinkKind::Reflink;
+  if (allowHardLink && hardlink(source, destination)) return LinkKind::HardLink;
+  return QFile::copy(source, destination) ? LinkKind::Copy : LinkKind::Failed;
+}
+
+QString BlobStore::toString(LinkKind kind) {
+  switch (kind) {
+    case LinkKind::Reflink:
+      return "reflink";
+    case LinkKind::HardLink:
+      return "hardlink";
+    case LinkKind::Copy:
+      return "copy";
+    case LinkKind::Failed:
+    default:
+      return "failed";
+  }
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <QByteArray>
+#include <QDateTime>
+#include <QSet>
+#include <QString>
+
+// Content-addressed store below the target directory: every distinct image is kept once
+// as .blobs/<hex[0:2]>/<hex>, and the human-readable names are reflinks or hardlinks to
+// it. Blobs are reference counted through ChecksumIndex (one reference per named path).
+// All operations only touch the filesystem, so they may run on any thread.
+class BlobStore {
+ public:
+  enum class LinkKind { Failed, Reflink, HardLink, Copy };
+
+  static const QString kDirName;
+
+  explicit BlobStore(const QString &rootDir = QString()) : m_rootDir(rootDir) {}
+
+  QString rootDir() const { return m_rootDir; }
+  void setRootDir(const QString &rootDir) { m_rootDir = rootDir; }
+
+  QString blobPath(const QByteArray &checksum) const;
+  bool contains(const QByteArray &checksum) const;
+
+  // Copies `sourcePath` into the store unless the blob already exists
+  bool put(const QString &sourcePath, const QByteArray &checksum, QString *error = nullptr) const;
+  // Creates `destination` as a named view of the blob
+  LinkKind link(const QByteArray &checksum, const QString &destination, QString *error = nullptr) const;
+  // put() followed by link()
+  LinkKind store(const QString &sourcePath, const QByteArray &checksum, const QString &destination,
+                 QString *error = nullptr) const;
+  // Drops the blob once no named path references it any more
+  bool release(const QByteArray &checksum) const;
+
+  // Deletes every blob below `rootDir` whose digest is not in `live`; returns the bytes freed.
+  // Blobs written since `liveAt`, when `live` was taken, may belong to saves it does not know
+  // about and are kept.
+  static qint64 prune(const QString &rootDir, const QSet<QByteArray> &live, const QDateTime &liveAt);
+
+  // Reflink where the filesystem supports it, then hardlink, then a plain copy. Files we do
+  // not own must not share an inode with the archive, so they pass allowHardLink = false.
+  static LinkKind cloneFile(const QString &source, const QString &destination, bool allowHardLink = true);
+  static QString toString(LinkKind kind);
+
+ private:
+  QString m_rootDir;
+};
@@ -0,0 +1,299 @@
+#include "checksumindex.h"
+
+#include <QDebug>
+#include <QDir>
+#include <QDirIterator>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QSaveFile>
+#include <QTextStream>
+#include <algorithm>
+
+const QString ChecksumIndex::kFileName = "checksums.txt";
+
+namespace {
+
+const QString kDropMarker = "-";
+// Drop lines tolerated before drop() compacts the file
+const int kMinDropLines = 256;
+
+void writeEntries(QTextStream &out, const QList<ChecksumIndex::Entry> &entries) {
+  for (const ChecksumIndex::Entry &entry : entries) {
+    out << ChecksumIndex::formatLine(entry) << "\n";
+  }
+}
+
+}  // namespace
+
+void ChecksumIndex::clear() {
+  m_dir.clear();
+  m_entryByPath.clear();
+  m_refCount.clear();
+  m_originalRefCount.clear();
+  m_sizeByChecksum.clear();
+  m_totalBytes = 0;
+  m_unknownSizes = 0;
+  m_reserved.clear();
+  m_dropLines = 0;
+}
+
+bool ChecksumIndex::load(const QString &dir, QString *error) {
+  clear();
+  m_dir = dir;
+  if (dir.isEmpty()) return false;
+
+  QString readError;
+  const QList<Entry> entries = readFile(dir, &readError, &m_dropLines);
+  for (const Entry &entry : entries) {
+    insert(entry);
+  }
+  if (!readError.isEmpty()) {
+    if (error) *error = readError;
+    return false;
+  }
+  return true;
+}
+
+bool ChecksumIndex::contains(const QByteArray &checksum) const {
+  return m_refCount.contains(checksum) || m_originalRefCount.contains(checksum) || m_reserved.contains(checksum);
+}
+
+QList<ChecksumIndex::Entry> ChecksumIndex::entries() const {
+  QList<Entry> result;
+  result.reserve(m_entryByPath.size());
+  for (auto it = m_entryByPath.cbegin(); it != m_entryByPath.cend(); ++it) {
+    result.append(it.value());
+  }
+  std::sort(result.begin(), result.end(), [](const Entry &a, const Entry &b) { return a.path < b.path; });
+  return result;
+}
+
+bool ChecksumIndex::reserve(const QByteArray &checksum) {
+  if (contains(checksum)) return false;
+  m_reserved.insert(checksum);
+  return true;
+}
+
+void ChecksumIndex::release(const QByteArray &checksum) { m_reserved.remove(checksum); }
+
+void ChecksumIndex::insert(const Entry &entry) {
+  remove(entry.path);
+  m_entryByPath.insert(entry.path, entry);
+  if (entry.size < 0) m_unknownSizes++;
+  if (m_refCount[entry.checksum]++ == 0) {
+    qint64 size = qMax<qint64>(0, entry.size);
+    m_sizeByChecksum.insert(entry.checksum, size);
+    m_totalBytes += size;
+  } else if (entry.size >= 0 && m_sizeByChecksum.value(entry.checksum) == 0) {
+    m_sizeByChecksum.insert(entry.checksum, entry.size);
+    m_totalBytes += entry.size;
+  }
+  if (!entry.originalChecksum.isEmpty()) m_originalRefCount[entry.originalChecksum]++;
+  m_reserved.remove(entry.checksum);
+}
+
+bool ChecksumIndex::remove(const QString &path) {
+  auto it = m_entryByPath.find(path);
+  if (it == m_entryByPath.end()) return false;
+
+  QByteArray checksum = it->checksum;
+  QByteArray originalChecksum = it->originalChecksum;
+  if (it->size < 0) m_unknownSizes--;
+  m_entryByPath.erase(it);
+  if (!originalChecksum.isEmpty() && --m_originalRefCount[originalChecksum] <= 0) {
+    m_originalRefCount.remove(originalChecksum);
+  }
+  if (--m_refCount[checksum] <= 0) {
+    m_refCount.remove(checksum);
+    m_totalBytes -= m_sizeByChecksum.take(checksum);
+  }
+  return true;
+}
+
+void ChecksumIndex::setSize(const QString &path, qint64 size) {
+  auto it = m_entryByPath.find(path);
+  if (it == m_entryByPath.end() || it->size >= 0 || size < 0) return;
+  it->size = size;
+  m_unknownSizes--;
+  if (m_sizeByChecksum.value(it->checksum) == 0) {
+    m_sizeByChecksum.insert(it->checksum, size);
+    m_totalBytes += size;
+  }
+}
+
+bool ChecksumIndex::append(const QList<Entry> &entries, QString *error) {
+  // The directory watcher may have indexed a file before its writer got here
+  QList<Entry> fresh;
+  for (const Entry &entry : entries) {
+    if (checksumFor(entry.path) == entry.checksum) continue;
+    insert(entry);
+    fresh.append(entry);
+  }
+  return appendFile(m_dir, fresh, error);
+}
+
+bool ChecksumIndex::drop(const QStringList &paths, QString *error) {
+  QStringList dropped;
+  for (const QString &path : paths) {
+    if (remove(path)) dropped.append(path);
+  }
+  if (dropped.isEmpty()) return true;
+
+  m_dropLines += dropped.size();
+  if (m_dropLines > qMax(kMinDropLines, size() / 4)) return save(error);
+
+  QFile file(QDir(m_dir).filePath(kFileName));
+  if (!file.open(QIODevice::WriteOnly | QIODevice::Append | QIODevice::Text)) {
+    if (error) *error = file.errorString();
+    return false;
+  }
+  QTextStream out(&file);
+  for (const QString &path : std::as_const(dropped)) {
+    out << path << ": " << kDropMarker << "\n";
+  }
+  return true;
+}
+
+bool ChecksumIndex::save(QString *error) {
+  if (!writeFile(m_dir, entries(), error)) return false;
+  m_dropLines = 0;
+  return true;
+}
+
+QList<ChecksumIndex::Entry> ChecksumIndex::readFile(const QString &dir, QString *error, int *dropLines) {
+  QList<Entry> entries;
+  QHash<QString, qsizetype> positionByPath;
+  if (dropLines) *dropLines = 0;
+  QFile file(QDir(dir).filePath(kFileName));
+  if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+    if (error) *error = file.errorString();
+    return entries;
+  }
+
+  QTextStream in(&file);
+  while (!in.atEnd()) {
+    QString line = in.readLine();
+    int splitIndex = line.lastIndexOf(": ");
+    if (splitIndex == -1) continue;
+    Entry entry;
+    entry.path = line.left(splitIndex).trimmed();
+    const QStringList fields = line.mid(splitIndex + 2).split(' ', Qt::SkipEmptyParts);
+    if (entry.path.isEmpty() || fields.isEmpty()) continue;
+    auto position = positionByPath.constFind(entry.path);
+    if (fields[0] == kDropMarker) {
+      if (dropLines) ++*dropLines;
+      if (position == positionByPath.constEnd()) continue;
+      // Blanked here, filtered out below
+      entries[*position].checksum.clear();
+      positionByPath.erase(position);
+      continue;
+    }
+    entry.checksum = QByteArray::fromHex(fields[0].toUtf8());
+    if (entry.checksum.isEmpty()) continue;
+    if (fields.size() >= 3) {
+      entry.size = fields[1].toLongLong();
+      entry.savedAt = fields[2].toLongLong();
+    }
+    if (fields.size() >= 4) entry.originalChecksum = QByteArray::fromHex(fields[3].toUtf8());
+    if (position != positionByPath.constEnd()) {
+      entries[*position] = entry;
+    } else {
+      positionByPath.insert(entry.path, entries.size());
+      entries.append(entry);
+    }
+  }
+  entries.removeIf([](const Entry &entry) { return entry.checksum.isEmpty(); });
+  return entries;
+}
+
+bool ChecksumIndex::writeFile(const QString &dir, const QList<Entry> &entries, QString *error) {
+  if (dir.isEmpty()) return false;
+
+  QSaveFile file(QDir(dir).filePath(kFileName));
+  if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
+    if (error) *error = file.errorString();
+    return false;
+  }
+  QTextStream out(&file);
+  writeEntries(out, entries);
+  out.flush();
+  if (!file.commit()) {
+    if (error) *error = file.errorString();
+    return false;
+  }
+  return true;
+}
+
+bool ChecksumIndex::appendFile(const QString &dir, const QList<Entry> &entries, QString *error) {
+  if (dir.isEmpty()) return false;
+  if (entries.isEmpty()) return true;
+
+  QFile file(QDir(dir).filePath(kFileName));
+  if (!file.open(QIODevice::WriteOnly | QIODevice::Append | QIODevice::Text)) {
+    if (error) *error = file.errorString();
+    return false;
+  }
+  QTextStream out(&file);
+  writeEntries(out, entries);
+  return true;
+}
+
+QString ChecksumIndex::formatLine(const Entry &entry) {
+  QString line = entry.path + ": " + QString::fromLatin1(entry.checksum.toHex());
+  if (entry.size >= 0) {
+    line += QString(" %1 %2").arg(entry.size).arg(entry.savedAt);
+    if (!entry.originalChecksum.isEmpty()) line += " " + QString::fromLatin1(entry.originalChecksum.toHex());
+  }
+  return line;
+}
+
+bool ChecksumIndex::isInternalPath(const QString &relativePath) {
+  return relativePath.startsWith('.') || relativePath.startsWith(kFileName);
+}
+
+void ChecksumIndex::clean(QPromise<ChecksumCleanReport> &promise, const QString &dirPath, bool dryRun) {
+  ChecksumCleanReport report;
+  report.dryRun = dryRun;
+  QElapsedTimer timer;
+  timer.start();
+
+  const QList<Entry> entries = readFile(dirPath, &report.error);
+  report.total = entries.size();
+  if (!report.error.isEmpty()) {
+    promise.addResult(report);
+    return;
+  }
+
+  QDir dir(dirPath);
+  QSet<QString> onDisk;
+  QDirIterator it(dirPath, QDir::Files | QDir::NoDotAndDotDot, QDirIterator::Subdirectories);
+  while (it.hasNext()) {
+    if (promise.isCanceled()) return;
+    QString relativePath = dir.relativeFilePath(it.next());
+    if (!isInternalPath(relativePath)) onDisk.insert(relativePath);
+  }
+
+  QList<Entry> kept;
+  QSet<QString> indexed;
+  kept.reserve(entries.size());
+  for (const Entry &entry : entries) {
+    indexed.insert(entry.path);
+    if (onDisk.contains(entry.path)) {
+      kept.append(entry);
+    } else {
+      report.orphaned.append(entry.path);
+    }
+  }
+  for (const QString &path : std::as_const(onDisk)) {
+    if (!indexed.contains(path)) report.untracked.append(path);
+  }
+  report.orphaned.removeDuplicates();
+  report.untracked.sort();
+
+  if (!dryRun && !report.orphaned.isEmpty()) {
+    writeFile(dirPath, kept, &report.error);
+  }
+
+  report.elapsedMs = timer.elapsed();
+  promise.addResult(report);
+}
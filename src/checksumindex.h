@@ -0,0 +1,93 @@
+#pragma once
+
+#include <QByteArray>
+#include <QHash>
+#include <QList>
+#include <QPromise>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+
+struct ChecksumCleanReport {
+  int total = 0;
+  QStringList orphaned;   // indexed, but the file is gone
+  QStringList untracked;  // on disk, but not indexed
+  bool dryRun = false;
+  qint64 elapsedMs = 0;
+  QString error;
+};
+
+// In-memory view of a target directory's checksums.txt.
+// Each line is "<relative path>: <md5 hex> [<size> <saved at, epoch seconds> [<original md5 hex>]]";
+// paths use '/' and may include shard directories. Older lines without size are still read.
+// The original digest is that of the content as it was saved, kept when a file is
+// transcoded so the same content still counts as a duplicate.
+// A later line for the same path replaces it, and "<relative path>: -" drops it.
+class ChecksumIndex {
+ public:
+  struct Entry {
+    QString path;
+    QByteArray checksum;
+    qint64 size = -1;  // -1 when unknown
+    qint64 savedAt = 0;
+    QByteArray originalChecksum;  // empty unless the file was re-encoded
+  };
+
+  static const QString kFileName;
+
+  QString dir() const { return m_dir; }
+  void clear();
+  bool load(const QString &dir, QString *error = nullptr);
+
+  // Original digests of transcoded files count as well
+  bool contains(const QByteArray &checksum) const;
+  bool containsPath(const QString &path) const { return m_entryByPath.contains(path); }
+  QByteArray checksumFor(const QString &path) const { return m_entryByPath.value(path).checksum; }
+  Entry entry(const QString &path) const { return m_entryByPath.value(path); }
+  int size() const { return m_entryByPath.size(); }
+  QList<Entry> entries() const;
+
+  // Usage, maintained incrementally; content stored under several names counts once
+  qint64 totalBytes() const { return m_totalBytes; }
+  int unknownSizeCount() const { return m_unknownSizes; }
+  // Fills in a size that was unknown when the entry was read
+  void setSize(const QString &path, qint64 size);
+
+  // Reservations mark content as taken while it is still being copied
+  bool reserve(const QByteArray &checksum);
+  void release(const QByteArray &checksum);
+
+  void insert(const Entry &entry);
+  bool remove(const QString &path);
+
+  // insert() plus an append to checksums.txt
+  bool append(const QList<Entry> &entries, QString *error = nullptr);
+  // remove() plus an appended drop line per path; rewrites the file instead once drop
+  // lines pile up
+  bool drop(const QStringList &paths, QString *error = nullptr);
+  // Atomically rewrites checksums.txt from memory
+  bool save(QString *error = nullptr);
+
+  // Drop lines and replaced lines are already applied; `dropLines` counts the former
+  static QList<Entry> readFile(const QString &dir, QString *error = nullptr, int *dropLines = nullptr);
+  static bool writeFile(const QString &dir, const QList<Entry> &entries, QString *error = nullptr);
+  static bool appendFile(const QString &dir, const QList<Entry> &entries, QString *error = nullptr);
+  static QString formatLine(const Entry &entry);
+
+  // Joins one recursive listing of `dir` against checksums.txt and, unless `dryRun`,
+  // atomically rewrites it without the orphaned entries. Meant for QtConcurrent::run.
+  static void clean(QPromise<ChecksumCleanReport> &promise, const QString &dir, bool dryRun);
+  // checksums.txt, QSaveFile temporaries and dot paths are not archive content
+  static bool isInternalPath(const QString &relativePath);
+
+ private:
+  QString m_dir;
+  QHash<QString, Entry> m_entryByPath;
+  QHash<QByteArray, int> m_refCount;
+  QHash<QByteArray, int> m_originalRefCount;
+  QHash<QByteArray, qint64> m_sizeByChecksum;
+  qint64 m_totalBytes = 0;
+  int m_unknownSizes = 0;
+  QSet<QByteArray> m_reserved;
+  int m_dropLines = 0;
+};
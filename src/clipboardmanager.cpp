@@ -16,6 +16,7 @@
 #include <QUrl>
 
 #include "notificationmanager.h"
+#include "pngencoder.h"
 #include "settingsmanager.h"
 
 ClipboardManager::ClipboardManager(QObject *parent)
@@ -59,7 +60,15 @@ void ClipboardManager::saveImageToFile(const QString &path) {
   qDebug() << "Attempting to save image to:" << path;
   QString localPath = normalizeLocalPath(path);
   QImage image = m_clipboard->image();
-  bool success = !image.isNull() && !localPath.isEmpty() && image.save(localPath);
+  bool success = false;
+  if (!image.isNull() && !localPath.isEmpty()) {
+    if (QFileInfo(localPath).suffix().compare("png", Qt::CaseInsensitive) == 0) {
+      PngEncoder encoder(m_settingsManager->pngEncoderThreads());
+      success = encoder.save(image, localPath);
+    } else {
+      success = image.save(localPath);
+    }
+  }
 
   if (success) {
     qDebug() << "Image saved successfully";
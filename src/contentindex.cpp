@@ -0,0 +1,216 @@
+#include "contentindex.h"
+
+#include <QDebug>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QTextStream>
+
+const QString ContentIndex::kFileName = "content_index.txt";
+
+namespace {
+
+const QString kDropMarker = "-";
+// Drop lines tolerated before drop() compacts the file
+const int kMinDropLines = 1024;
+
+}  // namespace
+
+namespace dedupscope {
+
+QString toString(DedupScope scope) {
+  switch (scope) {
+    case DedupScope::RecentPaths:
+      return "RecentPaths";
+    case DedupScope::AllDirectories:
+      return "AllDirectories";
+    case DedupScope::CurrentDirectory:
+    default:
+      return "CurrentDirectory";
+  }
+}
+
+DedupScope fromString(const QString &str) {
+  if (str == "RecentPaths") return DedupScope::RecentPaths;
+  if (str == "AllDirectories") return DedupScope::AllDirectories;
+  return DedupScope::CurrentDirectory;
+}
+
+}  // namespace dedupscope
+
+ContentIndex::ContentIndex(const QString &filePath) : m_filePath(filePath) {}
+
+QString ContentIndex::defaultFilePath() {
+  return QDir(QStandardPaths::writableLocation(QStandardPaths::AppDataLocation)).filePath(kFileName);
+}
+
+bool ContentIndex::load(QString *error) {
+  m_locations.clear();
+  m_byDir.clear();
+  m_dropLines = 0;
+
+  QFile file(m_filePath);
+  if (!file.exists()) return true;
+  if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+    if (error) *error = file.errorString();
+    return false;
+  }
+
+  QTextStream in(&file);
+  while (!in.atEnd()) {
+    const QStringList fields = in.readLine().split('\t');
+    if (fields.size() != 3 && fields.size() != 4) continue;
+    if (fields[0] == kDropMarker) {
+      remove(fields[1], fields[2]);
+      m_dropLines++;
+      continue;
+    }
+    Digests digests{QByteArray::fromHex(fields[0].toLatin1()), QByteArray()};
+    if (fields.size() == 4) digests.original = QByteArray::fromHex(fields[3].toLatin1());
+    if (digests.checksum.isEmpty() || fields[1].isEmpty() || fields[2].isEmpty()) continue;
+    insert(fields[1], fields[2], digests);
+  }
+  qDebug() << "Loaded" << m_locations.size() << "digests in" << m_byDir.size() << "directories from" << m_filePath;
+  return true;
+}
+
+bool ContentIndex::save(QString *error) {
+  QDir().mkpath(QFileInfo(m_filePath).path());
+  QSaveFile file(m_filePath);
+  if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
+    if (error) *error = file.errorString();
+    return false;
+  }
+  QTextStream out(&file);
+  for (auto dirIt = m_byDir.cbegin(); dirIt != m_byDir.cend(); ++dirIt) {
+    for (auto it = dirIt->cbegin(); it != dirIt->cend(); ++it) {
+      ChecksumIndex::Entry entry;
+      entry.path = it.key();
+      entry.checksum = it->checksum;
+      entry.originalChecksum = it->original;
+      out << formatLine(dirIt.key(), entry) << '\n';
+    }
+  }
+  out.flush();
+  if (!file.commit()) {
+    if (error) *error = file.errorString();
+    return false;
+  }
+  m_dropLines = 0;
+  return true;
+}
+
+ContentIndex::Location ContentIndex::find(const QByteArray &checksum, const QSet<QString> &dirs) const {
+  auto it = m_locations.constFind(checksum);
+  if (it == m_locations.constEnd()) return {};
+  for (const Location &location : *it) {
+    if (dirs.contains(location.dir)) return location;
+  }
+  return {};
+}
+
+ContentIndex::Location ContentIndex::find(const QByteArray &checksum) const {
+  auto it = m_locations.constFind(checksum);
+  return (it == m_locations.constEnd() || it->isEmpty()) ? Location() : it->first();
+}
+
+bool ContentIndex::syncDirectory(const QString &dir, const QList<ChecksumIndex::Entry> &entries, QString *error) {
+  QString cleanDir = QDir::cleanPath(dir);
+  QSet<QString> current;
+  for (const ChecksumIndex::Entry &entry : entries) current.insert(entry.path);
+  QStringList gone;
+  const QHash<QString, Digests> known = m_byDir.value(cleanDir);
+  for (auto it = known.cbegin(); it != known.cend(); ++it) {
+    if (!current.contains(it.key())) gone.append(it.key());
+  }
+  // An empty directory is still recorded as known
+  m_byDir[cleanDir];
+
+  bool dropped = drop(cleanDir, gone, error);
+  // add() skips the paths whose digests did not change
+  return add(cleanDir, entries, error) && dropped;
+}
+
+bool ContentIndex::remove(const QString &dir, const QString &path) {
+  QString cleanDir = QDir::cleanPath(dir);
+  auto dirIt = m_byDir.find(cleanDir);
+  if (dirIt == m_byDir.end()) return false;
+  auto pathIt = dirIt->find(path);
+  if (pathIt == dirIt->end()) return false;
+
+  Digests digests = pathIt.value();
+  dirIt->erase(pathIt);
+
+  removeLocation(digests.checksum, cleanDir, path);
+  if (!digests.original.isEmpty()) removeLocation(digests.original, cleanDir, path);
+  return true;
+}
+
+void ContentIndex::removeLocation(const QByteArray &checksum, const QString &dir, const QString &path) {
+  auto it = m_locations.find(checksum);
+  if (it == m_locations.end()) return;
+  it->removeIf([&](const Location &location) { return location.dir == dir && location.path == path; });
+  if (it->isEmpty()) m_locations.erase(it);
+}
+
+bool ContentIndex::add(const QString &dir, const QList<ChecksumIndex::Entry> &entries, QString *error) {
+  QString cleanDir = QDir::cleanPath(dir);
+  QList<ChecksumIndex::Entry> fresh;
+  for (const ChecksumIndex::Entry &entry : entries) {
+    if (insert(cleanDir, entry.path, {entry.checksum, entry.originalChecksum})) fresh.append(entry);
+  }
+  if (fresh.isEmpty()) return true;
+
+  QStringList lines;
+  for (const ChecksumIndex::Entry &entry : std::as_const(fresh)) {
+    lines.append(formatLine(cleanDir, entry));
+  }
+  return appendLines(lines, error);
+}
+
+QString ContentIndex::formatLine(const QString &dir, const ChecksumIndex::Entry &entry) {
+  QString line = QString::fromLatin1(entry.checksum.toHex()) + '\t' + dir + '\t' + entry.path;
+  if (!entry.originalChecksum.isEmpty()) line += '\t' + QString::fromLatin1(entry.originalChecksum.toHex());
+  return line;
+}
+
+bool ContentIndex::drop(const QString &dir, const QStringList &paths, QString *error) {
+  QString cleanDir = QDir::cleanPath(dir);
+  QStringList lines;
+  for (const QString &path : paths) {
+    if (remove(cleanDir, path)) lines.append(kDropMarker + '\t' + cleanDir + '\t' + path);
+  }
+  if (lines.isEmpty()) return true;
+
+  m_dropLines += lines.size();
+  if (m_dropLines > qMax(kMinDropLines, size() / 4)) return save(error);
+  return appendLines(lines, error);
+}
+
+bool ContentIndex::appendLines(const QStringList &lines, QString *error) {
+  QDir().mkpath(QFileInfo(m_filePath).path());
+  QFile file(m_filePath);
+  if (!file.open(QIODevice::WriteOnly | QIODevice::Append | QIODevice::Text)) {
+    if (error) *error = file.errorString();
+    return false;
+  }
+  QTextStream out(&file);
+  for (const QString &line : lines) out << line << '\n';
+  return true;
+}
+
+bool ContentIndex::insert(const QString &dir, const QString &path, const Digests &digests) {
+  QHash<QString, Digests> &paths = m_byDir[dir];
+  auto existing = paths.constFind(path);
+  if (existing != paths.constEnd()) {
+    if (existing->checksum == digests.checksum && existing->original == digests.original) return false;
+    remove(dir, path);
+  }
+  m_byDir[dir].insert(path, digests);
+  m_locations[digests.checksum].append({dir, path});
+  if (!digests.original.isEmpty() && digests.original != digests.checksum) {
+    m_locations[digests.original].append({dir, path});
+  }
+  return true;
+}
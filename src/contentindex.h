@@ -0,0 +1,76 @@
+#pragma once
+
+#include <QByteArray>
+#include <QDir>
+#include <QHash>
+#include <QList>
+#include <QSet>
+#include <QString>
+
+#include "checksumindex.h"
+
+// Where an incoming image is looked up before it is saved.
+enum class DedupScope { CurrentDirectory, RecentPaths, AllDirectories };
+
+namespace dedupscope {
+
+QString toString(DedupScope scope);
+DedupScope fromString(const QString &str);
+
+}  // namespace dedupscope
+
+// Digest -> every (directory, file) that holds it, across all auto-save directories.
+// Persisted as "<md5 hex>\t<directory>\t<relative path>[\t<original md5 hex>]" lines in the
+// app data location; "-\t<directory>\t<relative path>" drops an earlier line. A transcoded
+// file is found under its original digest too (see ChecksumIndex::Entry::originalChecksum).
+class ContentIndex {
+ public:
+  struct Location {
+    QString dir;
+    QString path;
+  };
+
+  static const QString kFileName;
+
+  explicit ContentIndex(const QString &filePath = defaultFilePath());
+  static QString defaultFilePath();
+
+  bool load(QString *error = nullptr);
+  // Atomically rewrites the whole file
+  bool save(QString *error = nullptr);
+
+  bool contains(const QByteArray &checksum) const { return m_locations.contains(checksum); }
+  // First location of `checksum` inside one of `dirs` (cleaned paths), or an empty Location
+  Location find(const QByteArray &checksum, const QSet<QString> &dirs) const;
+  Location find(const QByteArray &checksum) const;
+  QList<Location> locations(const QByteArray &checksum) const { return m_locations.value(checksum); }
+
+  bool hasDirectory(const QString &dir) const { return m_byDir.contains(QDir::cleanPath(dir)); }
+  QStringList directories() const { return m_byDir.keys(); }
+  int size() const { return m_locations.size(); }
+
+  // Makes `dir` hold exactly `entries`; only the paths that changed are appended or dropped
+  bool syncDirectory(const QString &dir, const QList<ChecksumIndex::Entry> &entries, QString *error = nullptr);
+  bool remove(const QString &dir, const QString &path);
+  // In memory plus an append to the file
+  bool add(const QString &dir, const QList<ChecksumIndex::Entry> &entries, QString *error = nullptr);
+  // remove() plus an appended drop line per path; rewrites the file instead once drop
+  // lines pile up
+  bool drop(const QString &dir, const QStringList &paths, QString *error = nullptr);
+
+ private:
+  struct Digests {
+    QByteArray checksum;
+    QByteArray original;
+  };
+
+  bool insert(const QString &dir, const QString &path, const Digests &digests);
+  void removeLocation(const QByteArray &checksum, const QString &dir, const QString &path);
+  bool appendLines(const QStringList &lines, QString *error);
+  static QString formatLine(const QString &dir, const ChecksumIndex::Entry &entry);
+
+  QString m_filePath;
+  QHash<QByteArray, QList<Location>> m_locations;
+  QHash<QString, QHash<QString, Digests>> m_byDir;  // dir -> path -> digests
+  int m_dropLines = 0;
+};
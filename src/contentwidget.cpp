@@ -17,6 +17,8 @@
 #include <QtConcurrent>
 
 #include "clipboardmanager.h"
+#include "pngencoder.h"
+#include "settingsmanager.h"
 #include "utils.h"
 
 ContentWidget::ContentWidget(ClipboardManager *manager, QWidget *parent) : QWidget(parent), m_manager(manager) {
@@ -81,14 +83,11 @@ void ContentWidget::setupUi() {
   });
 }
 
-ImageSizeResult ContentWidget::calculateImageSizes(QImage image) {
+ImageSizeResult ContentWidget::calculateImageSizes(QImage image, int pngThreads) {
   ImageSizeResult result;
 
-  QByteArray pngData;
-  QBuffer pngBuffer(&pngData);
-  pngBuffer.open(QIODevice::WriteOnly);
-  image.save(&pngBuffer, "PNG");
-  result.pngSize = pngData.size();
+  PngEncoder encoder(pngThreads);
+  result.pngSize = encoder.encode(image).size();
 
   QByteArray jpgData;
   QBuffer jpgBuffer(&jpgData);
@@ -159,8 +158,8 @@ void ContentWidget::updateContent() {
       // Note: The size here might differ from the original file size because:
       // 1. The clipboard image is likely converted to 32-bit ARGB (uncompressed
       // in memory).
-      // 2. Saving as PNG uses Qt's default compression (zlib level -1, usually
-      // 6).
+      // 2. PNG is encoded by PngEncoder (zlib level 6, adaptive row filters,
+      // one deflate segment per band).
       // 3. Original files might be 8-bit indexed or highly optimized.
       m_pngSizeRow = addRow("PNG Size", "Calculating...");
 
@@ -178,8 +177,9 @@ void ContentWidget::updateContent() {
       }
       addRow("Format", format);
 
-      QThreadPool::globalInstance()->start([this, image]() {
-        ImageSizeResult result = calculateImageSizes(image);
+      int pngThreads = m_manager->settingsManager()->pngEncoderThreads();
+      QThreadPool::globalInstance()->start([this, image, pngThreads]() {
+        ImageSizeResult result = calculateImageSizes(image, pngThreads);
         QMetaObject::invokeMethod(this, [this, result]() { updateImageSizeInfo(result); }, Qt::QueuedConnection);
       });
     } else {
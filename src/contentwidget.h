@@ -26,7 +26,7 @@ class ContentWidget : public QWidget {
   void setupUi();
   void updateContent();
   void updateImageSizeInfo(const ImageSizeResult &result);
-  static ImageSizeResult calculateImageSizes(QImage image);
+  static ImageSizeResult calculateImageSizes(QImage image, int pngThreads);
 
   ClipboardManager *m_manager = nullptr;
   QLabel *m_imageLabel = nullptr;
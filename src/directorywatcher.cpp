@@ -0,0 +1,231 @@
+#include "directorywatcher.h"
+
+#include <QDebug>
+#include <QDir>
+#include <QFileSystemWatcher>
+#include <QFutureWatcher>
+#include <QTimer>
+#include <QtConcurrent>
+
+namespace {
+
+QString joinPath(const QString &dir, const QString &name) { return dir.isEmpty() ? name : dir + "/" + name; }
+
+DirectoryWatcher::DirState listDir(const QString &root, const QString &relativeDir) {
+  DirectoryWatcher::DirState state;
+  QDir dir(QDir(root).filePath(relativeDir));
+  const QStringList files = dir.entryList(QDir::Files | QDir::NoDotAndDotDot);
+  for (const QString &name : files) state.files.insert(name);
+  const QStringList subdirs = dir.entryList(QDir::Dirs | QDir::NoDotAndDotDot);
+  for (const QString &name : subdirs) state.subdirs.insert(name);
+  return state;
+}
+
+// Lists `relativeDir` and everything below it, reporting every file as added
+void scanTree(const QString &root, const QString &relativeDir, DirectoryWatcher::ScanResult &result,
+              const std::atomic_bool &canceled) {
+  if (canceled) return;
+  DirectoryWatcher::DirState state = listDir(root, relativeDir);
+  for (const QString &name : std::as_const(state.files)) result.added.append(joinPath(relativeDir, name));
+  for (const QString &name : std::as_const(state.subdirs)) {
+    scanTree(root, joinPath(relativeDir, name), result, canceled);
+  }
+  result.updated.insert(relativeDir, state);
+}
+
+// Drops `relativeDir` and everything below it, reporting every known file as removed
+void forgetTree(const DirectoryWatcher::Snapshot &snapshot, const QString &relativeDir,
+                DirectoryWatcher::ScanResult &result) {
+  auto it = snapshot.constFind(relativeDir);
+  if (it == snapshot.constEnd()) return;
+  for (const QString &name : it->files) result.removed.append(joinPath(relativeDir, name));
+  for (const QString &name : it->subdirs) forgetTree(snapshot, joinPath(relativeDir, name), result);
+  result.removedDirs.append(relativeDir);
+}
+
+DirectoryWatcher::ScanResult rescan(const QString &root, const QStringList &dirs,
+                                    const DirectoryWatcher::Snapshot &snapshot, const std::atomic_bool &canceled) {
+  DirectoryWatcher::ScanResult result;
+  for (const QString &relativeDir : dirs) {
+    if (canceled) break;
+    if (!QDir(QDir(root).filePath(relativeDir)).exists()) {
+      forgetTree(snapshot, relativeDir, result);
+      continue;
+    }
+
+    DirectoryWatcher::DirState oldState = snapshot.value(relativeDir);
+    DirectoryWatcher::DirState newState = listDir(root, relativeDir);
+    for (const QString &name : std::as_const(newState.files)) {
+      if (!oldState.files.contains(name)) result.added.append(joinPath(relativeDir, name));
+    }
+    for (const QString &name : std::as_const(oldState.files)) {
+      if (!newState.files.contains(name)) result.removed.append(joinPath(relativeDir, name));
+    }
+    for (const QString &name : std::as_const(newState.subdirs)) {
+      if (!oldState.subdirs.contains(name)) scanTree(root, joinPath(relativeDir, name), result, canceled);
+    }
+    for (const QString &name : std::as_const(oldState.subdirs)) {
+      if (!newState.subdirs.contains(name)) forgetTree(snapshot, joinPath(relativeDir, name), result);
+    }
+    result.updated.insert(relativeDir, newState);
+  }
+  return result;
+}
+
+}  // namespace
+
+DirectoryWatcher::DirectoryWatcher(QObject *parent)
+    : QObject(parent),
+      m_watcher(new QFileSystemWatcher(this)),
+      m_debounceTimer(new QTimer(this)),
+      m_pollTimer(new QTimer(this)) {
+  m_debounceTimer->setSingleShot(true);
+  m_debounceTimer->setInterval(500);
+  m_pollTimer->setInterval(60 * 1000);
+
+  connect(m_watcher, &QFileSystemWatcher::directoryChanged, this, &DirectoryWatcher::onDirectoryChanged);
+  connect(m_debounceTimer, &QTimer::timeout, this, &DirectoryWatcher::startRescan);
+  connect(m_pollTimer, &QTimer::timeout, this, &DirectoryWatcher::pollUnwatched);
+}
+
+// Scans only touch values they were handed, so one still running is left to wind down
+DirectoryWatcher::~DirectoryWatcher() { *m_scanCanceled = true; }
+
+void DirectoryWatcher::setDebounceInterval(int ms) { m_debounceTimer->setInterval(ms); }
+
+void DirectoryWatcher::setPollInterval(int ms) { m_pollTimer->setInterval(ms); }
+
+void DirectoryWatcher::setRoot(const QString &root) {
+  QString cleanRoot = root.isEmpty() ? QString() : QDir::cleanPath(root);
+  if (cleanRoot == m_root) return;
+
+  m_debounceTimer->stop();
+  // A scan of the old root may still be listing a large tree; it stops early and its
+  // result is dropped instead of holding up the switch
+  *m_scanCanceled = true;
+  m_scanCanceled = std::make_shared<std::atomic_bool>(false);
+  m_generation++;
+  m_scanRunning = false;
+  if (!m_watcher->directories().isEmpty()) {
+    m_watcher->removePaths(m_watcher->directories());
+  }
+  m_snapshot.clear();
+  m_pendingDirs.clear();
+  m_unwatchedDirs.clear();
+  m_pollTimer->stop();
+  m_initialScan = false;
+  m_root = cleanRoot;
+
+  if (m_root.isEmpty() || !QDir(m_root).exists()) return;
+
+  // The initial listing only builds the snapshot; nothing is reported for it
+  m_initialScan = true;
+  QString scanRoot = m_root;
+  runScan([scanRoot](const std::atomic_bool &canceled) {
+    ScanResult result;
+    scanTree(scanRoot, QString(), result, canceled);
+    result.added.clear();
+    return result;
+  });
+}
+
+QString DirectoryWatcher::relativeDir(const QString &path) const {
+  QString cleanPath = QDir::cleanPath(path);
+  return cleanPath == m_root ? QString() : QDir(m_root).relativeFilePath(cleanPath);
+}
+
+void DirectoryWatcher::onDirectoryChanged(const QString &path) {
+  m_pendingDirs.insert(relativeDir(path));
+  m_debounceTimer->start();
+}
+
+void DirectoryWatcher::startRescan() {
+  if (m_pendingDirs.isEmpty()) return;
+  if (m_scanRunning) {
+    // Picked up again once the running scan finishes
+    return;
+  }
+
+  QStringList dirs(m_pendingDirs.cbegin(), m_pendingDirs.cend());
+  m_pendingDirs.clear();
+  QString root = m_root;
+  Snapshot snapshot = m_snapshot;
+  runScan([root, dirs, snapshot](const std::atomic_bool &canceled) { return rescan(root, dirs, snapshot, canceled); });
+}
+
+void DirectoryWatcher::runScan(std::function<ScanResult(const std::atomic_bool &canceled)> scan) {
+  m_scanRunning = true;
+  quint64 generation = m_generation;
+  std::shared_ptr<std::atomic_bool> canceled = m_scanCanceled;
+  // One watcher per scan, so a stale scan never holds up the next one
+  auto watcher = new QFutureWatcher<ScanResult>(this);
+  connect(watcher, &QFutureWatcherBase::finished, this, [this, watcher, generation]() {
+    watcher->deleteLater();
+    if (generation != m_generation) return;
+    m_scanRunning = false;
+    if (watcher->future().resultCount() == 0) return;
+    onScanFinished(watcher->result());
+  });
+  watcher->setFuture(QtConcurrent::run([scan, canceled]() { return scan(*canceled); }));
+}
+
+void DirectoryWatcher::onScanFinished(const ScanResult &result) {
+  for (const QString &dir : std::as_const(result.removedDirs)) {
+    m_snapshot.remove(dir);
+    // QFileSystemWatcher drops deleted directories by itself
+    m_unwatchedDirs.remove(dir);
+  }
+  if (m_unwatchedDirs.isEmpty()) m_pollTimer->stop();
+
+  QStringList newDirs;
+  for (auto it = result.updated.cbegin(); it != result.updated.cend(); ++it) {
+    if (!m_snapshot.contains(it.key())) newDirs.append(it.key());
+    m_snapshot.insert(it.key(), it.value());
+  }
+  watchDirs(newDirs);
+
+  if (m_initialScan) {
+    m_initialScan = false;
+    qDebug() << "Watching" << m_snapshot.size() << "directories below" << m_root;
+    emit ready();
+  } else if (!result.added.isEmpty() || !result.removed.isEmpty()) {
+    emit changed(result.added, result.removed);
+  }
+
+  if (!m_pendingDirs.isEmpty()) {
+    m_debounceTimer->start();
+  }
+}
+
+void DirectoryWatcher::watchDirs(const QStringList &relativeDirs) {
+  QStringList paths;
+  for (const QString &dir : relativeDirs) {
+    paths.append(dir.isEmpty() ? m_root : QDir(m_root).filePath(dir));
+  }
+  if (paths.isEmpty()) return;
+
+  const QStringList failed = m_watcher->addPaths(paths);
+  if (failed.isEmpty()) return;
+
+  qDebug() << "Failed to watch" << failed.size() << "directories, e.g." << failed.first();
+  bool first = m_unwatchedDirs.isEmpty();
+  for (const QString &path : failed) m_unwatchedDirs.insert(relativeDir(path));
+  m_pollTimer->start();
+  if (first) emit watchLimitReached(m_unwatchedDirs.size());
+}
+
+void DirectoryWatcher::pollUnwatched() {
+  // Watches may have been freed since; whatever is still refused gets re-listed
+  QStringList paths;
+  for (const QString &dir : std::as_const(m_unwatchedDirs)) {
+    paths.append(dir.isEmpty() ? m_root : QDir(m_root).filePath(dir));
+  }
+  const QStringList failed = m_watcher->addPaths(paths);
+  QSet<QString> stillUnwatched;
+  for (const QString &path : failed) stillUnwatched.insert(relativeDir(path));
+  // Changes made before a watch was added would go unnoticed otherwise
+  m_pendingDirs.unite(m_unwatchedDirs);
+  m_unwatchedDirs = stillUnwatched;
+  if (m_unwatchedDirs.isEmpty()) m_pollTimer->stop();
+  startRescan();
+}
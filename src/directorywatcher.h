@@ -0,0 +1,74 @@
+#pragma once
+
+#include <QHash>
+#include <QObject>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+#include <atomic>
+#include <functional>
+#include <memory>
+
+class QFileSystemWatcher;
+class QTimer;
+
+// Watches a directory tree (inotify / ReadDirectoryChangesW through QFileSystemWatcher)
+// and reports file additions and removals as relative paths, in debounced batches.
+// Only the directories that changed are re-listed, on a worker thread. Directories the
+// OS refuses to watch (inotify's max_user_watches) are rescanned periodically instead.
+class DirectoryWatcher : public QObject {
+  Q_OBJECT
+
+ public:
+  explicit DirectoryWatcher(QObject *parent = nullptr);
+  ~DirectoryWatcher();
+
+  QString root() const { return m_root; }
+  // An empty root stops watching
+  void setRoot(const QString &root);
+  void setDebounceInterval(int ms);
+  void setPollInterval(int ms);
+
+  struct DirState {
+    QSet<QString> files;
+    QSet<QString> subdirs;
+  };
+  using Snapshot = QHash<QString, DirState>;  // keyed by relative directory, "" is the root
+
+  struct ScanResult {
+    Snapshot updated;
+    QStringList removedDirs;
+    QStringList added;
+    QStringList removed;
+  };
+
+ signals:
+  void ready();
+  void changed(const QStringList &added, const QStringList &removed);
+  // Some directories could not be watched and are polled from now on
+  void watchLimitReached(int unwatchedDirs);
+
+ private:
+  // "" for the root
+  QString relativeDir(const QString &path) const;
+  void onDirectoryChanged(const QString &path);
+  void startRescan();
+  // Runs `scan` on a worker; the result is dropped if the root changed in the meantime
+  void runScan(std::function<ScanResult(const std::atomic_bool &canceled)> scan);
+  void onScanFinished(const ScanResult &result);
+  void watchDirs(const QStringList &relativeDirs);
+  void pollUnwatched();
+
+  QString m_root;
+  QFileSystemWatcher *m_watcher = nullptr;
+  QTimer *m_debounceTimer = nullptr;
+  QTimer *m_pollTimer = nullptr;
+  Snapshot m_snapshot;
+  QSet<QString> m_pendingDirs;
+  QSet<QString> m_unwatchedDirs;  // relative, see pollUnwatched()
+  bool m_initialScan = false;
+  bool m_scanRunning = false;
+  // Bumped by setRoot(); a scan started under an older generation is canceled and ignored
+  quint64 m_generation = 0;
+  std::shared_ptr<std::atomic_bool> m_scanCanceled = std::make_shared<std::atomic_bool>(false);
+};
@@ -0,0 +1,765 @@
+#include "downloadengine.h"
+
+#include <QDebug>
+#include <QRandomGenerator>
+#include <algorithm>
+#include <limits>
+
+#include "netstats.h"
+
+namespace {
+
+// Past this much of the body the sniffer's answer is taken as Accept
+const int kMaxSniffBytes = 64 * 1024;
+// Progress is posted to the queue's thread at most this often
+const int kProgressIntervalMs = 50;
+// Unfinished downloads and their partial bodies are written at most this often
+const int kJournalIntervalMs = 1000;
+// Read buffer of each reply while shaping; also the smallest burst a token bucket allows
+const qint64 kShapedReadBufferSize = 64 * 1024;
+// How often buffered bodies are read while a rate limit holds them back
+const int kPaceIntervalMs = 20;
+// Interface counters are compared with our own traffic this often
+const int kTrafficSampleMs = 1000;
+// Traffic that is not ours above this rate counts as someone else using the link
+const qint64 kForegroundBytesPerSecond = 64 * 1024;
+// Downloads continue once there has been no such traffic for this long
+const qint64 kForegroundQuietMs = 5000;
+// A reply that moves no data for this long, without us holding it back, is given up on
+const qint64 kStallTimeoutMs = 60000;
+const int kStallCheckMs = 5000;
+// Headers, TLS and TCP on top of the body bytes Qt reports
+const double kWireOverhead = 1.1;
+const qint64 kUnlimited = std::numeric_limits<qint64>::max();
+
+// First byte of a "bytes <first>-<last>/<total>" Content-Range, -1 if there is none
+qint64 contentRangeStart(const QByteArray &header) {
+  QByteArray value = header.trimmed().toLower();
+  if (!value.startsWith("bytes ")) return -1;
+  int dash = value.indexOf('-');
+  if (dash < 0) return -1;
+  bool ok = false;
+  qint64 first = value.mid(6, dash - 6).trimmed().toLongLong(&ok);
+  return ok ? first : -1;
+}
+
+}  // namespace
+
+DownloadEngine::DownloadEngine(DownloadQueue *owner)
+    : m_owner(owner),
+      m_networkManager(new QNetworkAccessManager(this)),
+      m_progressTimer(new QTimer(this)),
+      m_journalTimer(new QTimer(this)),
+      m_paceTimer(new QTimer(this)),
+      m_trafficCounter(&netstats::receivedBytes),
+      m_trafficTimer(new QTimer(this)),
+      m_stallTimer(new QTimer(this)) {
+  m_progressTimer->setInterval(kProgressIntervalMs);
+  m_progressTimer->setSingleShot(true);
+  connect(m_progressTimer, &QTimer::timeout, this, &DownloadEngine::flushProgress);
+  m_journalTimer->setInterval(kJournalIntervalMs);
+  m_journalTimer->setSingleShot(true);
+  connect(m_journalTimer, &QTimer::timeout, this, &DownloadEngine::flushJournal);
+  m_clock.start();
+  m_paceTimer->setInterval(kPaceIntervalMs);
+  m_paceTimer->setSingleShot(true);
+  connect(m_paceTimer, &QTimer::timeout, this, &DownloadEngine::pace);
+  m_trafficTimer->setInterval(kTrafficSampleMs);
+  connect(m_trafficTimer, &QTimer::timeout, this, &DownloadEngine::sampleTraffic);
+  m_stallTimer->setInterval(kStallCheckMs);
+  connect(m_stallTimer, &QTimer::timeout, this, &DownloadEngine::checkStalls);
+}
+
+DownloadEngine::~DownloadEngine() {
+  if (m_journal) flushJournal();
+}
+
+QList<DownloadJournal::Entry> DownloadEngine::openJournal(const QString &filePath) {
+  m_journal = std::make_unique<DownloadJournal>(filePath);
+  QList<DownloadJournal::Entry> entries;
+  QString error;
+  if (!m_journal->load(&entries, &error)) {
+    qDebug() << "Failed to load download journal:" << error;
+  }
+  m_restored.clear();
+  for (const DownloadJournal::Entry &entry : std::as_const(entries)) {
+    m_restored.insert(entry.url.adjusted(QUrl::RemoveFragment), entry);
+  }
+  return entries;
+}
+
+void DownloadEngine::setMaxConcurrent(int maxConcurrent) {
+  m_maxConcurrent = qMax(1, maxConcurrent);
+  startNext();
+}
+
+void DownloadEngine::setMaxPerHost(int maxPerHost) {
+  m_maxPerHost = qMax(0, maxPerHost);
+  startNext();
+}
+
+QString DownloadEngine::hostKey(const QUrl &url) {
+  int port = url.port(url.scheme() == "https" ? 443 : 80);
+  return QString("%1://%2:%3").arg(url.scheme(), url.host().toLower()).arg(port);
+}
+
+bool DownloadEngine::hostHasCapacity(const QString &key) const {
+  return m_maxPerHost <= 0 || m_activePerHost.value(key) < m_maxPerHost;
+}
+
+void DownloadEngine::enqueue(int id, const QUrl &requestUrl, int priority, const DownloadQueue::Validators &cached) {
+  Subscriber subscriber{id, priority};
+  // The fragment never reaches the server, so #a and #b are the same transfer
+  const QUrl url = requestUrl.adjusted(QUrl::RemoveFragment);
+
+  auto existing = m_items.find(m_transferByUrl.value(url));
+  if (existing != m_items.end() && !existing->paused && !existing->canceled && existing->cached == cached) {
+    // Same URL already on its way: share the transfer instead of fetching it again
+    qDebug() << "Joining download of" << url.toString();
+    m_transferOf.insert(id, existing->id);
+    existing->subscribers.append(subscriber);
+    if (existing->reply) {
+      QMetaObject::invokeMethod(
+          m_owner, [owner = m_owner, id]() { owner->deliverStarted({id}); }, Qt::QueuedConnection);
+    }
+    updatePriority(*existing);
+    return;
+  }
+
+  DownloadItem item;
+  item.id = m_nextId++;
+  item.url = url;
+  item.cached = cached;
+  item.priority = priority;
+  item.sequence = m_nextSequence++;
+  item.subscribers.append(subscriber);
+  auto restored = m_restored.constFind(url);
+  if (restored != m_restored.constEnd()) {
+    item.received = m_journal->readPartial(restored->url);
+    item.journaled = item.received.size();
+    if (restored->url != url) {
+      // Written before fragments were dropped: move it under the key it is looked up by now
+      m_journal->removePartial(restored->url);
+      item.journaled = 0;
+    }
+    item.furthest = item.received.size();
+    // Only bodies of servers that took ranges were written
+    item.acceptsRanges = !item.received.isEmpty();
+    item.served = {restored->etag, restored->lastModified};
+    qDebug() << "Resuming" << url.toString() << "with" << item.received.size() << "byte(s) from the last run";
+    m_restored.erase(restored);
+  }
+  m_items.insert(item.id, item);
+  m_transferOf.insert(id, item.id);
+  m_transferByUrl.insert(url, item.id);
+  m_queue.emplace(queueKey(item), item.id);
+  scheduleJournal(true);
+  startNext();
+  updateCounts();
+}
+
+DownloadEngine::DownloadItem *DownloadEngine::transferFor(int id) {
+  auto transferIt = m_transferOf.constFind(id);
+  if (transferIt == m_transferOf.constEnd()) return nullptr;
+  auto it = m_items.find(transferIt.value());
+  return it == m_items.end() ? nullptr : &it.value();
+}
+
+QList<int> DownloadEngine::subscriberIds(const DownloadItem &item) {
+  QList<int> ids;
+  ids.reserve(item.subscribers.size());
+  for (const Subscriber &subscriber : item.subscribers) {
+    ids.append(subscriber.id);
+  }
+  return ids;
+}
+
+void DownloadEngine::updatePriority(DownloadItem &item) {
+  int priority = DownloadQueue::Low;
+  for (const Subscriber &subscriber : std::as_const(item.subscribers)) {
+    priority = qMax(priority, subscriber.priority);
+  }
+  if (item.subscribers.isEmpty() || priority == item.priority) return;
+
+  bool waiting = isWaiting(item);
+  if (waiting) m_queue.erase(queueKey(item));
+  item.priority = priority;
+  if (waiting) m_queue.emplace(queueKey(item), item.id);
+}
+
+DownloadEngine::DownloadItem DownloadEngine::takeTransfer(int transferId) {
+  DownloadItem item = m_items.take(transferId);
+  m_queue.erase(queueKey(item));
+  m_progress.remove(transferId);
+  for (const Subscriber &subscriber : std::as_const(item.subscribers)) {
+    m_transferOf.remove(subscriber.id);
+  }
+  auto byUrl = m_transferByUrl.find(item.url);
+  if (byUrl != m_transferByUrl.end() && byUrl.value() == transferId) m_transferByUrl.erase(byUrl);
+  if (m_journal) {
+    if (item.journaled > 0) m_journal->removePartial(item.url);
+    scheduleJournal(true);
+  }
+  return item;
+}
+
+void DownloadEngine::cancel(int id) {
+  DownloadItem *item = transferFor(id);
+  if (!item) return;
+
+  item->subscribers.removeIf([id](const Subscriber &subscriber) { return subscriber.id == id; });
+  m_transferOf.remove(id);
+
+  if (!item->subscribers.isEmpty()) {
+    updatePriority(*item);
+    return;
+  }
+  if (item->reply) {
+    // The finished handler drops the transfer and frees the reply's buffers
+    item->canceled = true;
+    discardReceived(*item);
+    auto byUrl = m_transferByUrl.find(item->url);
+    if (byUrl != m_transferByUrl.end() && byUrl.value() == item->id) m_transferByUrl.erase(byUrl);
+    item->reply->abort();
+  } else {
+    takeTransfer(item->id);
+    updateCounts();
+  }
+}
+
+void DownloadEngine::setPriority(int id, int priority) {
+  DownloadItem *item = transferFor(id);
+  if (!item) return;
+
+  for (Subscriber &subscriber : item->subscribers) {
+    if (subscriber.id == id) subscriber.priority = priority;
+  }
+  updatePriority(*item);
+  startNext();
+}
+
+void DownloadEngine::setPaused(DownloadItem &item, bool paused) {
+  item.paused = paused;
+  QMetaObject::invokeMethod(
+      m_owner, [owner = m_owner, ids = subscriberIds(item), paused]() { owner->deliverPaused(ids, paused); },
+      Qt::QueuedConnection);
+}
+
+void DownloadEngine::pause(int id) {
+  DownloadItem *item = transferFor(id);
+  if (!item || item->paused) return;
+
+  bool waiting = isWaiting(*item);
+  setPaused(*item, true);
+  item->restart = false;
+  if (item->reply) {
+    item->reply->abort();
+  } else if (waiting) {
+    m_queue.erase(queueKey(*item));
+    updateCounts();
+  }
+}
+
+void DownloadEngine::resume(int id) {
+  DownloadItem *item = transferFor(id);
+  if (!item || !item->paused) return;
+
+  setPaused(*item, false);
+  if (item->reply) {
+    // Still winding down from pause(); the finished handler queues it again
+    item->restart = true;
+    return;
+  }
+  // The backoff timer queues it
+  if (item->retryPending) return;
+  m_queue.emplace(queueKey(*item), item->id);
+  startNext();
+  updateCounts();
+}
+
+void DownloadEngine::updateCounts() {
+  m_owner->m_pendingCount.storeRelaxed(int(m_queue.size()));
+  m_owner->m_activeCount.storeRelaxed(m_activeDownloads.count());
+}
+
+void DownloadEngine::scheduleJournal(bool listChanged) {
+  if (!m_journal) return;
+  m_journalListChanged = m_journalListChanged || listChanged;
+  if (!m_journalTimer->isActive()) m_journalTimer->start();
+}
+
+void DownloadEngine::discardReceived(DownloadItem &item) {
+  item.received.clear();
+  if (item.journaled == 0) return;
+  // Whatever comes next may be another version of the file; it must not land after the old prefix
+  if (m_journal) m_journal->removePartial(item.url);
+  item.journaled = 0;
+}
+
+void DownloadEngine::flushJournal() {
+  QString error;
+  for (DownloadItem &item : m_items) {
+    // Bodies that cannot be resumed with a range are not worth the disk
+    qint64 size = item.canceled || !item.acceptsRanges ? 0 : item.received.size();
+    if (size == item.journaled) continue;
+    if (!m_journal->writePartial(item.url, size > 0 ? item.received : QByteArray(), item.journaled, &error)) {
+      qDebug() << "Failed to write partial download of" << item.url.toString() << ":" << error;
+      continue;
+    }
+    item.journaled = size;
+  }
+
+  if (!m_journalListChanged) return;
+  m_journalListChanged = false;
+  QList<const DownloadItem *> items;
+  items.reserve(m_items.size());
+  for (const DownloadItem &item : std::as_const(m_items)) {
+    if (!item.canceled) items.append(&item);
+  }
+  // Restored in the order they were queued
+  std::sort(items.begin(), items.end(),
+            [](const DownloadItem *a, const DownloadItem *b) { return a->sequence < b->sequence; });
+  QList<DownloadJournal::Entry> entries;
+  entries.reserve(items.size());
+  for (const DownloadItem *item : std::as_const(items)) {
+    entries.append({item->url, item->priority, item->served.etag, item->served.lastModified});
+  }
+  if (!m_journal->save(entries, &error)) {
+    qDebug() << "Failed to save download journal:" << error;
+  }
+  // Not asked for again this run; their partial bodies are cleaned up on the next load
+  m_restored.clear();
+}
+
+void DownloadEngine::flushProgress() {
+  QList<DownloadQueue::Progress> batch;
+  for (auto it = m_progress.cbegin(); it != m_progress.cend(); ++it) {
+    auto item = m_items.constFind(it.key());
+    if (item == m_items.constEnd()) continue;
+    for (const Subscriber &subscriber : item->subscribers) {
+      batch.append({subscriber.id, it->first, it->second});
+    }
+  }
+  m_progress.clear();
+  if (batch.isEmpty()) return;
+  QMetaObject::invokeMethod(
+      m_owner, [owner = m_owner, batch = std::move(batch)]() { owner->deliverProgress(batch); },
+      Qt::QueuedConnection);
+}
+
+void DownloadEngine::startNext() {
+  // Connecting would already compete with the foreground traffic
+  if (m_foregroundBusy) {
+    updateCounts();
+    return;
+  }
+  while (!m_queue.empty() && m_activeDownloads.count() < m_maxConcurrent) {
+    // First waiting item whose host still has a free slot; saturated hosts are skipped, not waited on
+    auto next = m_queue.begin();
+    while (next != m_queue.end() && !hostHasCapacity(hostKey(m_items[next->second].url))) {
+      ++next;
+    }
+    if (next == m_queue.end()) break;
+    int id = next->second;
+    m_queue.erase(next);
+    start(m_items[id]);
+  }
+  updateCounts();
+}
+
+void DownloadEngine::start(DownloadItem &item) {
+  int id = item.id;
+  QString key = hostKey(item.url);
+  m_activePerHost[key]++;
+
+  QNetworkRequest request(item.url);
+  request.setHeader(QNetworkRequest::UserAgentHeader, "Mozilla/5.0 (compatible; ClipboardToolbox/1.0)");
+  request.setAttribute(QNetworkRequest::Http2AllowedAttribute, true);
+  item.offset = 0;
+  if (!item.received.isEmpty()) {
+    if (item.acceptsRanges) {
+      // If-Range makes the server send the whole file again if it changed in between;
+      // weak ETags may not be used there
+      QByteArray validator = item.served.etag.startsWith("W/") ? QByteArray() : item.served.etag;
+      if (validator.isEmpty()) validator = item.served.lastModified;
+      item.offset = item.received.size();
+      request.setRawHeader("Range", "bytes=" + QByteArray::number(item.offset) + "-");
+      if (!validator.isEmpty()) request.setRawHeader("If-Range", validator);
+    } else {
+      discardReceived(item);
+    }
+  } else if (!item.cached.isEmpty()) {
+    if (!item.cached.etag.isEmpty()) request.setRawHeader("If-None-Match", item.cached.etag);
+    if (!item.cached.lastModified.isEmpty()) request.setRawHeader("If-Modified-Since", item.cached.lastModified);
+  }
+
+  QNetworkReply *reply = m_networkManager->get(request);
+  reply->setReadBufferSize(isShaped() ? kShapedReadBufferSize : 0);
+  item.reply = reply;
+  item.wireBytes = 0;
+  item.activeMs = m_clock.elapsed();
+  if (!m_stallTimer->isActive()) m_stallTimer->start();
+  item.bucket.setRate(m_rateLimit.perDownloadBytesPerSecond, m_clock.elapsed());
+  m_activeDownloads.insert(reply, id);
+
+  QMetaObject::invokeMethod(
+      m_owner, [owner = m_owner, ids = subscriberIds(item)]() { owner->deliverStarted(ids); }, Qt::QueuedConnection);
+
+  connect(reply, &QNetworkReply::metaDataChanged, this, [this, reply, id]() {
+    auto it = m_items.find(id);
+    if (it != m_items.end() && it->reply == reply) onMetaDataChanged(*it, reply);
+  });
+
+  // The body is collected here rather than read at the end so a failed attempt keeps it
+  connect(reply, &QNetworkReply::readyRead, this, [this, reply, id]() {
+    auto it = m_items.find(id);
+    if (it == m_items.end() || it->reply != reply || it->canceled) return;
+    readBody(*it, reply, kUnlimited);
+  });
+
+  connect(reply, &QNetworkReply::downloadProgress, this, [this, reply, id](qint64 bytesReceived, qint64 bytesTotal) {
+    auto it = m_items.find(id);
+    if (it == m_items.end() || it->reply != reply) return;
+    m_wireBytes += qMax<qint64>(0, bytesReceived - it->wireBytes);
+    it->wireBytes = bytesReceived;
+    it->activeMs = m_clock.elapsed();
+    if (it->paused || it->canceled) return;
+    // Only the latest value per transfer survives until the next flush
+    m_progress.insert(id, {it->offset + bytesReceived, bytesTotal > 0 ? it->offset + bytesTotal : bytesTotal});
+    if (!m_progressTimer->isActive()) m_progressTimer->start();
+  });
+
+  connect(reply, &QNetworkReply::finished, this, [this, reply, key, id]() {
+    if (!m_activeDownloads.remove(reply)) return;
+    if (--m_activePerHost[key] <= 0) m_activePerHost.remove(key);
+    reply->deleteLater();
+
+    auto it = m_items.find(id);
+    if (it == m_items.end()) {
+      startNext();
+      return;
+    }
+    it->reply = nullptr;
+
+    if (!it->canceled && (it->paused || it->restart)) {
+      // Aborted by pause(): stays parked, or goes back in line if resumed meanwhile.
+      // Aborted over a bad Content-Range: goes back in line for the whole body.
+      if (it->restart) {
+        it->restart = false;
+        m_queue.emplace(queueKey(*it), id);
+      }
+      startNext();
+      return;
+    }
+
+    if (!it->canceled && !it->rejected && reply->error() != QNetworkReply::NoError && scheduleRetry(*it, reply)) {
+      startNext();
+      return;
+    }
+
+    DownloadItem item = takeTransfer(id);
+    if (item.canceled) {
+      // Every subscriber was told when it canceled
+      startNext();
+      return;
+    }
+
+    QByteArray data;
+    bool success = false;
+    QString errorString;
+    DownloadQueue::Response response;
+
+    if (item.rejected) {
+      errorString = DownloadQueue::kRejectedError;
+    } else if (reply->error() == QNetworkReply::NoError) {
+      response.notModified = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt() == 304;
+      response.validators = response.notModified ? item.cached : item.served;
+      if (!response.notModified) {
+        item.received.append(reply->readAll());
+        data = std::move(item.received);
+      }
+      success = true;
+    } else {
+      errorString = reply->errorString();
+    }
+
+    // The body is moved across; every subscriber then shares the same buffer
+    QMetaObject::invokeMethod(
+        m_owner,
+        [owner = m_owner, ids = subscriberIds(item), data = std::move(data), success, errorString, response]() mutable {
+          owner->deliverFinished(ids, std::move(data), success, errorString, response);
+        },
+        Qt::QueuedConnection);
+
+    startNext();
+  });
+}
+
+void DownloadEngine::onMetaDataChanged(DownloadItem &item, QNetworkReply *reply) {
+  int status = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+  if (status != 200 && status != 206) return;
+
+  if (status == 200 && item.offset > 0) {
+    // Range ignored, or the file changed and If-Range sent all of it
+    discardReceived(item);
+    item.offset = 0;
+  } else if (status == 206 && contentRangeStart(reply->rawHeader("Content-Range")) != item.offset) {
+    // Appending this part would splice the body at the wrong place; fetch all of it instead
+    qDebug() << "Unexpected Content-Range" << reply->rawHeader("Content-Range") << "for" << item.url.toString()
+             << "at offset" << item.offset;
+    // Without a range asked for, the response is just broken: a failed attempt
+    item.restart = item.offset > 0;
+    discardReceived(item);
+    item.offset = 0;
+    item.acceptsRanges = false;
+    scheduleJournal(false);
+    reply->abort();
+    return;
+  }
+  item.acceptsRanges = status == 206 || reply->rawHeader("Accept-Ranges").trimmed().toLower() == "bytes";
+  item.served.etag = reply->rawHeader("ETag");
+  item.served.lastModified = reply->rawHeader("Last-Modified");
+  scheduleJournal(true);
+  if (!item.sniffed) sniff(item, reply);
+}
+
+void DownloadEngine::readBody(DownloadItem &item, QNetworkReply *reply, qint64 limit) {
+  int status = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+  qint64 allowed = reply->bytesAvailable();
+  // Error pages are small and thrown away, so they are read off unshaped
+  if (status < 300 && isShaped()) {
+    qint64 now = m_clock.elapsed();
+    allowed = m_foregroundBusy ? 0 : std::min({allowed, limit, m_bucket.available(now), item.bucket.available(now)});
+  }
+  QByteArray chunk = allowed > 0 ? reply->read(allowed) : QByteArray();
+  // Left in the buffer is read by pace(); while it is full the server is held back
+  if (reply->bytesAvailable() > 0 && !m_foregroundBusy && !m_paceTimer->isActive()) m_paceTimer->start();
+  // Error pages are not part of the file
+  if (chunk.isEmpty() || status >= 300) return;
+
+  m_bucket.consume(chunk.size());
+  item.bucket.consume(chunk.size());
+  item.received.append(chunk);
+  scheduleJournal(false);
+  // Last: rejecting the response aborts the reply, which may finish the transfer
+  if (!item.sniffed) sniff(item, reply);
+}
+
+bool DownloadEngine::isShaped() const {
+  return m_bucket.rate > 0 || m_rateLimit.perDownloadBytesPerSecond > 0 || m_pauseOnForegroundTraffic;
+}
+
+void DownloadEngine::setRateLimit(const DownloadQueue::RateLimit &limit) {
+  m_rateLimit = limit;
+  qint64 now = m_clock.elapsed();
+  m_bucket.setRate(limit.totalBytesPerSecond, now);
+  for (DownloadItem &item : m_items) {
+    item.bucket.setRate(limit.perDownloadBytesPerSecond, now);
+  }
+  updateShaping();
+}
+
+void DownloadEngine::setPauseOnForegroundTraffic(bool enabled) {
+  m_pauseOnForegroundTraffic = enabled;
+  m_lastSystemBytes = -1;
+  if (enabled) {
+    m_trafficTimer->start();
+    sampleTraffic();
+  } else {
+    m_trafficTimer->stop();
+    setForegroundBusy(false);
+  }
+  updateShaping();
+}
+
+void DownloadEngine::updateShaping() {
+  for (auto it = m_activeDownloads.cbegin(); it != m_activeDownloads.cend(); ++it) {
+    it.key()->setReadBufferSize(isShaped() ? kShapedReadBufferSize : 0);
+  }
+  pace();
+}
+
+void DownloadEngine::pace() {
+  if (m_foregroundBusy) return;
+  QList<QNetworkReply *> waiting;
+  for (auto it = m_activeDownloads.cbegin(); it != m_activeDownloads.cend(); ++it) {
+    if (it.key()->bytesAvailable() > 0) waiting.append(it.key());
+  }
+  if (waiting.isEmpty()) return;
+
+  // Equal shares of the global budget, so the replies read first cannot starve the others
+  qint64 share = kUnlimited;
+  if (m_bucket.rate > 0) share = qMax<qint64>(1, m_bucket.available(m_clock.elapsed()) / waiting.size());
+  for (QNetworkReply *reply : std::as_const(waiting)) {
+    // An earlier read may have finished another transfer
+    auto active = m_activeDownloads.constFind(reply);
+    if (active == m_activeDownloads.constEnd()) continue;
+    auto it = m_items.find(active.value());
+    if (it == m_items.end() || it->reply != reply || it->canceled) continue;
+    readBody(*it, reply, share);
+  }
+}
+
+void DownloadEngine::setTrafficCounter(const DownloadQueue::TrafficCounter &counter) {
+  m_trafficCounter = counter ? counter : DownloadQueue::TrafficCounter(&netstats::receivedBytes);
+  m_lastSystemBytes = -1;
+}
+
+void DownloadEngine::sampleTraffic() {
+  qint64 systemBytes = m_trafficCounter();
+  if (systemBytes < 0) return;
+  qint64 now = m_clock.elapsed();
+  // Arrived for our replies, but still in the kernel because we are reading slowly or not
+  // at all: counted by the interfaces already, by m_wireBytes only once read
+  qint64 unreadBytes = netstats::unreadBytes();
+
+  if (m_lastSystemBytes >= 0 && now > m_lastSampleMs && systemBytes >= m_lastSystemBytes) {
+    qint64 ours = qint64((m_wireBytes - m_lastWireBytes + unreadBytes - m_lastUnreadBytes) * kWireOverhead);
+    qint64 others = qMax<qint64>(0, systemBytes - m_lastSystemBytes - ours);
+    if (others * 1000 / (now - m_lastSampleMs) > kForegroundBytesPerSecond) {
+      m_lastForegroundMs = now;
+      setForegroundBusy(true);
+    } else if (m_foregroundBusy && now - m_lastForegroundMs >= kForegroundQuietMs) {
+      setForegroundBusy(false);
+    }
+  }
+  m_lastSystemBytes = systemBytes;
+  m_lastWireBytes = m_wireBytes;
+  m_lastUnreadBytes = unreadBytes;
+  m_lastSampleMs = now;
+}
+
+void DownloadEngine::setForegroundBusy(bool busy) {
+  if (m_foregroundBusy == busy) return;
+  m_foregroundBusy = busy;
+  qDebug() << (busy ? "Holding downloads back for foreground traffic" : "Foreground traffic over, downloading");
+  QMetaObject::invokeMethod(
+      m_owner, [owner = m_owner, busy]() { emit owner->foregroundTrafficChanged(busy); }, Qt::QueuedConnection);
+  if (!busy) {
+    startNext();
+    pace();
+  }
+}
+
+void DownloadEngine::checkStalls() {
+  if (m_activeDownloads.isEmpty()) {
+    m_stallTimer->stop();
+    return;
+  }
+  qint64 now = m_clock.elapsed();
+  QList<QNetworkReply *> stalled;
+  for (auto it = m_activeDownloads.cbegin(); it != m_activeDownloads.cend(); ++it) {
+    auto item = m_items.find(it.value());
+    if (item == m_items.end() || item->reply != it.key()) continue;
+    // Data waiting in the read buffer, or none taken at all, is our doing, not the server's
+    if (m_foregroundBusy || it.key()->bytesAvailable() > 0) {
+      item->activeMs = now;
+    } else if (now - item->activeMs >= kStallTimeoutMs) {
+      stalled.append(it.key());
+    }
+  }
+  // Aborting finishes the reply, which may start others; hence the separate pass
+  for (QNetworkReply *reply : std::as_const(stalled)) {
+    qDebug() << "No data from" << reply->url().toString() << "for" << kStallTimeoutMs << "ms, giving up on the reply";
+    reply->abort();
+  }
+}
+
+qint64 DownloadEngine::TokenBucket::capacity() const { return qMax(rate / 4, kShapedReadBufferSize); }
+
+void DownloadEngine::TokenBucket::refill(qint64 nowMs) {
+  if (rate > 0) tokens = qMin(double(capacity()), tokens + double(rate) * (nowMs - updatedMs) / 1000);
+  updatedMs = nowMs;
+}
+
+void DownloadEngine::TokenBucket::setRate(qint64 bytesPerSecond, qint64 nowMs) {
+  refill(nowMs);
+  rate = qMax<qint64>(0, bytesPerSecond);
+  tokens = qMin(tokens, double(capacity()));
+}
+
+qint64 DownloadEngine::TokenBucket::available(qint64 nowMs) {
+  if (rate <= 0) return kUnlimited;
+  refill(nowMs);
+  return qMax<qint64>(0, qint64(tokens));
+}
+
+void DownloadEngine::sniff(DownloadItem &item, QNetworkReply *reply) {
+  if (!m_contentSniffer || item.offset > 0) {
+    item.sniffed = true;
+    return;
+  }
+  QByteArray contentType = reply->header(QNetworkRequest::ContentTypeHeader).toByteArray();
+  DownloadQueue::Verdict verdict = m_contentSniffer(contentType, item.received);
+  if (verdict == DownloadQueue::Verdict::NeedMoreData && item.received.size() < kMaxSniffBytes) return;
+  if (verdict != DownloadQueue::Verdict::Reject) {
+    item.sniffed = true;
+    return;
+  }
+
+  qDebug() << "Not downloading" << item.url.toString() << "any further:" << contentType << "after"
+           << item.received.size() << "byte(s)";
+  item.rejected = true;
+  discardReceived(item);
+  // The finished handler reports it
+  reply->abort();
+}
+
+bool DownloadEngine::isRetryable(QNetworkReply *reply) {
+  int status = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+  if (status == 408 || status == 429 || status >= 500) return true;
+  // Below that the headers arrived fine and the connection failed during the body
+  if (status >= 300) return false;
+
+  switch (reply->error()) {
+    case QNetworkReply::OperationCanceledError:  // checkStalls(); pause and cancel never get here
+    case QNetworkReply::TimeoutError:
+    case QNetworkReply::RemoteHostClosedError:
+    case QNetworkReply::ConnectionRefusedError:
+    case QNetworkReply::TemporaryNetworkFailureError:
+    case QNetworkReply::NetworkSessionFailedError:
+    case QNetworkReply::ProxyTimeoutError:
+    case QNetworkReply::UnknownNetworkError:
+      return true;
+    default:
+      return false;
+  }
+}
+
+bool DownloadEngine::scheduleRetry(DownloadItem &item, QNetworkReply *reply) {
+  // A connection that keeps dropping but gets further each time is making progress, not
+  // failing: the attempts and the backoff start over
+  if (item.received.size() > item.furthest) {
+    item.furthest = item.received.size();
+    item.attempt = 0;
+  }
+
+  int status = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+  if (status == 416) {
+    // Our partial copy no longer fits the file; start over
+    discardReceived(item);
+    item.acceptsRanges = false;
+  } else if (!isRetryable(reply)) {
+    return false;
+  }
+  if (++item.attempt >= m_retryPolicy.maxAttempts) return false;
+
+  // Full jitter keeps many downloads from one failing host from retrying in lockstep
+  qint64 backoff = qint64(m_retryPolicy.baseDelayMs) << qMin(item.attempt - 1, 20);
+  qint64 ceiling = qMin<qint64>(m_retryPolicy.maxDelayMs, backoff);
+  int delayMs = int(QRandomGenerator::global()->bounded(ceiling + 1));
+  qDebug() << "Retrying" << item.url.toString() << "in" << delayMs << "ms (attempt" << item.attempt + 1 << "),"
+           << item.received.size() << "byte(s) kept:" << reply->errorString();
+
+  item.retryPending = true;
+  int id = item.id;
+  QTimer::singleShot(delayMs, this, [this, id]() {
+    auto it = m_items.find(id);
+    if (it == m_items.end() || !it->retryPending) return;
+    it->retryPending = false;
+    if (it->paused) return;
+    m_queue.emplace(queueKey(*it), id);
+    startNext();
+  });
+  return true;
+}
@@ -0,0 +1,167 @@
+#pragma once
+
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QList>
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include <QObject>
+#include <QTimer>
+#include <QUrl>
+#include <map>
+#include <memory>
+#include <utility>
+
+#include "downloadjournal.h"
+#include "downloadqueue.h"
+
+// The part of DownloadQueue that lives on its I/O thread: scheduling, the network manager
+// and every reply. Callers are identified by the handle ids DownloadQueue hands out; what
+// happens to them is posted back to the queue's thread. Only DownloadQueue uses this, and
+// only through queued calls.
+class DownloadEngine : public QObject {
+ public:
+  explicit DownloadEngine(DownloadQueue *owner);
+  // Writes the journal a last time, so what was received so far is kept
+  ~DownloadEngine();
+
+  void setMaxConcurrent(int maxConcurrent);
+  void setMaxPerHost(int maxPerHost);
+  void setRetryPolicy(const DownloadQueue::RetryPolicy &policy) { m_retryPolicy = policy; }
+  void setContentSniffer(const DownloadQueue::ContentSniffer &sniffer) { m_contentSniffer = sniffer; }
+  void setRateLimit(const DownloadQueue::RateLimit &limit);
+  void setPauseOnForegroundTraffic(bool enabled);
+  void setTrafficCounter(const DownloadQueue::TrafficCounter &counter);
+  // Returns what the last run left unfinished; enqueueing one of those URLs picks up its
+  // partial body
+  QList<DownloadJournal::Entry> openJournal(const QString &filePath);
+
+  // URLs differing only in their fragment share one transfer
+  void enqueue(int id, const QUrl &requestUrl, int priority, const DownloadQueue::Validators &cached);
+  // Drops the caller without telling it; DownloadQueue already did
+  void cancel(int id);
+  void setPriority(int id, int priority);
+  void pause(int id);
+  void resume(int id);
+
+ private:
+  // Refilled continuously at `rate` bytes per second, holding at most a quarter second's
+  // worth (but never less than one read buffer)
+  struct TokenBucket {
+    qint64 rate = 0;  // 0 means unlimited
+    double tokens = 0;
+    qint64 updatedMs = 0;
+
+    qint64 capacity() const;
+    void refill(qint64 nowMs);
+    void setRate(qint64 bytesPerSecond, qint64 nowMs);
+    qint64 available(qint64 nowMs);
+    void consume(qint64 bytes) { tokens -= bytes; }
+  };
+  struct Subscriber {
+    int id = 0;
+    int priority = DownloadQueue::Normal;
+  };
+  struct DownloadItem {
+    int id = 0;
+    QUrl url;
+    DownloadQueue::Validators cached;
+    int priority = DownloadQueue::Normal;
+    quint64 sequence = 0;
+    bool paused = false;
+    bool canceled = false;      // every subscriber is gone
+    bool sniffed = false;       // the content sniffer accepted the response
+    bool rejected = false;      // the content sniffer turned it down
+    bool restart = false;       // queue again once the aborted reply has finished
+    bool retryPending = false;  // waiting out a backoff delay
+    int attempt = 0;       // failed attempts since the body last got further
+    qint64 furthest = 0;   // most of the body any attempt got to
+    QNetworkReply *reply = nullptr;
+    QByteArray received;  // body so far, kept across retries
+    qint64 offset = 0;    // bytes of `received` the current reply continues from
+    qint64 journaled = 0;  // bytes of `received` already in the journal's partial file
+    qint64 wireBytes = 0;  // body bytes the current reply took off the network
+    qint64 activeMs = 0;   // when the current reply last moved data, or we last held it back
+    TokenBucket bucket;    // the per-download rate limit
+    bool acceptsRanges = false;
+    DownloadQueue::Validators served;  // from the latest successful response
+    QList<Subscriber> subscribers;
+  };
+  // Orders waiting downloads: highest priority first, then oldest first
+  using QueueKey = std::pair<int, quint64>;
+  static QueueKey queueKey(const DownloadItem &item) { return {-item.priority, item.sequence}; }
+
+  DownloadItem *transferFor(int id);
+  bool isWaiting(const DownloadItem &item) const { return !item.reply && !item.paused && !item.retryPending; }
+  static QList<int> subscriberIds(const DownloadItem &item);
+  void updatePriority(DownloadItem &item);
+  DownloadItem takeTransfer(int transferId);
+  void setPaused(DownloadItem &item, bool paused);
+  void startNext();
+  void start(DownloadItem &item);
+  void onMetaDataChanged(DownloadItem &item, QNetworkReply *reply);
+  void sniff(DownloadItem &item, QNetworkReply *reply);
+  // Reads as much of the reply's buffered body as the rate limits allow, at most `limit`
+  void readBody(DownloadItem &item, QNetworkReply *reply, qint64 limit);
+  bool isShaped() const;
+  void updateShaping();
+  void pace();
+  void sampleTraffic();
+  void setForegroundBusy(bool busy);
+  void checkStalls();
+  bool scheduleRetry(DownloadItem &item, QNetworkReply *reply);
+  static bool isRetryable(QNetworkReply *reply);
+  bool hostHasCapacity(const QString &key) const;
+  static QString hostKey(const QUrl &url);
+  void updateCounts();
+  void flushProgress();
+  void scheduleJournal(bool listChanged);
+  void flushJournal();
+  // Empties `received` and drops its partial file, which a later append would extend
+  void discardReceived(DownloadItem &item);
+
+  DownloadQueue *m_owner;
+  // One manager for all downloads, so requests to the same host share its keep-alive and
+  // HTTP/2 connections
+  QNetworkAccessManager *m_networkManager;
+  QHash<int, DownloadItem> m_items;  // queued, paused and active transfers
+  QHash<int, int> m_transferOf;      // handle id -> transfer id
+  QHash<QUrl, int> m_transferByUrl;  // newest transfer of each URL, the one new callers may join
+  std::map<QueueKey, int> m_queue;   // waiting to start, by priority
+  QHash<QNetworkReply *, int> m_activeDownloads;
+  QHash<QString, int> m_activePerHost;
+  int m_maxConcurrent = 1;
+  int m_maxPerHost = 0;
+  DownloadQueue::RetryPolicy m_retryPolicy;
+  DownloadQueue::ContentSniffer m_contentSniffer;
+  int m_nextId = 1;
+  quint64 m_nextSequence = 0;
+  // Latest progress per transfer, posted to the queue in one batch per interval
+  QHash<int, std::pair<qint64, qint64>> m_progress;
+  QTimer *m_progressTimer;
+  // Written in batches by m_journalTimer, so enqueueing and receiving never wait on the disk
+  std::unique_ptr<DownloadJournal> m_journal;
+  QHash<QUrl, DownloadJournal::Entry> m_restored;  // not enqueued again yet
+  bool m_journalListChanged = false;
+  QTimer *m_journalTimer;
+  // Shaping: replies get a small read buffer, so once it is full TCP flow control slows the
+  // server down, and are read from in step with the token buckets
+  QElapsedTimer m_clock;
+  DownloadQueue::RateLimit m_rateLimit;
+  TokenBucket m_bucket;  // shared by all downloads
+  QTimer *m_paceTimer;
+  bool m_pauseOnForegroundTraffic = false;
+  bool m_foregroundBusy = false;
+  DownloadQueue::TrafficCounter m_trafficCounter;
+  QTimer *m_trafficTimer;
+  qint64 m_wireBytes = 0;  // ours, across all replies
+  qint64 m_lastSystemBytes = -1;
+  qint64 m_lastWireBytes = 0;
+  qint64 m_lastUnreadBytes = 0;
+  // Replaces QNetworkRequest's transfer timeout, which would also fire while shaping or
+  // foreground traffic holds a reply back on purpose
+  QTimer *m_stallTimer;
+  qint64 m_lastSampleMs = 0;
+  qint64 m_lastForegroundMs = 0;
+};
@@ -0,0 +1,127 @@
+#include "downloadjournal.h"
+
+#include <QCryptographicHash>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QSet>
+#include <QStandardPaths>
+#include <QTextStream>
+
+const QString DownloadJournal::kFileName = "download_journal.txt";
+
+namespace {
+
+const QString kPartialSuffix = ".part";
+
+}  // namespace
+
+DownloadJournal::DownloadJournal(const QString &filePath) : m_filePath(filePath) {}
+
+QString DownloadJournal::defaultFilePath() {
+  return QDir(QStandardPaths::writableLocation(QStandardPaths::AppDataLocation)).filePath(kFileName);
+}
+
+QString DownloadJournal::partialDir() const { return m_filePath + ".partial"; }
+
+QString DownloadJournal::partialPath(const QUrl &url) const {
+  QByteArray hash = QCryptographicHash::hash(url.toEncoded(), QCryptographicHash::Md5).toHex();
+  return QDir(partialDir()).filePath(QString::fromLatin1(hash) + kPartialSuffix);
+}
+
+bool DownloadJournal::load(QList<Entry> *entries, QString *error) {
+  entries->clear();
+
+  QFile file(m_filePath);
+  if (file.exists()) {
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+      if (error) *error = file.errorString();
+      return false;
+    }
+    QTextStream in(&file);
+    while (!in.atEnd()) {
+      const QStringList fields = in.readLine().split('\t');
+      if (fields.size() != 4) continue;
+      bool ok = false;
+      Entry entry;
+      entry.priority = fields[0].toInt(&ok);
+      entry.etag = fields[1].toLatin1();
+      entry.lastModified = fields[2].toLatin1();
+      entry.url = QUrl::fromEncoded(fields[3].toLatin1());
+      if (!ok || !entry.url.isValid()) continue;
+      entries->append(entry);
+    }
+    file.close();
+    qDebug() << "Loaded" << entries->size() << "unfinished download(s) from" << m_filePath;
+  }
+
+  // Left behind by downloads that finished or were dropped before the list was rewritten
+  QSet<QString> referenced;
+  for (const Entry &entry : std::as_const(*entries)) {
+    referenced.insert(QFileInfo(partialPath(entry.url)).fileName());
+  }
+  QDir dir(partialDir());
+  for (const QString &name : dir.entryList({"*" + kPartialSuffix}, QDir::Files)) {
+    if (!referenced.contains(name)) dir.remove(name);
+  }
+  return true;
+}
+
+bool DownloadJournal::save(const QList<Entry> &entries, QString *error) {
+  QDir().mkpath(QFileInfo(m_filePath).path());
+  QSaveFile file(m_filePath);
+  if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
+    if (error) *error = file.errorString();
+    return false;
+  }
+  QTextStream out(&file);
+  for (const Entry &entry : entries) {
+    out << entry.priority << '\t' << QString::fromLatin1(entry.etag) << '\t' << QString::fromLatin1(entry.lastModified)
+        << '\t' << QString::fromLatin1(entry.url.toEncoded()) << '\n';
+  }
+  out.flush();
+  if (!file.commit()) {
+    if (error) *error = file.errorString();
+    return false;
+  }
+  return true;
+}
+
+QByteArray DownloadJournal::readPartial(const QUrl &url) const {
+  QFile file(partialPath(url));
+  if (!file.open(QIODevice::ReadOnly)) return QByteArray();
+  return file.readAll();
+}
+
+bool DownloadJournal::writePartial(const QUrl &url, const QByteArray &data, qint64 written, QString *error) {
+  if (data.isEmpty()) {
+    removePartial(url);
+    return true;
+  }
+
+  QDir().mkpath(partialDir());
+  QFile file(partialPath(url));
+  bool grew = written > 0 && data.size() >= written;
+  if (!file.open(grew ? QIODevice::WriteOnly | QIODevice::Append : QIODevice::WriteOnly | QIODevice::Truncate)) {
+    if (error) *error = file.errorString();
+    return false;
+  }
+  // Appending assumes the file still holds exactly what was written before
+  if (grew && file.size() != written) {
+    if (!file.resize(0)) {
+      if (error) *error = file.errorString();
+      return false;
+    }
+    grew = false;
+  }
+  QByteArray tail = grew ? data.mid(written) : data;
+  if (file.write(tail) != tail.size()) {
+    if (error) *error = file.errorString();
+    return false;
+  }
+  return true;
+}
+
+void DownloadJournal::removePartial(const QUrl &url) { QFile::remove(partialPath(url)); }
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <QByteArray>
+#include <QList>
+#include <QString>
+#include <QUrl>
+
+// Downloads that have not finished yet, so they can be picked up again after a restart.
+// Persisted as "<priority>\t<etag>\t<last-modified>\t<url>" lines in the app data location,
+// plus a directory of partial bodies named after the MD5 of their URL. The list is always
+// rewritten whole; the owner decides how often.
+class DownloadJournal {
+ public:
+  struct Entry {
+    QUrl url;
+    int priority = 0;
+    // Sent with the partial body; needed for If-Range when resuming it
+    QByteArray etag;
+    QByteArray lastModified;
+  };
+
+  static const QString kFileName;
+
+  explicit DownloadJournal(const QString &filePath = defaultFilePath());
+  static QString defaultFilePath();
+
+  // Also deletes partial bodies no entry refers to
+  bool load(QList<Entry> *entries, QString *error = nullptr);
+  // Atomically rewrites the list
+  bool save(const QList<Entry> &entries, QString *error = nullptr);
+
+  QByteArray readPartial(const QUrl &url) const;
+  // Brings the partial body on disk, `written` bytes so far, up to `data`: appends when it
+  // only grew, rewrites it otherwise
+  bool writePartial(const QUrl &url, const QByteArray &data, qint64 written, QString *error = nullptr);
+  void removePartial(const QUrl &url);
+
+ private:
+  QString partialDir() const;
+  QString partialPath(const QUrl &url) const;
+
+  QString m_filePath;
+};
@@ -1,20 +1,80 @@
 #include "downloadprogressmodel.h"
 
+#include <QTimer>
+
 #include "utils.h"
 
-DownloadProgressModel::DownloadProgressModel(QObject *parent) : QAbstractListModel(parent) {}
+namespace {
+
+// About one frame at 60 Hz
+const int kFlushIntervalMs = 16;
+// Finished downloads allowed past the limit before folding, so a fold is a batch rather
+// than one row per finished download
+const int kMinFoldSlack = 16;
+
+const QList<int> kStateRoles = {DownloadProgressModel::ProgressRole,    DownloadProgressModel::StatusRole,
+                                DownloadProgressModel::IsFinishedRole,  DownloadProgressModel::IsErrorRole,
+                                DownloadProgressModel::IsQueuedRole,    DownloadProgressModel::IsConnectingRole,
+                                DownloadProgressModel::IsPausedRole};
+
+}  // namespace
+
+int DownloadProgressItem::progress() const {
+  if (state == State::Done || state == State::NotModified) return 100;
+  return bytesTotal > 0 ? int((bytesReceived * 100) / bytesTotal) : 0;
+}
+
+QString DownloadProgressItem::status() const {
+  switch (state) {
+    case State::Queued:
+      return "Queued";
+    case State::Connecting:
+      return "Connecting...";
+    case State::Downloading:
+      if (bytesTotal > 0) {
+        return QString("%1/%2").arg(utils::formatSize(bytesReceived)).arg(utils::formatSize(bytesTotal));
+      }
+      return utils::formatSize(bytesReceived);
+    case State::Paused:
+      return "Paused";
+    case State::Done:
+      return QString("%1 (Done)").arg(utils::formatSize(bytesReceived));
+    case State::Error:
+      return "Error";
+    case State::Canceled:
+      return "Canceled";
+    case State::Rejected:
+      return "Not an image";
+    case State::NotModified:
+      return "Up to date";
+  }
+  return QString();
+}
+
+bool DownloadProgressItem::isFinished() const {
+  return state == State::Done || state == State::Error || state == State::Canceled || state == State::Rejected ||
+         state == State::NotModified;
+}
+
+DownloadProgressModel::DownloadProgressModel(QObject *parent)
+    : QAbstractListModel(parent), m_flushTimer(new QTimer(this)) {
+  m_flushTimer->setSingleShot(true);
+  m_flushTimer->setInterval(kFlushIntervalMs);
+  connect(m_flushTimer, &QTimer::timeout, this, &DownloadProgressModel::flushProgress);
+}
 
 DownloadProgressModel::~DownloadProgressModel() {}
 
 int DownloadProgressModel::rowCount(const QModelIndex &parent) const {
   if (parent.isValid()) return 0;
-  return m_downloads.count();
+  return itemCount() + (hasSummary() ? 1 : 0);
 }
 
 QVariant DownloadProgressModel::data(const QModelIndex &index, int role) const {
-  if (!index.isValid() || index.row() < 0 || index.row() >= m_downloads.count()) return QVariant();
+  if (!index.isValid() || index.row() < 0 || index.row() >= rowCount()) return QVariant();
+  if (index.row() == itemCount()) return summaryData(role);
 
-  const DownloadProgressItem &item = m_downloads[index.row()];
+  const DownloadProgressItem &item = itemAt(index.row());
 
   switch (role) {
     case Qt::DisplayRole:
@@ -24,26 +84,56 @@ QVariant DownloadProgressModel::data(const QModelIndex &index, int role) const {
     case UrlRole:
       return item.url;
     case ProgressRole:
-      return item.progress;
+      return item.progress();
     case StatusRole:
-      return item.status;
+      return item.status();
     case BytesReceivedRole:
       return item.bytesReceived;
     case BytesTotalRole:
       return item.bytesTotal;
     case IsFinishedRole:
-      return item.isFinished;
+      return item.isFinished();
     case IsErrorRole:
-      return item.isError;
+      return item.isError();
     case IsQueuedRole:
-      return item.isQueued;
+      return item.isQueued();
     case IsConnectingRole:
-      return item.isConnecting;
+      return item.isConnecting();
+    case IsPausedRole:
+      return item.isPaused();
   }
 
   return QVariant();
 }
 
+QVariant DownloadProgressModel::summaryData(int role) const {
+  switch (role) {
+    case Qt::DisplayRole:
+      return QString("%1 earlier").arg(m_summary.count);
+    case IdRole:
+      return 0;
+    case ProgressRole:
+      return 100;
+    case StatusRole:
+      if (m_summary.failed > 0) {
+        return QString("%1, %2 failed").arg(utils::formatSize(m_summary.bytesReceived)).arg(m_summary.failed);
+      }
+      return utils::formatSize(m_summary.bytesReceived);
+    case BytesReceivedRole:
+      return m_summary.bytesReceived;
+    case BytesTotalRole:
+      return m_summary.bytesReceived;
+    case IsFinishedRole:
+      return true;
+    case IsErrorRole:
+    case IsQueuedRole:
+    case IsConnectingRole:
+    case IsPausedRole:
+      return false;
+  }
+  return QVariant();
+}
+
 QHash<int, QByteArray> DownloadProgressModel::roleNames() const {
   QHash<int, QByteArray> roles;
   roles[Qt::DisplayRole] = "display";
@@ -57,6 +147,7 @@ QHash<int, QByteArray> DownloadProgressModel::roleNames() const {
   roles[IsErrorRole] = "isError";
   roles[IsQueuedRole] = "isQueued";
   roles[IsConnectingRole] = "isConnecting";
+  roles[IsPausedRole] = "isPaused";
   return roles;
 }
 
@@ -65,81 +156,170 @@ int DownloadProgressModel::addQueuedDownload(const QUrl &url) {
   DownloadProgressItem item;
   item.id = m_nextId++;
   item.url = url;
-  item.isQueued = true;
-  item.status = "Queued";
-  m_downloads.prepend(item);
+  m_downloads.push_back(item);
+  m_slotById.insert(item.id, m_firstSlot + itemCount() - 1);
   endInsertRows();
   return item.id;
 }
 
-void DownloadProgressModel::setConnecting(int id) {
+void DownloadProgressModel::setState(int id, DownloadProgressItem::State state) {
+  // A pending tick must not land after the state it led up to
+  auto pending = m_pendingProgress.constFind(id);
   int row = findRowById(id);
   if (row < 0) return;
 
-  DownloadProgressItem &item = m_downloads[row];
-  item.isQueued = false;
-  item.isConnecting = true;
-  item.status = "Connecting...";
+  DownloadProgressItem &item = itemAt(row);
+  if (pending != m_pendingProgress.constEnd()) {
+    item.bytesReceived = pending->first;
+    item.bytesTotal = pending->second;
+    m_pendingProgress.erase(pending);
+  }
+  bool wasFinished = item.isFinished();
+  item.state = state;
+  m_finishedCount += int(item.isFinished()) - int(wasFinished);
+  QList<int> roles = kStateRoles;
+  roles << BytesReceivedRole << BytesTotalRole;
+  emit dataChanged(index(row), index(row), roles);
 
-  emit dataChanged(index(row), index(row), {StatusRole, IsQueuedRole, IsConnectingRole});
+  if (!wasFinished && item.isFinished()) foldExcessFinished();
 }
 
-void DownloadProgressModel::updateProgress(int id, qint64 bytesReceived, qint64 bytesTotal) {
-  int row = findRowById(id);
-  if (row < 0) return;
+void DownloadProgressModel::setConnecting(int id) { setState(id, DownloadProgressItem::State::Connecting); }
 
-  DownloadProgressItem &item = m_downloads[row];
-  item.isQueued = false;
-  item.isConnecting = false;
-  item.bytesReceived = bytesReceived;
-  item.bytesTotal = bytesTotal;
+void DownloadProgressModel::updateProgress(int id, qint64 bytesReceived, qint64 bytesTotal) {
+  m_pendingProgress.insert(id, {bytesReceived, bytesTotal});
+  if (!m_flushTimer->isActive()) m_flushTimer->start();
+}
 
-  if (bytesTotal > 0) {
-    item.progress = (int)((bytesReceived * 100) / bytesTotal);
-    item.status = QString("%1/%2").arg(utils::formatSize(bytesReceived)).arg(utils::formatSize(bytesTotal));
-  } else {
-    item.progress = 0;
-    item.status = QString("%1").arg(utils::formatSize(bytesReceived));
+void DownloadProgressModel::flushProgress() {
+  int firstRow = -1;
+  int lastRow = -1;
+  for (auto it = m_pendingProgress.cbegin(); it != m_pendingProgress.cend(); ++it) {
+    int row = findRowById(it.key());
+    if (row < 0) continue;
+    DownloadProgressItem &item = itemAt(row);
+    if (item.isFinished() || item.isPaused()) continue;
+    item.bytesReceived = it->first;
+    item.bytesTotal = it->second;
+    item.state = DownloadProgressItem::State::Downloading;
+    firstRow = firstRow < 0 ? row : qMin(firstRow, row);
+    lastRow = qMax(lastRow, row);
   }
+  m_pendingProgress.clear();
 
-  emit dataChanged(index(row), index(row),
-                   {ProgressRole, StatusRole, BytesReceivedRole, BytesTotalRole, IsQueuedRole, IsConnectingRole});
+  // One notification for every download that moved; views repaint the span once
+  if (firstRow >= 0) {
+    emit dataChanged(index(firstRow), index(lastRow),
+                     {ProgressRole, StatusRole, BytesReceivedRole, BytesTotalRole, IsQueuedRole, IsConnectingRole});
+  }
 }
 
 void DownloadProgressModel::setFinished(int id, bool success) {
+  setState(id, success ? DownloadProgressItem::State::Done : DownloadProgressItem::State::Error);
+}
+
+void DownloadProgressModel::setPaused(int id, bool paused) {
   int row = findRowById(id);
-  if (row < 0) return;
+  if (row < 0 || itemAt(row).isFinished()) return;
+  // Progress is kept: the download continues from there when resumed
+  setState(id, paused ? DownloadProgressItem::State::Paused : DownloadProgressItem::State::Queued);
+}
 
-  DownloadProgressItem &item = m_downloads[row];
-  item.isFinished = true;
-  item.isQueued = false;
-  item.isConnecting = false;
+void DownloadProgressModel::setCanceled(int id) { setState(id, DownloadProgressItem::State::Canceled); }
 
-  if (!success) {
-    item.isError = true;
-    item.status = "Error";
-  } else {
-    item.progress = 100;
-    item.status = QString("%1 (Done)").arg(utils::formatSize(item.bytesReceived));
+void DownloadProgressModel::setRejected(int id) { setState(id, DownloadProgressItem::State::Rejected); }
+
+void DownloadProgressModel::setNotModified(int id) { setState(id, DownloadProgressItem::State::NotModified); }
+
+void DownloadProgressModel::clearFinished() {
+  if (hasSummary()) {
+    beginRemoveRows(QModelIndex(), itemCount(), itemCount());
+    m_summary = Summary();
+    endRemoveRows();
   }
+  removeFinished(m_finishedCount, nullptr);
+}
 
-  emit dataChanged(index(row), index(row),
-                   {ProgressRole, StatusRole, IsFinishedRole, IsErrorRole, IsQueuedRole, IsConnectingRole});
+void DownloadProgressModel::setFinishedLimit(int limit) {
+  m_finishedLimit = qMax(0, limit);
+  foldExcessFinished();
 }
 
-void DownloadProgressModel::clearFinished() {
-  for (int i = m_downloads.count() - 1; i >= 0; --i) {
-    if (m_downloads[i].isFinished) {
-      beginRemoveRows(QModelIndex(), i, i);
-      m_downloads.removeAt(i);
-      endRemoveRows();
-    }
+void DownloadProgressModel::foldExcessFinished() {
+  if (m_finishedLimit <= 0) return;
+  int slack = qMax(kMinFoldSlack, m_finishedLimit / 8);
+  if (m_finishedCount <= m_finishedLimit + slack) return;
+
+  Summary folded;
+  removeFinished(m_finishedCount - m_finishedLimit, &folded);
+  if (folded.count == 0) return;
+
+  if (hasSummary()) {
+    m_summary.count += folded.count;
+    m_summary.failed += folded.failed;
+    m_summary.bytesReceived += folded.bytesReceived;
+    QModelIndex summaryIndex = index(itemCount());
+    emit dataChanged(summaryIndex, summaryIndex);
+  } else {
+    beginInsertRows(QModelIndex(), itemCount(), itemCount());
+    m_summary = folded;
+    endInsertRows();
   }
 }
 
-int DownloadProgressModel::findRowById(int id) {
-  for (int i = 0; i < m_downloads.count(); ++i) {
-    if (m_downloads[i].id == id) return i;
+void DownloadProgressModel::removeFinished(int limit, Summary *folded) {
+  // Runs of finished downloads as [begin, end) positions in m_downloads, oldest first
+  QList<std::pair<int, int>> runs;
+  int selected = 0;
+  for (int i = 0; i < itemCount() && selected < limit; ++i) {
+    if (!m_downloads[i].isFinished()) continue;
+    if (!runs.isEmpty() && runs.last().second == i) {
+      ++runs.last().second;
+    } else {
+      runs.append({i, i + 1});
+    }
+    ++selected;
   }
-  return -1;
+  if (runs.isEmpty()) return;
+
+  // Newest run first, so the positions of the runs still to go stay put
+  for (int r = runs.count() - 1; r >= 0; --r) {
+    auto [begin, end] = runs[r];
+    int firstRow = itemCount() - end;
+    int lastRow = itemCount() - 1 - begin;
+    beginRemoveRows(QModelIndex(), firstRow, lastRow);
+    for (int i = begin; i < end; ++i) {
+      const DownloadProgressItem &item = m_downloads[i];
+      if (folded) {
+        ++folded->count;
+        if (item.isError()) ++folded->failed;
+        folded->bytesReceived += item.bytesReceived;
+      }
+      m_slotById.remove(item.id);
+    }
+    m_downloads.erase(m_downloads.begin() + begin, m_downloads.begin() + end);
+    endRemoveRows();
+  }
+  m_finishedCount -= selected;
+
+  // A run at the front just advances the first slot; later downloads shifted down and are
+  // renumbered from the first gap on
+  int shift = 0;
+  int renumberFrom = itemCount();
+  if (runs.first().first == 0) {
+    shift = runs.first().second;
+    m_firstSlot += shift;
+    if (runs.count() > 1) renumberFrom = runs[1].first - shift;
+  } else {
+    renumberFrom = runs.first().first;
+  }
+  for (int i = renumberFrom; i < itemCount(); ++i) {
+    m_slotById[m_downloads[i].id] = m_firstSlot + i;
+  }
+}
+
+int DownloadProgressModel::findRowById(int id) const {
+  auto it = m_slotById.constFind(id);
+  if (it == m_slotById.constEnd()) return -1;
+  return itemCount() - 1 - int(*it - m_firstSlot);
 }
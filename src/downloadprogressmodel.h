@@ -1,21 +1,32 @@
 #pragma once
 
 #include <QAbstractListModel>
+#include <QHash>
 #include <QList>
 #include <QObject>
 #include <QUrl>
+#include <deque>
+#include <utility>
+
+class QTimer;
 
 struct DownloadProgressItem {
+  enum class State { Queued, Connecting, Downloading, Paused, Done, Error, Canceled, Rejected, NotModified };
+
   int id = 0;
   QUrl url;
   qint64 bytesReceived = 0;
   qint64 bytesTotal = 0;
-  int progress = 0;
-  QString status;
-  bool isFinished = false;
-  bool isError = false;
-  bool isQueued = false;
-  bool isConnecting = false;
+  State state = State::Queued;
+
+  int progress() const;
+  // Formatted on demand, so progress ticks cost no string work
+  QString status() const;
+  bool isFinished() const;
+  bool isError() const { return state == State::Error || state == State::Rejected; }
+  bool isQueued() const { return state == State::Queued || state == State::Paused; }
+  bool isConnecting() const { return state == State::Connecting; }
+  bool isPaused() const { return state == State::Paused; }
 };
 
 class DownloadProgressModel : public QAbstractListModel {
@@ -32,7 +43,8 @@ class DownloadProgressModel : public QAbstractListModel {
     IsFinishedRole,
     IsErrorRole,
     IsQueuedRole,
-    IsConnectingRole
+    IsConnectingRole,
+    IsPausedRole
   };
 
   explicit DownloadProgressModel(QObject *parent = nullptr);
@@ -44,12 +56,48 @@ class DownloadProgressModel : public QAbstractListModel {
 
   int addQueuedDownload(const QUrl &url);
   void setConnecting(int id);
+  // Only recorded; all downloads' latest values are applied together once per frame
   void updateProgress(int id, qint64 bytesReceived, qint64 bytesTotal);
   void setFinished(int id, bool success);
+  void setPaused(int id, bool paused);
+  void setCanceled(int id);
+  void setRejected(int id);
+  // Finished without a transfer: the archived copy is still current
+  void setNotModified(int id);
   void clearFinished();
+  // Finished downloads beyond this many are folded, oldest first, into one summary row at
+  // the bottom; 0 keeps them all
+  void setFinishedLimit(int limit);
 
  private:
-  QList<DownloadProgressItem> m_downloads;
+  struct Summary {
+    int count = 0;
+    int failed = 0;
+    qint64 bytesReceived = 0;
+  };
+
+  int itemCount() const { return int(m_downloads.size()); }
+  bool hasSummary() const { return m_summary.count > 0; }
+  // Row 0 is the newest download
+  const DownloadProgressItem &itemAt(int row) const { return m_downloads[m_downloads.size() - 1 - row]; }
+  DownloadProgressItem &itemAt(int row) { return m_downloads[m_downloads.size() - 1 - row]; }
+  int findRowById(int id) const;
+  QVariant summaryData(int role) const;
+  void setState(int id, DownloadProgressItem::State state);
+  void flushProgress();
+  void foldExcessFinished();
+  // Drops up to `limit` finished downloads, oldest first, one removal per contiguous run
+  void removeFinished(int limit, Summary *folded);
+
+  // Oldest first, so adding a download appends; the view shows it as row 0
+  std::deque<DownloadProgressItem> m_downloads;
+  // Slots only count up: dropping downloads from the front leaves the others' slots valid
+  qint64 m_firstSlot = 0;
+  QHash<int, qint64> m_slotById;
+  int m_finishedCount = 0;
+  int m_finishedLimit = 0;
+  Summary m_summary;
   int m_nextId = 1;
-  int findRowById(int id);
+  QHash<int, std::pair<qint64, qint64>> m_pendingProgress;
+  QTimer *m_flushTimer;
 };
@@ -1,71 +1,194 @@
 #include "downloadqueue.h"
 
+#include <QThread>
+
+#include "downloadengine.h"
+
+const QString DownloadQueue::kCanceledError = "Canceled";
+const QString DownloadQueue::kRejectedError = "Rejected by content sniffing";
+
+bool DownloadHandle::isValid() const { return m_queue && m_queue->contains(m_id); }
+
+void DownloadHandle::cancel() const {
+  if (m_queue) m_queue->cancel(m_id);
+}
+
+void DownloadHandle::setPriority(int priority) const {
+  if (m_queue) m_queue->setPriority(m_id, priority);
+}
+
+void DownloadHandle::pause() const {
+  if (m_queue) m_queue->pause(m_id);
+}
+
+void DownloadHandle::resume() const {
+  if (m_queue) m_queue->resume(m_id);
+}
+
 DownloadQueue::DownloadQueue(int maxConcurrent, QObject *parent)
-    : QObject(parent), m_networkManager(new QNetworkAccessManager(this)), m_maxConcurrent(maxConcurrent) {}
+    : QObject(parent), m_thread(new QThread(this)), m_maxConcurrent(qMax(1, maxConcurrent)) {
+  m_thread->setObjectName("DownloadQueue");
+  // Created here, then moved along with its network manager and timers
+  m_engine = new DownloadEngine(this);
+  m_engine->setMaxConcurrent(m_maxConcurrent);
+  m_engine->moveToThread(m_thread);
+  m_thread->start();
+}
+
+DownloadQueue::~DownloadQueue() {
+  // Deleted on its own thread, where its replies live; that aborts them without posting back
+  QMetaObject::invokeMethod(m_engine, [engine = m_engine]() { delete engine; }, Qt::BlockingQueuedConnection);
+  m_thread->quit();
+  m_thread->wait();
+}
+
+void DownloadQueue::setMaxConcurrent(int maxConcurrent) {
+  m_maxConcurrent = qMax(1, maxConcurrent);
+  QMetaObject::invokeMethod(
+      m_engine, [engine = m_engine, maxConcurrent = m_maxConcurrent]() { engine->setMaxConcurrent(maxConcurrent); },
+      Qt::QueuedConnection);
+}
+
+void DownloadQueue::setMaxPerHost(int maxPerHost) {
+  m_maxPerHost = qMax(0, maxPerHost);
+  QMetaObject::invokeMethod(
+      m_engine, [engine = m_engine, maxPerHost = m_maxPerHost]() { engine->setMaxPerHost(maxPerHost); },
+      Qt::QueuedConnection);
+}
+
+void DownloadQueue::setRetryPolicy(const RetryPolicy &policy) {
+  m_retryPolicy = policy;
+  QMetaObject::invokeMethod(
+      m_engine, [engine = m_engine, policy]() { engine->setRetryPolicy(policy); }, Qt::QueuedConnection);
+}
 
-DownloadQueue::~DownloadQueue() {}
+void DownloadQueue::setContentSniffer(const ContentSniffer &sniffer) {
+  QMetaObject::invokeMethod(
+      m_engine, [engine = m_engine, sniffer]() { engine->setContentSniffer(sniffer); }, Qt::QueuedConnection);
+}
 
-void DownloadQueue::enqueue(const QUrl &url, StartedCallback startedCallback, ProgressCallback progressCallback,
-                            FinishedCallback finishedCallback) {
-  m_queue.enqueue({url, startedCallback, progressCallback, finishedCallback});
-  startNext();
+void DownloadQueue::setRateLimit(const RateLimit &limit) {
+  m_rateLimit = limit;
+  QMetaObject::invokeMethod(
+      m_engine, [engine = m_engine, limit]() { engine->setRateLimit(limit); }, Qt::QueuedConnection);
 }
 
-bool DownloadQueue::isEmpty() const { return m_queue.isEmpty() && m_activeDownloads.isEmpty(); }
+void DownloadQueue::setPauseOnForegroundTraffic(bool enabled) {
+  m_pauseOnForegroundTraffic = enabled;
+  QMetaObject::invokeMethod(
+      m_engine, [engine = m_engine, enabled]() { engine->setPauseOnForegroundTraffic(enabled); },
+      Qt::QueuedConnection);
+}
 
-int DownloadQueue::pendingCount() const { return m_queue.count(); }
+void DownloadQueue::setTrafficCounter(const TrafficCounter &counter) {
+  QMetaObject::invokeMethod(
+      m_engine, [engine = m_engine, counter]() { engine->setTrafficCounter(counter); }, Qt::QueuedConnection);
+}
 
-int DownloadQueue::activeCount() const { return m_activeDownloads.count(); }
+QList<DownloadJournal::Entry> DownloadQueue::openJournal(const QString &filePath) {
+  QList<DownloadJournal::Entry> entries;
+  QMetaObject::invokeMethod(
+      m_engine, [engine = m_engine, filePath, &entries]() { entries = engine->openJournal(filePath); },
+      Qt::BlockingQueuedConnection);
+  return entries;
+}
 
-bool DownloadQueue::isDownloading() const { return !m_activeDownloads.isEmpty(); }
+DownloadHandle DownloadQueue::enqueue(const QUrl &url, StartedCallback startedCallback,
+                                      ProgressCallback progressCallback, FinishedCallback finishedCallback,
+                                      int priority, const Validators &cached) {
+  int id = m_nextId++;
+  Caller caller;
+  caller.startedCallback = std::move(startedCallback);
+  caller.progressCallback = std::move(progressCallback);
+  caller.finishedCallback = std::move(finishedCallback);
+  m_callers.insert(id, std::move(caller));
+
+  QMetaObject::invokeMethod(
+      m_engine, [engine = m_engine, id, url, priority, cached]() { engine->enqueue(id, url, priority, cached); },
+      Qt::QueuedConnection);
+  return DownloadHandle(this, id);
+}
 
-void DownloadQueue::startNext() {
-  while (m_queue.count() > 0 && m_activeDownloads.count() < m_maxConcurrent) {
-    DownloadItem item = m_queue.dequeue();
+bool DownloadQueue::isEmpty() const { return m_callers.isEmpty(); }
 
-    QNetworkRequest request(item.url);
-    request.setHeader(QNetworkRequest::UserAgentHeader, "Mozilla/5.0 (compatible; ClipboardToolbox/1.0)");
-    request.setTransferTimeout(60000);
+int DownloadQueue::pendingCount() const { return m_pendingCount.loadRelaxed(); }
 
-    QNetworkReply *reply = m_networkManager->get(request);
+int DownloadQueue::activeCount() const { return m_activeCount.loadRelaxed(); }
 
-    if (item.startedCallback) {
-      item.startedCallback();
-    }
+bool DownloadQueue::isDownloading() const { return activeCount() > 0; }
 
-    connect(reply, &QNetworkReply::downloadProgress, this, [this, reply](qint64 bytesReceived, qint64 bytesTotal) {
-      if (!m_activeDownloads.contains(reply)) return;
-      DownloadItem &downloadItem = m_activeDownloads[reply];
-      if (downloadItem.progressCallback) {
-        downloadItem.progressCallback(bytesReceived, bytesTotal);
-      }
-    });
+void DownloadQueue::cancel(int id) {
+  auto it = m_callers.find(id);
+  if (it == m_callers.end()) return;
 
-    connect(reply, &QNetworkReply::finished, this, [this, reply]() {
-      if (!m_activeDownloads.contains(reply)) return;
+  Caller caller = std::move(it.value());
+  m_callers.erase(it);
+  QMetaObject::invokeMethod(m_engine, [engine = m_engine, id]() { engine->cancel(id); }, Qt::QueuedConnection);
 
-      DownloadItem item = m_activeDownloads.take(reply);
+  if (caller.finishedCallback) {
+    caller.finishedCallback(QByteArray(), false, kCanceledError, Response());
+  }
+}
 
-      QByteArray data;
-      bool success = false;
-      QString errorString;
+void DownloadQueue::setPriority(int id, int priority) {
+  if (!m_callers.contains(id)) return;
+  QMetaObject::invokeMethod(
+      m_engine, [engine = m_engine, id, priority]() { engine->setPriority(id, priority); }, Qt::QueuedConnection);
+}
 
-      if (reply->error() == QNetworkReply::NoError) {
-        data = reply->readAll();
-        success = true;
-      } else {
-        errorString = reply->errorString();
-      }
+void DownloadQueue::pause(int id) {
+  auto it = m_callers.find(id);
+  if (it == m_callers.end() || it->paused) return;
+  // Right away for this caller; the engine reports the others sharing the transfer
+  it->paused = true;
+  QMetaObject::invokeMethod(m_engine, [engine = m_engine, id]() { engine->pause(id); }, Qt::QueuedConnection);
+}
 
-      reply->deleteLater();
+void DownloadQueue::resume(int id) {
+  auto it = m_callers.find(id);
+  if (it == m_callers.end() || !it->paused) return;
+  it->paused = false;
+  QMetaObject::invokeMethod(m_engine, [engine = m_engine, id]() { engine->resume(id); }, Qt::QueuedConnection);
+}
 
-      if (item.finishedCallback) {
-        item.finishedCallback(data, success, errorString);
-      }
+void DownloadQueue::deliverStarted(const QList<int> &ids) {
+  for (int id : ids) {
+    // Looked up each time: a callback may cancel other downloads
+    auto it = m_callers.constFind(id);
+    if (it != m_callers.constEnd() && it->startedCallback) {
+      StartedCallback callback = it->startedCallback;
+      callback();
+    }
+  }
+}
+
+void DownloadQueue::deliverProgress(const QList<Progress> &batch) {
+  for (const Progress &progress : batch) {
+    auto it = m_callers.constFind(progress.id);
+    if (it != m_callers.constEnd() && !it->paused && it->progressCallback) {
+      ProgressCallback callback = it->progressCallback;
+      callback(progress.bytesReceived, progress.bytesTotal);
+    }
+  }
+}
 
-      startNext();
-    });
+void DownloadQueue::deliverFinished(const QList<int> &ids, QByteArray &&data, bool success,
+                                    const QString &errorString, const Response &response) {
+  QByteArray received = std::move(data);
+  for (int id : ids) {
+    auto it = m_callers.find(id);
+    if (it == m_callers.end()) continue;
+    Caller caller = std::move(it.value());
+    m_callers.erase(it);
+    if (caller.finishedCallback) {
+      caller.finishedCallback(received, success, errorString, response);
+    }
+  }
+}
 
-    m_activeDownloads.insert(reply, item);
+void DownloadQueue::deliverPaused(const QList<int> &ids, bool paused) {
+  for (int id : ids) {
+    auto it = m_callers.find(id);
+    if (it != m_callers.end()) it->paused = paused;
   }
 }
@@ -1,44 +1,191 @@
 #pragma once
 
+#include <QAtomicInt>
 #include <QByteArray>
-#include <QMap>
-#include <QNetworkAccessManager>
-#include <QNetworkReply>
+#include <QHash>
+#include <QList>
 #include <QObject>
-#include <QQueue>
+#include <QPointer>
 #include <QUrl>
 #include <functional>
 
+#include "downloadjournal.h"
+
+class DownloadEngine;
+class DownloadQueue;
+class QThread;
+
+// Refers to one enqueue() call. Calls become no-ops once the download has finished or
+// the queue is gone, so handles may be kept around freely.
+class DownloadHandle {
+ public:
+  DownloadHandle() = default;
+
+  int id() const { return m_id; }
+  bool isValid() const;
+
+  void cancel() const;
+  void setPriority(int priority) const;
+  void pause() const;
+  void resume() const;
+
+ private:
+  friend class DownloadQueue;
+  DownloadHandle(DownloadQueue *queue, int id) : m_queue(queue), m_id(id) {}
+
+  QPointer<DownloadQueue> m_queue;
+  int m_id = 0;
+};
+
+// Downloads run on a thread of their own, next to their network manager, so a busy GUI
+// thread does not throttle them. The API and every callback stay on the thread that
+// created the queue; progress arrives there in batches.
 class DownloadQueue : public QObject {
   Q_OBJECT
 
  public:
+  // What a server said identifies its copy of a URL
+  struct Validators {
+    QByteArray etag;
+    QByteArray lastModified;
+
+    bool isEmpty() const { return etag.isEmpty() && lastModified.isEmpty(); }
+    bool operator==(const Validators &other) const {
+      return etag == other.etag && lastModified == other.lastModified;
+    }
+  };
+  struct Response {
+    // The cached copy passed to enqueue() is still current; data is empty
+    bool notModified = false;
+    Validators validators;
+  };
+
   using StartedCallback = std::function<void()>;
   using ProgressCallback = std::function<void(qint64 bytesReceived, qint64 bytesTotal)>;
-  using FinishedCallback = std::function<void(const QByteArray &data, bool success, const QString &errorString)>;
+  using FinishedCallback = std::function<void(const QByteArray &data, bool success, const QString &errorString,
+                                              const Response &response)>;
+
+  // Higher runs first; equal priorities run in enqueue order
+  enum Priority { Low = -10, Normal = 0, High = 10 };
+
+  // errorString passed to the finished callback of a canceled download
+  static const QString kCanceledError;
+  // errorString passed when the content sniffer turned the response down
+  static const QString kRejectedError;
+
+  // Looks at a successful response before its body is transferred: first with the
+  // Content-Type alone when the headers arrive, then with the first bytes of the body
+  // until it returns something other than NeedMoreData. Rejected downloads are aborted.
+  // Called on the download thread.
+  enum class Verdict { Accept, Reject, NeedMoreData };
+  using ContentSniffer = std::function<Verdict(const QByteArray &contentType, const QByteArray &head)>;
+
+  // Timeouts, dropped connections, 408/429 and 5xx responses are retried after
+  // min(maxDelayMs, baseDelayMs * 2^n) with full jitter. Data already received is kept and
+  // the retry asks for the rest with a Range request when the server supports it; an
+  // attempt that got further than any before it resets n and the attempt count.
+  struct RetryPolicy {
+    int maxAttempts = 5;  // including the first
+    int baseDelayMs = 1000;
+    int maxDelayMs = 30000;
+  };
+
+  // Token buckets in bytes per second, 0 for no limit: one shared by all downloads and
+  // one for each of them. Bodies are read from their replies at that pace through a small
+  // read buffer, so the server is held back by TCP instead of piling data up in memory.
+  struct RateLimit {
+    qint64 totalBytesPerSecond = 0;
+    qint64 perDownloadBytesPerSecond = 0;
+  };
 
   explicit DownloadQueue(int maxConcurrent = 1, QObject *parent = nullptr);
   ~DownloadQueue();
 
-  void enqueue(const QUrl &url, StartedCallback startedCallback, ProgressCallback progressCallback,
-               FinishedCallback finishedCallback);
+  int maxConcurrent() const { return m_maxConcurrent; }
+  void setMaxConcurrent(int maxConcurrent);
+  // Active downloads per scheme/host/port; 0 means only the global limit applies.
+  // Keeps one slow server from taking every slot while others sit idle.
+  int maxPerHost() const { return m_maxPerHost; }
+  void setMaxPerHost(int maxPerHost);
+  RetryPolicy retryPolicy() const { return m_retryPolicy; }
+  void setRetryPolicy(const RetryPolicy &policy);
+  void setContentSniffer(const ContentSniffer &sniffer);
+  RateLimit rateLimit() const { return m_rateLimit; }
+  void setRateLimit(const RateLimit &limit);
+  // Stops reading and starting downloads while the network interfaces carry traffic that is
+  // not ours, such as a video call, until it has been quiet for a few seconds. Needs the OS
+  // interface counters, which are only read on Linux and macOS (see netstats::isAvailable()).
+  bool pausesOnForegroundTraffic() const { return m_pauseOnForegroundTraffic; }
+  void setPauseOnForegroundTraffic(bool enabled);
+  // Bytes received by the whole machine so far, or -1 if unknown; netstats::receivedBytes()
+  // unless replaced, e.g. to simulate other traffic. Called on the download thread.
+  using TrafficCounter = std::function<qint64()>;
+  void setTrafficCounter(const TrafficCounter &counter);
+  // Keeps a journal of unfinished downloads, and what was received of them, at filePath and
+  // returns the ones the last run left behind. Enqueueing one of those URLs again continues
+  // it with a Range request. Blocks until the journal is read.
+  QList<DownloadJournal::Entry> openJournal(const QString &filePath = DownloadJournal::defaultFilePath());
+
+  // With `cached` set the request is conditional, and a server that still has that copy
+  // answers with Response::notModified instead of the body. A URL that is already queued
+  // or downloading with the same validators is not fetched twice: the new callbacks join
+  // that transfer.
+  DownloadHandle enqueue(const QUrl &url, StartedCallback startedCallback, ProgressCallback progressCallback,
+                         FinishedCallback finishedCallback, int priority = Normal,
+                         const Validators &cached = Validators());
   bool isEmpty() const;
   int pendingCount() const;
   int activeCount() const;
   bool isDownloading() const;
 
+  bool contains(int id) const { return m_callers.contains(id); }
+  bool isPaused(int id) const { return m_callers.value(id).paused; }
+  // Reports kCanceledError to this caller at once. The last caller of a transfer also
+  // aborts its reply, which frees what was received.
+  void cancel(int id);
+  // A shared transfer runs at the highest priority among its callers
+  void setPriority(int id, int priority);
+  // Applies to the whole transfer. A paused download keeps its place but is not started;
+  // an active one is aborted and continues from where it stopped on resume() if the
+  // server supports ranges.
+  void pause(int id);
+  void resume(int id);
+
+ signals:
+  void foregroundTrafficChanged(bool detected);
+
  private:
-  struct DownloadItem {
-    QUrl url;
+  friend class DownloadEngine;
+
+  struct Caller {
     StartedCallback startedCallback;
     ProgressCallback progressCallback;
     FinishedCallback finishedCallback;
+    bool paused = false;
+  };
+  struct Progress {
+    int id = 0;
+    qint64 bytesReceived = 0;
+    qint64 bytesTotal = 0;
   };
 
-  void startNext();
+  // Posted by the engine
+  void deliverStarted(const QList<int> &ids);
+  void deliverProgress(const QList<Progress> &batch);
+  void deliverFinished(const QList<int> &ids, QByteArray &&data, bool success, const QString &errorString,
+                       const Response &response);
+  void deliverPaused(const QList<int> &ids, bool paused);
 
-  QNetworkAccessManager *m_networkManager;
-  QQueue<DownloadItem> m_queue;
-  QMap<QNetworkReply *, DownloadItem> m_activeDownloads;
+  QThread *m_thread;
+  DownloadEngine *m_engine;
+  QHash<int, Caller> m_callers;  // by handle id, until finished
   int m_maxConcurrent;
+  int m_maxPerHost = 0;
+  RetryPolicy m_retryPolicy;
+  RateLimit m_rateLimit;
+  bool m_pauseOnForegroundTraffic = false;
+  int m_nextId = 1;
+  // Kept up to date by the engine
+  QAtomicInt m_pendingCount;
+  QAtomicInt m_activeCount;
 };
@@ -0,0 +1,139 @@
+#include "gallerymodel.h"
+
+#include <QDateTime>
+#include <QDir>
+#include <QFileInfo>
+#include <algorithm>
+
+#include "thumbnailcache.h"
+#include "utils.h"
+
+GalleryModel::GalleryModel(ThumbnailCache *thumbnails, QObject *parent)
+    : QAbstractListModel(parent), m_thumbnails(thumbnails) {
+  // Thumbnails arrive one by one; repaint once per frame instead of once per image
+  m_repaintTimer.setSingleShot(true);
+  m_repaintTimer.setInterval(30);
+  connect(m_thumbnails, &ThumbnailCache::thumbnailReady, this, [this](const QByteArray &checksum) {
+    m_readyChecksums.insert(checksum);
+    if (!m_repaintTimer.isActive()) m_repaintTimer.start();
+  });
+  connect(&m_repaintTimer, &QTimer::timeout, this, &GalleryModel::onThumbnailReady);
+}
+
+int GalleryModel::rowCount(const QModelIndex &parent) const {
+  if (parent.isValid()) return 0;
+  return m_entries.count();
+}
+
+QVariant GalleryModel::data(const QModelIndex &index, int role) const {
+  if (!index.isValid() || index.row() < 0 || index.row() >= m_entries.count()) return QVariant();
+
+  const ChecksumIndex::Entry &entry = m_entries[index.row()];
+
+  switch (role) {
+    case Qt::DisplayRole:
+      return QFileInfo(entry.path).fileName();
+    case Qt::DecorationRole:
+      // Only rows the view actually paints get here, which is what makes loading lazy
+      return m_thumbnails->thumbnail(entry.checksum, QDir(m_dir).filePath(entry.path));
+    case Qt::ToolTipRole:
+      return QString("%1\n%2\n%3")
+          .arg(entry.path, entry.size >= 0 ? utils::formatSize(entry.size) : QString(),
+               entry.savedAt > 0 ? QDateTime::fromSecsSinceEpoch(entry.savedAt).toString("yyyy-MM-dd HH:mm:ss")
+                                 : QString());
+    case PathRole:
+      return entry.path;
+    case FilePathRole:
+      return QDir(m_dir).filePath(entry.path);
+    case ChecksumRole:
+      return entry.checksum;
+    case SizeRole:
+      return entry.size;
+    case SavedAtRole:
+      return entry.savedAt;
+  }
+
+  return QVariant();
+}
+
+QHash<int, QByteArray> GalleryModel::roleNames() const {
+  QHash<int, QByteArray> roles;
+  roles[Qt::DisplayRole] = "display";
+  roles[Qt::DecorationRole] = "decoration";
+  roles[PathRole] = "path";
+  roles[FilePathRole] = "filePath";
+  roles[ChecksumRole] = "checksum";
+  roles[SizeRole] = "size";
+  roles[SavedAtRole] = "savedAt";
+  return roles;
+}
+
+void GalleryModel::setEntries(const QString &dir, QList<ChecksumIndex::Entry> entries) {
+  std::stable_sort(entries.begin(), entries.end(), [](const ChecksumIndex::Entry &a, const ChecksumIndex::Entry &b) {
+    return a.savedAt != b.savedAt ? a.savedAt > b.savedAt : a.path > b.path;
+  });
+  m_thumbnails->clearQueue();
+  beginResetModel();
+  m_dir = dir;
+  m_entries = std::move(entries);
+  m_positionsStale = true;
+  endResetModel();
+}
+
+void GalleryModel::addEntries(const QList<ChecksumIndex::Entry> &entries) {
+  if (entries.isEmpty()) return;
+  // New saves are the newest files, so they go on top
+  beginInsertRows(QModelIndex(), 0, entries.size() - 1);
+  QList<ChecksumIndex::Entry> merged;
+  merged.reserve(entries.size() + m_entries.size());
+  for (auto it = entries.crbegin(); it != entries.crend(); ++it) merged.append(*it);
+  merged.append(m_entries);
+  m_entries = std::move(merged);
+  if (!m_positionsStale) {
+    for (int row = 0; row < entries.size(); ++row) {
+      m_positions[m_entries[row].checksum].append(m_entries.size() - 1 - row);
+    }
+  }
+  endInsertRows();
+}
+
+void GalleryModel::removePaths(const QStringList &paths) {
+  if (paths.isEmpty()) return;
+  QSet<QString> removed(paths.cbegin(), paths.cend());
+  // Walk backwards so contiguous runs become a single removal
+  for (int row = m_entries.size() - 1; row >= 0;) {
+    if (!removed.contains(m_entries[row].path)) {
+      --row;
+      continue;
+    }
+    int last = row;
+    while (row > 0 && removed.contains(m_entries[row - 1].path)) --row;
+    beginRemoveRows(QModelIndex(), row, last);
+    m_entries.remove(row, last - row + 1);
+    m_positionsStale = true;
+    endRemoveRows();
+    --row;
+  }
+}
+
+void GalleryModel::rebuildPositions() {
+  m_positions.clear();
+  for (int row = 0; row < m_entries.size(); ++row) {
+    m_positions[m_entries[row].checksum].append(m_entries.size() - 1 - row);
+  }
+  m_positionsStale = false;
+}
+
+void GalleryModel::onThumbnailReady() {
+  QSet<QByteArray> ready = std::move(m_readyChecksums);
+  m_readyChecksums.clear();
+  if (m_entries.isEmpty()) return;
+  if (m_positionsStale) rebuildPositions();
+  // Only the rows whose thumbnail arrived; a change over all rows relayouts the whole view
+  for (const QByteArray &checksum : std::as_const(ready)) {
+    for (int position : m_positions.value(checksum)) {
+      QModelIndex changed = index(m_entries.size() - 1 - position);
+      emit dataChanged(changed, changed, {Qt::DecorationRole});
+    }
+  }
+}
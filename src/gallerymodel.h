@@ -0,0 +1,43 @@
+#pragma once
+
+#include <QAbstractListModel>
+#include <QHash>
+#include <QList>
+#include <QSet>
+#include <QTimer>
+
+#include "checksumindex.h"
+
+class ThumbnailCache;
+
+// Files of the auto-save directory, newest first, with lazily loaded thumbnails.
+class GalleryModel : public QAbstractListModel {
+  Q_OBJECT
+
+ public:
+  enum Roles { PathRole = Qt::UserRole + 1, FilePathRole, ChecksumRole, SizeRole, SavedAtRole };
+
+  explicit GalleryModel(ThumbnailCache *thumbnails, QObject *parent = nullptr);
+
+  int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+  QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+  QHash<int, QByteArray> roleNames() const override;
+
+  void setEntries(const QString &dir, QList<ChecksumIndex::Entry> entries);
+  void addEntries(const QList<ChecksumIndex::Entry> &entries);
+  void removePaths(const QStringList &paths);
+
+ private:
+  void onThumbnailReady();
+  void rebuildPositions();
+
+  ThumbnailCache *m_thumbnails = nullptr;
+  QString m_dir;
+  QList<ChecksumIndex::Entry> m_entries;
+  // Checksum -> rows counted from the bottom, which stay put while new files go on top;
+  // rebuilt lazily after removals
+  QHash<QByteArray, QList<int>> m_positions;
+  bool m_positionsStale = true;
+  QSet<QByteArray> m_readyChecksums;
+  QTimer m_repaintTimer;
+};
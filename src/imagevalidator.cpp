@@ -0,0 +1,112 @@
+#include "imagevalidator.h"
+
+#include <QBuffer>
+#include <QFile>
+#include <QImage>
+#include <QImageReader>
+
+namespace imagevalidator {
+
+namespace {
+constexpr int kSniffLength = 32;
+}
+
+QByteArray sniffFormat(const QByteArray &head) {
+  if (head.startsWith("\x89PNG\r\n\x1a\n")) return "png";
+  if (head.startsWith("\xff\xd8\xff")) return "jpeg";
+  if (head.startsWith("GIF87a") || head.startsWith("GIF89a")) return "gif";
+  if (head.startsWith("BM")) return "bmp";
+  if (head.startsWith("RIFF") && head.mid(8, 4) == "WEBP") return "webp";
+  if (head.startsWith(QByteArray("II*\0", 4)) || head.startsWith(QByteArray("MM\0*", 4))) return "tiff";
+  if (head.startsWith(QByteArray("\0\0\1\0", 4))) return "ico";
+  if (head.mid(4, 4) == "ftyp") {
+    QByteArray brand = head.mid(8, 4);
+    if (brand == "avif" || brand == "avis") return "avif";
+    if (brand == "heic" || brand == "heix" || brand == "mif1") return "heic";
+  }
+  return QByteArray();
+}
+
+std::optional<bool> isImageContentType(const QByteArray &contentType) {
+  QByteArray mime = contentType.split(';').first().trimmed().toLower();
+  if (mime.isEmpty()) return std::nullopt;
+  if (mime.startsWith("image/")) return true;
+  // Generic types some servers send for everything
+  if (mime == "application/octet-stream" || mime == "binary/octet-stream" || mime == "application/binary" ||
+      mime == "application/force-download" || mime == "application/x-download") {
+    return std::nullopt;
+  }
+  return false;
+}
+
+std::optional<bool> looksLikeImage(const QByteArray &head) {
+  if (!sniffFormat(head).isEmpty()) return true;
+  if (head.size() < kSniffLength) return std::nullopt;
+  if (head.left(512).toLower().contains("<svg")) return true;
+
+  // Let the installed plugins have a look at the formats sniffFormat() does not know
+  QBuffer buffer;
+  buffer.setData(head);
+  buffer.open(QIODevice::ReadOnly);
+  return !QImageReader::imageFormat(&buffer).isEmpty();
+}
+
+ImageHeaderInfo validate(QIODevice *device, bool paranoid) {
+  ImageHeaderInfo info;
+  if (!device || !device->isOpen() || !device->isReadable()) {
+    info.error = "Device is not readable";
+    return info;
+  }
+
+  QImageReader reader(device);
+  // Known magic bytes let the reader skip probing every installed plugin, as long as
+  // a plugin for that format is actually available.
+  QByteArray sniffed = sniffFormat(device->peek(kSniffLength));
+  if (!sniffed.isEmpty() && QImageReader::supportedImageFormats().contains(sniffed)) {
+    reader.setFormat(sniffed);
+  }
+
+  if (!reader.canRead()) {
+    info.error = "Unrecognized image format";
+    return info;
+  }
+  info.format = reader.format();
+
+  // size() only parses the header for every format that supports it
+  info.size = reader.size();
+  if (info.size.isValid() && info.size.isEmpty()) {
+    info.error = QString("Invalid dimensions %1x%2").arg(info.size.width()).arg(info.size.height());
+    return info;
+  }
+
+  if (paranoid) {
+    QImage image = reader.read();
+    if (image.isNull()) {
+      info.error = reader.errorString();
+      return info;
+    }
+    info.size = image.size();
+  }
+
+  info.valid = true;
+  return info;
+}
+
+ImageHeaderInfo validateFile(const QString &path, bool paranoid) {
+  QFile file(path);
+  if (!file.open(QIODevice::ReadOnly)) {
+    ImageHeaderInfo info;
+    info.error = file.errorString();
+    return info;
+  }
+  return validate(&file, paranoid);
+}
+
+ImageHeaderInfo validateData(const QByteArray &data, bool paranoid) {
+  QBuffer buffer;
+  buffer.setData(data);
+  buffer.open(QIODevice::ReadOnly);
+  return validate(&buffer, paranoid);
+}
+
+}  // namespace imagevalidator
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <QByteArray>
+#include <QSize>
+#include <QString>
+#include <optional>
+
+class QIODevice;
+
+struct ImageHeaderInfo {
+  bool valid = false;
+  QByteArray format;
+  QSize size;
+  QString error;
+};
+
+// Cheap image validation: magic bytes plus the header as parsed by QImageReader.
+// Pixels are only decoded in paranoid mode.
+namespace imagevalidator {
+
+// Returns the Qt format name for well-known magic bytes, or an empty array.
+QByteArray sniffFormat(const QByteArray &head);
+
+// Whether an HTTP Content-Type rules an image in or out; nullopt when it says nothing
+// either way (missing, application/octet-stream and the like).
+std::optional<bool> isImageContentType(const QByteArray &contentType);
+// Whether the first bytes of a body look like an image; nullopt until there are enough
+// of them to tell.
+std::optional<bool> looksLikeImage(const QByteArray &head);
+
+ImageHeaderInfo validate(QIODevice *device, bool paranoid = false);
+ImageHeaderInfo validateFile(const QString &path, bool paranoid = false);
+ImageHeaderInfo validateData(const QByteArray &data, bool paranoid = false);
+
+}  // namespace imagevalidator
@@ -0,0 +1,248 @@
+#include "ingestpipeline.h"
+
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QThread>
+#include <QThreadPool>
+#include <QtConcurrent>
+#include <memory>
+
+#include "imagevalidator.h"
+
+IngestPipeline::IngestPipeline(const QString &targetDir, QObject *parent)
+    : QObject(parent), m_targetDir(targetDir), m_pool(new QThreadPool(this)) {
+  connect(&m_hashWatcher, &QFutureWatcher<IngestItem>::resultsReadyAt, this, &IngestPipeline::onHashesReady);
+  connect(&m_hashWatcher, &QFutureWatcher<IngestItem>::finished, this, &IngestPipeline::onHashed);
+}
+
+IngestPipeline::~IngestPipeline() {
+  cancel();
+  m_hashWatcher.waitForFinished();
+  // Queued copies still read m_canceled and bump the counters
+  m_pool->waitForDone();
+}
+
+QByteArray IngestPipeline::fileChecksum(const QString &path) {
+  QFile file(path);
+  if (!file.open(QIODevice::ReadOnly)) return QByteArray();
+  QCryptographicHash hash(QCryptographicHash::Md5);
+  if (hash.addData(&file)) {
+    return hash.result();
+  }
+  return QByteArray();
+}
+
+IngestItem IngestPipeline::hashItem(const QString &path) {
+  IngestItem item;
+  item.sourcePath = path;
+  QFileInfo fi(path);
+  item.size = fi.size();
+  if (!fi.isFile()) {
+    item.status = IngestItem::Invalid;
+    item.error = "Not a file";
+  } else if (ImageHeaderInfo header = imagevalidator::validateFile(path, m_paranoid); !header.valid) {
+    item.status = IngestItem::Invalid;
+    item.error = header.error;
+  } else if (m_maxFileSize > 0 && item.size > m_maxFileSize) {
+    item.status = IngestItem::TooLarge;
+  } else {
+    item.imageSize = header.size;
+    item.format = header.format;
+    item.checksum = fileChecksum(path);
+    if (item.checksum.isEmpty()) {
+      item.status = IngestItem::Failed;
+      item.error = "Failed to calculate checksum";
+    } else {
+      m_bytesHashed += item.size;
+    }
+  }
+  m_hashed++;
+  return item;
+}
+
+void IngestPipeline::start(const QStringList &paths) {
+  if (isRunning()) return;
+
+  resetStats();
+  m_found = paths.size();
+  hashInOrder([paths, i = 0](QString *path) mutable {
+    if (i >= paths.size()) return false;
+    *path = paths.at(i++);
+    return true;
+  });
+}
+
+void IngestPipeline::startTree(const QString &root) {
+  if (isRunning()) return;
+
+  resetStats();
+  QString skipPrefix = QDir::cleanPath(m_targetDir) + "/";
+  // Created by the first call, so the listing starts on the pool rather than here
+  std::shared_ptr<QDirIterator> it;
+  hashInOrder([this, root, skipPrefix, it](QString *path) mutable {
+    if (!it) {
+      it = std::make_shared<QDirIterator>(root, QDir::Files | QDir::NoDotAndDotDot, QDirIterator::Subdirectories);
+    }
+    while (it->hasNext()) {
+      *path = it->next();
+      if (path->startsWith(skipPrefix)) continue;
+      m_found++;
+      return true;
+    }
+    return false;
+  });
+}
+
+void IngestPipeline::hashInOrder(std::function<bool(QString *path)> next) {
+  // The feeder mostly waits on the hashers, so it gets a thread of its own
+  m_poolThreads = m_pool->maxThreadCount();
+  m_pool->setMaxThreadCount(m_poolThreads + 1);
+  m_hashing = true;
+  m_hashWatcher.setFuture(QtConcurrent::run(m_pool, [this, next](QPromise<IngestItem> &promise) {
+    // Enough queued work to keep every core busy without listing a tree into memory up front
+    const int maxInFlight = 4 * QThread::idealThreadCount();
+    QList<QFuture<IngestItem>> inFlight;
+    QString path;
+    while (!promise.isCanceled() && next(&path)) {
+      inFlight.append(QtConcurrent::run(m_pool, [this, path]() { return hashItem(path); }));
+      // Results are added in order so the first copy of a duplicate wins; finished ones go
+      // out right away so their copies can start
+      while (!inFlight.isEmpty() && (inFlight.size() >= maxInFlight || inFlight.first().isFinished())) {
+        promise.addResult(inFlight.takeFirst().result());
+      }
+    }
+    for (QFuture<IngestItem> &future : inFlight) {
+      if (!promise.isCanceled()) promise.addResult(future.result());
+      future.waitForFinished();
+    }
+  }));
+}
+
+void IngestPipeline::resetStats() {
+  m_startTime = QDateTime::currentMSecsSinceEpoch();
+  m_items.clear();
+  m_canceled = false;
+  m_found = 0;
+  m_hashed = 0;
+  m_bytesHashed = 0;
+  m_copied = 0;
+  m_bytesCopied = 0;
+}
+
+IngestStats IngestPipeline::stats() const {
+  IngestStats stats;
+  stats.found = m_found;
+  stats.hashed = m_hashed;
+  stats.bytesHashed = m_bytesHashed;
+  stats.copied = m_copied;
+  stats.bytesCopied = m_bytesCopied;
+  return stats;
+}
+
+void IngestPipeline::cancel() {
+  m_canceled = true;
+  m_hashWatcher.cancel();
+}
+
+bool IngestPipeline::isRunning() const { return m_hashing || m_copying > 0; }
+
+void IngestPipeline::onHashesReady() {
+  QFuture<IngestItem> future = m_hashWatcher.future();
+  int taken = m_items.size();
+  // Dedup runs in list order so the first occurrence within the batch wins; a canceled
+  // batch claims nothing
+  while (!m_canceled && m_items.size() < future.resultCount()) {
+    m_items.append(future.resultAt(m_items.size()));
+    IngestItem &item = m_items.last();
+    if (item.status != IngestItem::Pending) continue;
+    if (m_claim && !m_claim(item.checksum)) {
+      item.status = IngestItem::Duplicate;
+      continue;
+    }
+    item.fileName = m_name ? m_name(item) : QFileInfo(item.sourcePath).fileName();
+    copyItem(m_items.size() - 1);
+  }
+  if (m_items.size() > taken) emit progress(m_items.size(), m_found);
+}
+
+void IngestPipeline::onHashed() {
+  if (m_poolThreads > 0) {
+    m_pool->setMaxThreadCount(m_poolThreads);
+    m_poolThreads = 0;
+  }
+  onHashesReady();
+  m_hashing = false;
+  if (m_copying == 0) finish();
+}
+
+void IngestPipeline::copyItem(int index) {
+  QString destination = QDir(m_targetDir).filePath(m_items.at(index).fileName);
+  CopyFunc copy = m_copy;
+  auto watcher = new QFutureWatcher<IngestItem>(this);
+  connect(watcher, &QFutureWatcher<IngestItem>::finished, this, [this, watcher, index]() {
+    m_items[index] = watcher->result();
+    watcher->deleteLater();
+    m_copying--;
+    if (!m_hashing && m_copying == 0) finish();
+  });
+  m_copying++;
+  auto job = [this, item = m_items.at(index), destination, copy]() mutable {
+    // Left pending; finish() reports it as canceled
+    if (m_canceled) return item;
+    QDir().mkpath(QFileInfo(destination).absolutePath());
+    bool ok = copy ? copy(item, destination, &item.error) : QFile::copy(item.sourcePath, destination);
+    if (ok) {
+      item.status = IngestItem::Copied;
+      m_copied++;
+      m_bytesCopied += item.size;
+    } else {
+      item.status = IngestItem::Failed;
+      if (item.error.isEmpty()) item.error = "Failed to copy to " + destination;
+    }
+    return item;
+  };
+  // Ahead of the queued hashes, so copies keep pace with hashing instead of waiting for its end
+  watcher->setFuture(QtConcurrent::task(std::move(job)).onThreadPool(*m_pool).withPriority(1).spawn());
+}
+
+void IngestPipeline::finish() {
+  IngestSummary summary;
+  for (IngestItem &item : m_items) {
+    // Claimed but never copied (batch canceled)
+    if (item.status == IngestItem::Pending && !item.fileName.isEmpty()) {
+      item.status = IngestItem::Failed;
+      item.error = "Canceled";
+    }
+    // Hashed, but the batch was canceled before dedup: neither saved nor failed
+    if (item.status == IngestItem::Pending) continue;
+    switch (item.status) {
+      case IngestItem::Copied:
+        summary.copied++;
+        summary.bytesCopied += item.size;
+        break;
+      case IngestItem::Duplicate:
+        summary.duplicates++;
+        break;
+      case IngestItem::Invalid:
+        summary.invalid++;
+        break;
+      case IngestItem::TooLarge:
+        summary.tooLarge++;
+        break;
+      default:
+        summary.failed++;
+        break;
+    }
+  }
+  summary.items = m_items;
+  summary.canceled = m_canceled;
+  summary.elapsedMs = QDateTime::currentMSecsSinceEpoch() - m_startTime;
+  qDebug() << "Ingest finished:" << summary.copied << "copied," << summary.duplicates << "duplicates in"
+           << summary.elapsedMs << "ms";
+  emit finished(summary);
+}
@@ -0,0 +1,120 @@
+#pragma once
+
+#include <QByteArray>
+#include <QFutureWatcher>
+#include <QList>
+#include <QObject>
+#include <QSize>
+#include <QString>
+#include <QStringList>
+#include <atomic>
+#include <functional>
+
+class QThreadPool;
+
+struct IngestItem {
+  enum Status { Pending, Invalid, TooLarge, Duplicate, Copied, Failed };
+
+  QString sourcePath;
+  qint64 size = 0;
+  QSize imageSize;  // from the validated header
+  QByteArray format;
+  QByteArray checksum;
+  QString fileName;  // relative to the target directory
+  QString error;
+  Status status = Pending;
+};
+
+struct IngestSummary {
+  QList<IngestItem> items;
+  int copied = 0;
+  int duplicates = 0;
+  int invalid = 0;
+  int tooLarge = 0;
+  int failed = 0;
+  qint64 bytesCopied = 0;
+  qint64 elapsedMs = 0;
+  bool canceled = false;
+};
+
+// Counters readable while a batch runs, for throughput display.
+struct IngestStats {
+  int found = 0;
+  int hashed = 0;
+  qint64 bytesHashed = 0;
+  int copied = 0;
+  qint64 bytesCopied = 0;
+};
+
+// Saves a batch of local image files into the target directory.
+// Validation and hashing, then copying, run on a dedicated thread pool; the
+// dedup decision and naming run on the owner's thread between the two stages.
+// Each file is claimed and copied as soon as its hash is in, while later ones
+// are still being hashed.
+class IngestPipeline : public QObject {
+  Q_OBJECT
+
+ public:
+  // Returns true if the checksum was new and is now reserved for this batch.
+  using ClaimFunc = std::function<bool(const QByteArray &checksum)>;
+  // Returns the destination file name (relative to the target directory).
+  using NameFunc = std::function<QString(const IngestItem &item)>;
+  // Materializes `destination` from the item; runs on a pool thread. Defaults to QFile::copy.
+  using CopyFunc = std::function<bool(const IngestItem &item, const QString &destination, QString *error)>;
+
+  explicit IngestPipeline(const QString &targetDir, QObject *parent = nullptr);
+  ~IngestPipeline();
+
+  void setMaxFileSize(qint64 bytes) { m_maxFileSize = bytes; }
+  void setParanoid(bool paranoid) { m_paranoid = paranoid; }
+  void setClaimFunc(ClaimFunc func) { m_claim = std::move(func); }
+  void setNameFunc(NameFunc func) { m_name = std::move(func); }
+  void setCopyFunc(CopyFunc func) { m_copy = std::move(func); }
+
+  void start(const QStringList &paths);
+  // Walks `root` recursively and hashes files while the walk is still going, so a large
+  // tree never waits for its full listing. The target directory is skipped if inside.
+  void startTree(const QString &root);
+  void cancel();
+  bool isRunning() const;
+  IngestStats stats() const;
+
+  static QByteArray fileChecksum(const QString &path);
+
+ signals:
+  void progress(int done, int total);
+  void finished(const IngestSummary &summary);
+
+ private:
+  void resetStats();
+  // Hashes the paths `next` hands out on the pool, adding the results in that order
+  void hashInOrder(std::function<bool(QString *path)> next);
+  IngestItem hashItem(const QString &path);
+  void onHashesReady();
+  void onHashed();
+  void copyItem(int index);
+  void finish();
+
+  QString m_targetDir;
+  qint64 m_maxFileSize = 0;
+  bool m_paranoid = false;
+  ClaimFunc m_claim;
+  NameFunc m_name;
+  CopyFunc m_copy;
+
+  QThreadPool *m_pool = nullptr;
+  int m_poolThreads = 0;  // maxThreadCount to go back to once hashing is done
+  QList<IngestItem> m_items;  // hash results taken so far, in order
+  QFutureWatcher<IngestItem> m_hashWatcher;
+  bool m_hashing = false;
+  int m_copying = 0;  // copies on the pool
+  qint64 m_startTime = 0;
+  std::atomic<bool> m_canceled{false};  // read by queued copies
+
+  // Written from pool threads
+  std::atomic<int> m_found{0};
+  std::atomic<int> m_hashed{0};
+  std::atomic<qint64> m_bytesHashed{0};
+  std::atomic<int> m_copied{0};
+  std::atomic<qint64> m_bytesCopied{0};
+};
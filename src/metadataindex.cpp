@@ -0,0 +1,331 @@
+#include "metadataindex.h"
+
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QSaveFile>
+#include <algorithm>
+#include <numeric>
+
+const QString MetadataIndex::kFileName = ".metadata";
+const QString MetadataIndex::kJournalName = ".metadata.journal";
+
+namespace {
+
+const quint32 kMagic = 0x43544d44;  // "CTMD"
+const quint32 kVersion = 1;
+const int kPixelHashSize = 16;
+// Journal records folded into the snapshot at once
+const int kCompactThreshold = 4096;
+
+}  // namespace
+
+void MetadataIndex::clear() {
+  m_dir.clear();
+  m_journalRecords = 0;
+  m_paths.clear();
+  m_widths.clear();
+  m_heights.clear();
+  m_formatCodes.clear();
+  m_formatDict = QStringList{QString()};
+  m_sizes.clear();
+  m_sources.clear();
+  m_pixelHashes.clear();
+  m_capturedAt.clear();
+  m_rowByPath.clear();
+}
+
+bool MetadataIndex::load(const QString &dir, QString *error) {
+  clear();
+  m_dir = dir;
+  if (dir.isEmpty()) return false;
+
+  QString loadError;
+  QFile snapshot(QDir(dir).filePath(kFileName));
+  if (snapshot.open(QIODevice::ReadOnly)) {
+    QDataStream in(&snapshot);
+    in.setVersion(QDataStream::Qt_6_0);
+    quint32 magic = 0;
+    quint32 version = 0;
+    in >> magic >> version;
+    if (magic == kMagic && version == kVersion) {
+      in >> m_paths >> m_widths >> m_heights >> m_formatDict >> m_formatCodes >> m_sizes >> m_sources >>
+          m_pixelHashes >> m_capturedAt;
+    }
+    int rows = m_paths.size();
+    bool consistent = in.status() == QDataStream::Ok && m_widths.size() == rows && m_heights.size() == rows &&
+                      m_formatCodes.size() == rows && m_sizes.size() == rows && m_sources.size() == rows &&
+                      m_pixelHashes.size() == rows * kPixelHashSize && m_capturedAt.size() == rows &&
+                      !m_formatDict.isEmpty();
+    if (!consistent) {
+      QString dirPath = m_dir;
+      clear();
+      m_dir = dirPath;
+      loadError = "Metadata snapshot is corrupt or from another version";
+    }
+    for (int row = 0; row < m_paths.size(); ++row) {
+      m_rowByPath.insert(m_paths[row], row);
+    }
+  }
+
+  QFile journal(QDir(dir).filePath(kJournalName));
+  if (journal.open(QIODevice::ReadOnly)) {
+    QDataStream in(&journal);
+    in.setVersion(QDataStream::Qt_6_0);
+    while (!in.atEnd()) {
+      quint8 op = 0;
+      in >> op;
+      if (op == AddOp) {
+        ImageMetadata item;
+        in >> item.path >> item.width >> item.height >> item.format >> item.size >> item.source >> item.pixelHash >>
+            item.capturedAt;
+        // A record torn by a crash ends the replay
+        if (in.status() != QDataStream::Ok) break;
+        insertRow(item);
+      } else if (op == RemoveOp) {
+        QString path;
+        in >> path;
+        if (in.status() != QDataStream::Ok) break;
+        removeRow(path);
+      } else if (op == RenameOp) {
+        QString from;
+        QString to;
+        in >> from >> to;
+        if (in.status() != QDataStream::Ok) break;
+        renameRow(from, to);
+      } else {
+        break;
+      }
+      m_journalRecords++;
+    }
+  }
+
+  if (m_journalRecords > kCompactThreshold) {
+    compact(&loadError);
+  }
+  if (!loadError.isEmpty()) {
+    if (error) *error = loadError;
+    return false;
+  }
+  return true;
+}
+
+ImageMetadata MetadataIndex::at(int row) const {
+  ImageMetadata item;
+  if (row < 0 || row >= m_paths.size()) return item;
+  item.path = m_paths[row];
+  item.width = m_widths[row];
+  item.height = m_heights[row];
+  item.format = format(row).toLatin1();
+  item.size = m_sizes[row];
+  item.source = m_sources[row];
+  QByteArray hash = m_pixelHashes.mid(row * kPixelHashSize, kPixelHashSize);
+  if (hash.count('\0') != kPixelHashSize) item.pixelHash = hash;
+  item.capturedAt = m_capturedAt[row];
+  return item;
+}
+
+QList<int> MetadataIndex::filter(const std::function<bool(int row)> &predicate) const {
+  QList<int> rows;
+  for (int row = 0; row < m_paths.size(); ++row) {
+    if (predicate(row)) rows.append(row);
+  }
+  return rows;
+}
+
+QList<int> MetadataIndex::sortedRows(Field field, Qt::SortOrder order) const {
+  QList<int> rows(m_paths.size());
+  std::iota(rows.begin(), rows.end(), 0);
+
+  auto sortBy = [&](auto key) {
+    std::stable_sort(rows.begin(), rows.end(), [&](int a, int b) {
+      return order == Qt::AscendingOrder ? key(a) < key(b) : key(b) < key(a);
+    });
+  };
+  switch (field) {
+    case Field::Path:
+      sortBy([this](int row) -> const QString & { return m_paths[row]; });
+      break;
+    case Field::Width:
+      sortBy([this](int row) { return m_widths[row]; });
+      break;
+    case Field::Height:
+      sortBy([this](int row) { return m_heights[row]; });
+      break;
+    case Field::Format:
+      sortBy([this](int row) -> const QString & { return m_formatDict[quint8(m_formatCodes[row])]; });
+      break;
+    case Field::Size:
+      sortBy([this](int row) { return m_sizes[row]; });
+      break;
+    case Field::Source:
+      sortBy([this](int row) -> const QString & { return m_sources[row]; });
+      break;
+    case Field::CapturedAt:
+      sortBy([this](int row) { return m_capturedAt[row]; });
+      break;
+  }
+  return rows;
+}
+
+bool MetadataIndex::append(const QList<ImageMetadata> &items, QString *error) {
+  if (items.isEmpty()) return true;
+  QByteArray records;
+  QDataStream out(&records, QIODevice::WriteOnly);
+  out.setVersion(QDataStream::Qt_6_0);
+  for (const ImageMetadata &item : items) {
+    insertRow(item);
+    out << quint8(AddOp) << item.path << item.width << item.height << item.format << item.size << item.source
+        << item.pixelHash << item.capturedAt;
+  }
+  return appendJournal(records, items.size(), error);
+}
+
+bool MetadataIndex::remove(const QStringList &paths, QString *error) {
+  QByteArray records;
+  QDataStream out(&records, QIODevice::WriteOnly);
+  out.setVersion(QDataStream::Qt_6_0);
+  int count = 0;
+  for (const QString &path : paths) {
+    if (!contains(path)) continue;
+    removeRow(path);
+    out << quint8(RemoveOp) << path;
+    count++;
+  }
+  return count == 0 || appendJournal(records, count, error);
+}
+
+bool MetadataIndex::rename(const QString &from, const QString &to, QString *error) {
+  if (!contains(from) || from == to) return true;
+  renameRow(from, to);
+  QByteArray records;
+  QDataStream out(&records, QIODevice::WriteOnly);
+  out.setVersion(QDataStream::Qt_6_0);
+  out << quint8(RenameOp) << from << to;
+  return appendJournal(records, 1, error);
+}
+
+bool MetadataIndex::compact(QString *error) {
+  if (m_dir.isEmpty()) return false;
+
+  QSaveFile file(QDir(m_dir).filePath(kFileName));
+  if (!file.open(QIODevice::WriteOnly)) {
+    if (error) *error = file.errorString();
+    return false;
+  }
+  QDataStream out(&file);
+  out.setVersion(QDataStream::Qt_6_0);
+  out << kMagic << kVersion << m_paths << m_widths << m_heights << m_formatDict << m_formatCodes << m_sizes
+      << m_sources << m_pixelHashes << m_capturedAt;
+  if (!file.commit()) {
+    if (error) *error = file.errorString();
+    return false;
+  }
+
+  // Replaying the journal over the new snapshot would be harmless, so a crash here is fine
+  QFile::remove(QDir(m_dir).filePath(kJournalName));
+  m_journalRecords = 0;
+  return true;
+}
+
+QByteArray MetadataIndex::pixelHash(const QImage &image) {
+  if (image.isNull()) return QByteArray();
+  QImage argb = image.convertToFormat(QImage::Format_ARGB32);
+  QCryptographicHash hash(QCryptographicHash::Md5);
+  qint32 dimensions[2] = {argb.width(), argb.height()};
+  hash.addData(QByteArrayView(reinterpret_cast<const char *>(dimensions), sizeof(dimensions)));
+  // Scanlines may be padded; only the pixels count
+  const qsizetype rowBytes = qsizetype(argb.width()) * 4;
+  for (int y = 0; y < argb.height(); ++y) {
+    hash.addData(QByteArrayView(reinterpret_cast<const char *>(argb.constScanLine(y)), rowBytes));
+  }
+  return hash.result();
+}
+
+void MetadataIndex::insertRow(const ImageMetadata &item) {
+  removeRow(item.path);
+  m_rowByPath.insert(item.path, m_paths.size());
+  m_paths.append(item.path);
+  m_widths.append(item.width);
+  m_heights.append(item.height);
+  m_formatCodes.append(char(formatCode(item.format)));
+  m_sizes.append(item.size);
+  m_sources.append(item.source);
+  QByteArray hash = item.pixelHash.left(kPixelHashSize);
+  hash.append(QByteArray(kPixelHashSize - hash.size(), '\0'));
+  m_pixelHashes.append(hash);
+  m_capturedAt.append(item.capturedAt);
+}
+
+void MetadataIndex::removeRow(const QString &path) {
+  auto it = m_rowByPath.find(path);
+  if (it == m_rowByPath.end()) return;
+  int row = it.value();
+  m_rowByPath.erase(it);
+
+  // Move the last row into the hole so removal stays O(1)
+  int last = m_paths.size() - 1;
+  if (row != last) {
+    m_paths[row] = m_paths[last];
+    m_widths[row] = m_widths[last];
+    m_heights[row] = m_heights[last];
+    m_formatCodes[row] = m_formatCodes[last];
+    m_sizes[row] = m_sizes[last];
+    m_sources[row] = m_sources[last];
+    QByteArray lastHash = m_pixelHashes.mid(last * kPixelHashSize, kPixelHashSize);
+    m_pixelHashes.replace(row * kPixelHashSize, kPixelHashSize, lastHash);
+    m_capturedAt[row] = m_capturedAt[last];
+    m_rowByPath[m_paths[row]] = row;
+  }
+  m_paths.removeLast();
+  m_widths.removeLast();
+  m_heights.removeLast();
+  m_formatCodes.chop(1);
+  m_sizes.removeLast();
+  m_sources.removeLast();
+  m_pixelHashes.chop(kPixelHashSize);
+  m_capturedAt.removeLast();
+}
+
+void MetadataIndex::renameRow(const QString &from, const QString &to) {
+  if (!m_rowByPath.contains(from) || from == to) return;
+  // Removing the target first may move this row, so look it up afterwards
+  removeRow(to);
+  int row = m_rowByPath.take(from);
+  m_paths[row] = to;
+  m_rowByPath.insert(to, row);
+}
+
+quint8 MetadataIndex::formatCode(const QByteArray &format) {
+  QString name = QString::fromLatin1(format).toLower();
+  int code = m_formatDict.indexOf(name);
+  if (code >= 0) return quint8(code);
+  // One byte per row; exotic formats beyond the dictionary are stored as unknown
+  if (m_formatDict.size() > 255) return 0;
+  m_formatDict.append(name);
+  return quint8(m_formatDict.size() - 1);
+}
+
+bool MetadataIndex::appendJournal(const QByteArray &records, int count, QString *error) {
+  if (m_dir.isEmpty()) return false;
+
+  QFile file(QDir(m_dir).filePath(kJournalName));
+  if (!file.open(QIODevice::WriteOnly | QIODevice::Append)) {
+    if (error) *error = file.errorString();
+    return false;
+  }
+  // A torn record would end the replay there; the caller must not count it as saved
+  if (file.write(records) != records.size() || !file.flush()) {
+    if (error) *error = file.errorString();
+    return false;
+  }
+  file.close();
+
+  m_journalRecords += count;
+  if (m_journalRecords > kCompactThreshold) {
+    return compact(error);
+  }
+  return true;
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <QByteArray>
+#include <QHash>
+#include <QImage>
+#include <QList>
+#include <QString>
+#include <QStringList>
+#include <functional>
+
+// What is known about a saved image at save time.
+struct ImageMetadata {
+  QString path;  // relative to the target directory
+  int width = 0;
+  int height = 0;
+  QByteArray format;
+  qint64 size = -1;
+  QString source;        // URL, original path or "<Clipboard Image>"
+  QByteArray pixelHash;  // MD5 of the decoded pixels; empty when the image was never decoded
+  qint64 capturedAt = 0;  // msecs since epoch
+};
+
+// Metadata of every saved image of a target directory, kept column by column so that
+// filtering or sorting by one field only touches that field. Persisted as a columnar
+// snapshot (.metadata) plus an append-only journal (.metadata.journal) that is folded
+// into the snapshot once it grows; a save therefore costs one small append.
+class MetadataIndex {
+ public:
+  enum class Field { Path, Width, Height, Format, Size, Source, CapturedAt };
+
+  static const QString kFileName;
+  static const QString kJournalName;
+
+  QString dir() const { return m_dir; }
+  void clear();
+  bool load(const QString &dir, QString *error = nullptr);
+
+  int size() const { return m_paths.size(); }
+  int rowOf(const QString &path) const { return m_rowByPath.value(path, -1); }
+  ImageMetadata at(int row) const;
+  bool contains(const QString &path) const { return m_rowByPath.contains(path); }
+
+  // Rows matching `predicate`, which gets the row number and reads the columns it needs
+  QList<int> filter(const std::function<bool(int row)> &predicate) const;
+  QList<int> sortedRows(Field field, Qt::SortOrder order = Qt::AscendingOrder) const;
+
+  QString path(int row) const { return m_paths[row]; }
+  int width(int row) const { return m_widths[row]; }
+  int height(int row) const { return m_heights[row]; }
+  QString format(int row) const { return m_formatDict[quint8(m_formatCodes[row])]; }
+  qint64 byteSize(int row) const { return m_sizes[row]; }
+  QString source(int row) const { return m_sources[row]; }
+  qint64 capturedAt(int row) const { return m_capturedAt[row]; }
+
+  bool append(const QList<ImageMetadata> &items, QString *error = nullptr);
+  bool remove(const QStringList &paths, QString *error = nullptr);
+  bool rename(const QString &from, const QString &to, QString *error = nullptr);
+  // Rewrites the snapshot and empties the journal
+  bool compact(QString *error = nullptr);
+
+  static QByteArray pixelHash(const QImage &image);
+
+ private:
+  enum Op : quint8 { AddOp = 1, RemoveOp = 2, RenameOp = 3 };
+
+  void insertRow(const ImageMetadata &item);
+  void removeRow(const QString &path);
+  void renameRow(const QString &from, const QString &to);
+  quint8 formatCode(const QByteArray &format);
+  bool appendJournal(const QByteArray &records, int count, QString *error);
+
+  QString m_dir;
+  int m_journalRecords = 0;
+
+  QStringList m_paths;
+  QList<qint32> m_widths;
+  QList<qint32> m_heights;
+  QByteArray m_formatCodes;  // one byte per row, indexes m_formatDict
+  QStringList m_formatDict{QString()};  // code 0 is "unknown"
+  QList<qint64> m_sizes;
+  QStringList m_sources;
+  QByteArray m_pixelHashes;  // kPixelHashSize bytes per row, zeros when unknown
+  QList<qint64> m_capturedAt;
+  QHash<QString, int> m_rowByPath;
+};
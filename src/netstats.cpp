@@ -0,0 +1,125 @@
+#include "netstats.h"
+
+#include <QByteArray>
+
+#if defined(Q_OS_LINUX)
+#include <unistd.h>
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QList>
+#include <QSet>
+#elif defined(Q_OS_MACOS)
+#include <ifaddrs.h>
+#include <net/if.h>
+#include <sys/socket.h>
+#endif
+
+namespace netstats {
+
+#if defined(Q_OS_LINUX)
+namespace {
+
+QList<QByteArray> readLines(const QString &path) {
+  QFile file(path);
+  if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) return {};
+  return file.readAll().split('\n');
+}
+
+// Interfaces the IPv4 and IPv6 default routes go out through
+QSet<QByteArray> defaultRouteInterfaces() {
+  QSet<QByteArray> names;
+  // "Iface Destination Gateway Flags RefCnt Use Metric Mask ...", addresses in hex
+  const QList<QByteArray> routes = readLines("/proc/net/route");
+  for (int i = 1; i < routes.size(); ++i) {
+    const QList<QByteArray> fields = routes[i].simplified().split(' ');
+    if (fields.size() >= 8 && fields[1] == "00000000" && fields[7] == "00000000") names.insert(fields[0]);
+  }
+  // "<destination> <prefix length> <source> <prefix length> <next hop> <metric> <refs> <use> <flags> <iface>"
+  const QByteArray anywhere(32, '0');
+  const QList<QByteArray> routes6 = readLines("/proc/net/ipv6_route");
+  for (const QByteArray &line : routes6) {
+    const QList<QByteArray> fields = line.simplified().split(' ');
+    // The kernel keeps an unreachable default route on lo
+    if (fields.size() >= 10 && fields[0] == anywhere && fields[1] == "00" && fields[9] != "lo") {
+      names.insert(fields[9]);
+    }
+  }
+  return names;
+}
+
+bool isPhysical(const QByteArray &name) {
+  return QFileInfo::exists("/sys/class/net/" + QString::fromLatin1(name) + "/device");
+}
+
+}  // namespace
+#endif
+
+qint64 receivedBytes() {
+#if defined(Q_OS_LINUX)
+  // "  eth0: <rx bytes> <rx packets> ..." after two header lines
+  const QList<QByteArray> lines = readLines("/proc/net/dev");
+  if (lines.isEmpty()) return -1;
+  const QSet<QByteArray> routed = defaultRouteInterfaces();
+  qint64 total = 0;
+  for (const QByteArray &line : lines) {
+    int colon = line.indexOf(':');
+    if (colon < 0) continue;
+    QByteArray name = line.left(colon).trimmed();
+    if (name == "lo" || !(routed.isEmpty() ? isPhysical(name) : routed.contains(name))) continue;
+    const QList<QByteArray> fields = line.mid(colon + 1).simplified().split(' ');
+    if (!fields.isEmpty()) total += fields[0].toLongLong();
+  }
+  return total;
+#elif defined(Q_OS_MACOS)
+  ifaddrs *addresses = nullptr;
+  if (getifaddrs(&addresses) != 0) return -1;
+  qint64 total = 0;
+  for (ifaddrs *address = addresses; address; address = address->ifa_next) {
+    if (!address->ifa_addr || address->ifa_addr->sa_family != AF_LINK || !address->ifa_data) continue;
+    // Ethernet and Wi-Fi; utun (VPN), bridge and awdl would count the same bytes twice
+    if ((address->ifa_flags & IFF_LOOPBACK) || qstrncmp(address->ifa_name, "en", 2) != 0) continue;
+    total += static_cast<const if_data *>(address->ifa_data)->ifi_ibytes;
+  }
+  freeifaddrs(addresses);
+  return total;
+#else
+  return -1;
+#endif
+}
+
+bool isAvailable() { return receivedBytes() >= 0; }
+
+qint64 unreadBytes() {
+#if defined(Q_OS_LINUX)
+  // Our sockets are the "socket:[<inode>]" links in /proc/self/fd
+  QSet<QByteArray> inodes;
+  const QStringList fds = QDir("/proc/self/fd").entryList(QDir::AllEntries | QDir::System | QDir::NoDotAndDotDot);
+  for (const QString &fd : fds) {
+    char target[64];
+    QByteArray path = "/proc/self/fd/" + fd.toLatin1();
+    ssize_t length = readlink(path.constData(), target, sizeof(target));
+    if (length <= 0) continue;
+    QByteArray link(target, int(length));
+    if (link.startsWith("socket:[") && link.endsWith(']')) inodes.insert(link.mid(8, link.size() - 9));
+  }
+  if (inodes.isEmpty()) return 0;
+
+  // "sl local rem st tx_queue:rx_queue tr:when retrnsmt uid timeout inode ...", queues in hex
+  qint64 total = 0;
+  for (const char *table : {"/proc/net/tcp", "/proc/net/tcp6"}) {
+    const QList<QByteArray> lines = readLines(table);
+    for (int i = 1; i < lines.size(); ++i) {
+      const QList<QByteArray> fields = lines[i].simplified().split(' ');
+      if (fields.size() < 10 || !inodes.contains(fields[9])) continue;
+      total += fields[4].mid(fields[4].indexOf(':') + 1).toLongLong(nullptr, 16);
+    }
+  }
+  return total;
+#else
+  return 0;
+#endif
+}
+
+}  // namespace netstats
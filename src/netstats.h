@@ -0,0 +1,21 @@
+#pragma once
+
+#include <QtGlobal>
+
+namespace netstats {
+
+// Bytes received so far on the interfaces that carry the machine's own traffic, as counted
+// by the OS; -1 where no counter is available (only Linux and macOS are read). On Linux
+// those are the interfaces of the default routes, or every physical interface when there
+// is none; container bridges, veth pairs and split-tunnel VPNs are left out. On macOS the
+// built-in en* interfaces are counted. Only differences between two calls mean anything:
+// counters start at boot and may wrap.
+qint64 receivedBytes();
+// Whether receivedBytes() works on this platform
+bool isAvailable();
+// Bytes the kernel has received on this process's TCP sockets that have not been read
+// yet. They are in receivedBytes() already but not in what a reader has taken off its
+// sockets. Always 0 where it cannot be read (everywhere but Linux).
+qint64 unreadBytes();
+
+}  // namespace netstats
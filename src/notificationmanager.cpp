@@ -83,10 +83,10 @@ NotificationWidget::NotificationWidget(Notification *notification, QWidget *pare
     : QWidget(parent), m_notification(notification) {
   setupUi();
 
-  connect(m_notification, &Notification::dataChanged, this, [this]() {
-    updateProgressBar();
-    updateStyle();
-  });
+  // Progress ticks only touch the bar; restyling is reserved for the error state flipping
+  connect(m_notification, &Notification::progressChanged, this, &NotificationWidget::updateProgressBar);
+  connect(m_notification, &Notification::hasProgressChanged, this, &NotificationWidget::updateProgressBar);
+  connect(m_notification, &Notification::isErrorChanged, this, &NotificationWidget::updateStyle);
 
   m_opacityEffect = new QGraphicsOpacityEffect(this);
   m_opacityEffect->setOpacity(0.0);
@@ -184,6 +184,9 @@ void NotificationWidget::updateProgressBar() {
 
 void NotificationWidget::updateStyle() {
   QString borderColor = levelToColor();
+  // Setting a style sheet repolishes the widget and all its children, even when unchanged
+  if (borderColor == m_appliedBorderColor) return;
+  m_appliedBorderColor = borderColor;
   setStyleSheet(QString("NotificationWidget {"
                         "  background-color: #2d2d2d;"
                         "  border: 5px solid %1;"
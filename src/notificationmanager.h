@@ -84,6 +84,7 @@ class NotificationWidget : public QWidget {
   QGraphicsOpacityEffect *m_opacityEffect;
   QPropertyAnimation *m_opacityAnimation;
   bool m_fadingOut = false;
+  QString m_appliedBorderColor;
 };
 
 class NotificationManager : public QObject {
@@ -0,0 +1,364 @@
+#include "pngencoder.h"
+
+#include <QBuffer>
+#include <QDebug>
+#include <QImageWriter>
+#include <QSaveFile>
+#include <QSysInfo>
+#include <QThread>
+#include <QThreadPool>
+#include <QVector>
+#include <QtConcurrent>
+#include <QtEndian>
+#include <cstdlib>
+
+#ifdef CLIPBOARD_TOOLBOX_HAS_ZLIB
+#include <zlib.h>
+#endif
+
+namespace {
+
+#ifdef CLIPBOARD_TOOLBOX_HAS_ZLIB
+
+constexpr int kMinRowsPerBand = 64;
+constexpr qsizetype kOutputChunk = 256 * 1024;
+// PNG caps a chunk at 2^31-1 bytes; bands of huge images are split well below that
+constexpr qsizetype kMaxIdatSize = 1024 * 1024;
+
+struct Band {
+  int firstRow = 0;
+  int rowCount = 0;
+  bool isLast = false;
+  QByteArray deflated;
+  uLong adler = 1;
+  qint64 rawLength = 0;
+  bool ok = false;
+};
+
+QThreadPool *encoderPool() {
+  static QThreadPool pool;
+  return &pool;
+}
+
+inline uchar paethPredictor(int a, int b, int c) {
+  int p = a + b - c;
+  int pa = std::abs(p - a);
+  int pb = std::abs(p - b);
+  int pc = std::abs(p - c);
+  if (pa <= pb && pa <= pc) return uchar(a);
+  if (pb <= pc) return uchar(b);
+  return uchar(c);
+}
+
+// Applies filter `type` to `row` (prev may be null for the first image row) and
+// returns the libpng "minimum sum of absolute differences" cost of the result.
+quint64 applyFilter(int type, const uchar *row, const uchar *prev, int length, int bpp, uchar *out) {
+  quint64 cost = 0;
+  out[0] = uchar(type);
+  uchar *dst = out + 1;
+  for (int i = 0; i < length; ++i) {
+    int a = i >= bpp ? row[i - bpp] : 0;
+    int b = prev ? prev[i] : 0;
+    int c = (prev && i >= bpp) ? prev[i - bpp] : 0;
+    uchar v = row[i];
+    switch (type) {
+      case 1:
+        v = uchar(v - a);
+        break;
+      case 2:
+        v = uchar(v - b);
+        break;
+      case 3:
+        v = uchar(v - ((a + b) >> 1));
+        break;
+      case 4:
+        v = uchar(v - paethPredictor(a, b, c));
+        break;
+      default:
+        break;
+    }
+    dst[i] = v;
+    cost += std::abs(int(qint8(v)));
+  }
+  return cost;
+}
+
+bool runDeflate(z_stream &zs, QByteArray &out, qsizetype &used, int flush) {
+  forever {
+    if (used == out.size()) {
+      out.resize(out.size() + qMax(kOutputChunk, out.size() / 2));
+    }
+    const uInt avail = uInt(qMin<qsizetype>(out.size() - used, 1 << 30));
+    zs.next_out = reinterpret_cast<Bytef *>(out.data() + used);
+    zs.avail_out = avail;
+    int ret = deflate(&zs, flush);
+    used += avail - zs.avail_out;
+    if (ret == Z_STREAM_ERROR) return false;
+    if (flush == Z_FINISH) {
+      if (ret == Z_STREAM_END) return true;
+    } else if (zs.avail_out != 0) {
+      return true;
+    }
+  }
+}
+
+void encodeBand(const QImage &image, int bpp, int level, Band &band) {
+  const int length = image.width() * bpp;
+  QByteArray candidates(5 * (length + 1), Qt::Uninitialized);
+  uchar *buffers = reinterpret_cast<uchar *>(candidates.data());
+
+  z_stream zs = {};
+  // Negative window bits: raw deflate, the zlib wrapper is written once for the whole image
+  if (deflateInit2(&zs, level, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY) != Z_OK) return;
+
+  qsizetype used = 0;
+  qsizetype bound = qsizetype(deflateBound(&zs, uLong(band.rowCount) * (length + 1)));
+  band.deflated.resize(qMax<qsizetype>(kOutputChunk, bound));
+  band.adler = adler32(0L, Z_NULL, 0);
+  bool ok = true;
+
+  for (int y = band.firstRow; ok && y < band.firstRow + band.rowCount; ++y) {
+    const uchar *row = image.constScanLine(y);
+    const uchar *prev = y > 0 ? image.constScanLine(y - 1) : nullptr;
+
+    int bestType = 0;
+    quint64 bestCost = applyFilter(0, row, prev, length, bpp, buffers);
+    for (int type = 1; type < 5; ++type) {
+      quint64 cost = applyFilter(type, row, prev, length, bpp, buffers + type * (length + 1));
+      if (cost < bestCost) {
+        bestCost = cost;
+        bestType = type;
+      }
+    }
+
+    uchar *filtered = buffers + bestType * (length + 1);
+    band.adler = adler32(band.adler, filtered, uInt(length + 1));
+    band.rawLength += length + 1;
+    zs.next_in = filtered;
+    zs.avail_in = uInt(length + 1);
+    ok = runDeflate(zs, band.deflated, used, Z_NO_FLUSH);
+  }
+
+  // A sync flush ends the segment on a byte boundary without setting BFINAL, so the
+  // next band's segment can be appended directly.
+  if (ok) ok = runDeflate(zs, band.deflated, used, band.isLast ? Z_FINISH : Z_SYNC_FLUSH);
+
+  deflateEnd(&zs);
+  band.deflated.resize(used);
+  band.ok = ok;
+}
+
+// `size` must fit a chunk, i.e. stay below 2^31
+bool writeChunk(QIODevice *device, const char *type, const char *data, qsizetype size) {
+  uchar header[8];
+  qToBigEndian<quint32>(quint32(size), header);
+  memcpy(header + 4, type, 4);
+
+  uLong crc = crc32(0L, Z_NULL, 0);
+  crc = crc32(crc, header + 4, 4);
+  crc = crc32_z(crc, reinterpret_cast<const Bytef *>(data), z_size_t(size));
+  uchar trailer[4];
+  qToBigEndian<quint32>(quint32(crc), trailer);
+
+  return device->write(reinterpret_cast<const char *>(header), 8) == 8 && device->write(data, size) == size &&
+         device->write(reinterpret_cast<const char *>(trailer), 4) == 4;
+}
+
+bool writeChunk(QIODevice *device, const char *type, const QByteArray &data) {
+  return writeChunk(device, type, data.constData(), data.size());
+}
+
+bool hasWideChannels(QImage::Format format) {
+  switch (format) {
+    case QImage::Format_Grayscale16:
+    case QImage::Format_RGBX64:
+    case QImage::Format_RGBA64:
+    case QImage::Format_RGBA64_Premultiplied:
+    case QImage::Format_RGBX16FPx4:
+    case QImage::Format_RGBA16FPx4:
+    case QImage::Format_RGBA16FPx4_Premultiplied:
+    case QImage::Format_RGBX32FPx4:
+    case QImage::Format_RGBA32FPx4:
+    case QImage::Format_RGBA32FPx4_Premultiplied:
+      return true;
+    default:
+      return false;
+  }
+}
+
+// PNG samples are big-endian; Qt keeps 16-bit channels in host order. The result is only
+// good as raw scanline bytes.
+QImage toBigEndianSamples(QImage image) {
+  if (QSysInfo::ByteOrder == QSysInfo::BigEndian) return image;
+  const qsizetype rowBytes = qsizetype(image.width()) * image.depth() / 8;
+  for (int y = 0; y < image.height(); ++y) {
+    auto samples = reinterpret_cast<quint16 *>(image.scanLine(y));
+    for (qsizetype i = 0; i < rowBytes / 2; ++i) samples[i] = qbswap(samples[i]);
+  }
+  return image;
+}
+
+#endif
+
+}  // namespace
+
+PngEncoder::PngEncoder(int threadCount) { setThreadCount(threadCount); }
+
+void PngEncoder::setThreadCount(int count) { m_threadCount = qMax(0, count); }
+
+void PngEncoder::setCompressionLevel(int level) { m_compressionLevel = qBound(0, level, 9); }
+
+bool PngEncoder::isParallelAvailable() {
+#ifdef CLIPBOARD_TOOLBOX_HAS_ZLIB
+  return true;
+#else
+  return false;
+#endif
+}
+
+int PngEncoder::effectiveThreadCount() const {
+  return m_threadCount > 0 ? m_threadCount : qMax(1, QThread::idealThreadCount());
+}
+
+bool PngEncoder::encode(const QImage &image, QIODevice *device) const {
+  if (image.isNull() || !device || !device->isWritable()) return false;
+
+#ifdef CLIPBOARD_TOOLBOX_HAS_ZLIB
+  QImage source;
+  int colorType = 0;
+  int bpp = 0;
+  int bitDepth = 8;
+  if (hasWideChannels(image.format())) {
+    // Filters work on bytes, `bpp` bytes apart, whatever the sample size
+    bitDepth = 16;
+    if (image.format() == QImage::Format_Grayscale16) {
+      source = toBigEndianSamples(image);
+      colorType = 0;
+      bpp = 2;
+    } else if (image.hasAlphaChannel()) {
+      source = toBigEndianSamples(image.convertToFormat(QImage::Format_RGBA64));
+      colorType = 6;
+      bpp = 8;
+    } else {
+      // No 16-bit RGB format without padding: the padding channel goes out as opaque alpha
+      source = toBigEndianSamples(image.convertToFormat(QImage::Format_RGBX64));
+      colorType = 6;
+      bpp = 8;
+    }
+  } else if (image.format() == QImage::Format_Grayscale8) {
+    source = image;
+    colorType = 0;
+    bpp = 1;
+  } else if (image.hasAlphaChannel()) {
+    // PNG stores straight (non-premultiplied) alpha
+    source = image.convertToFormat(QImage::Format_RGBA8888);
+    colorType = 6;
+    bpp = 4;
+  } else {
+    source = image.convertToFormat(QImage::Format_RGB888);
+    colorType = 2;
+    bpp = 3;
+  }
+  if (source.isNull()) return false;
+
+  const int height = source.height();
+  const int bandCount = qBound(1, height / kMinRowsPerBand, effectiveThreadCount());
+  const int rowsPerBand = (height + bandCount - 1) / bandCount;
+
+  QVector<Band> bands;
+  for (int first = 0; first < height; first += rowsPerBand) {
+    Band band;
+    band.firstRow = first;
+    band.rowCount = qMin(rowsPerBand, height - first);
+    bands.append(band);
+  }
+  bands.last().isLast = true;
+
+  const int level = m_compressionLevel;
+  if (bands.size() == 1) {
+    encodeBand(source, bpp, level, bands.first());
+  } else {
+    QThreadPool *pool = encoderPool();
+    if (pool->maxThreadCount() < bands.size()) {
+      pool->setMaxThreadCount(bands.size());
+    }
+    QtConcurrent::blockingMap(pool, bands, [&source, bpp, level](Band &band) { encodeBand(source, bpp, level, band); });
+  }
+
+  uLong adler = adler32(0L, Z_NULL, 0);
+  for (const Band &band : std::as_const(bands)) {
+    if (!band.ok) {
+      qDebug() << "PNG band encoding failed at row" << band.firstRow;
+      return false;
+    }
+    adler = adler32_combine(adler, band.adler, z_off_t(band.rawLength));
+  }
+
+  static const char signature[8] = {'\x89', 'P', 'N', 'G', '\r', '\n', '\x1a', '\n'};
+  if (device->write(signature, 8) != 8) return false;
+
+  QByteArray ihdr(13, '\0');
+  uchar *p = reinterpret_cast<uchar *>(ihdr.data());
+  qToBigEndian<quint32>(quint32(source.width()), p);
+  qToBigEndian<quint32>(quint32(height), p + 4);
+  p[8] = uchar(bitDepth);
+  p[9] = uchar(colorType);
+  if (!writeChunk(device, "IHDR", ihdr)) return false;
+
+  if (source.dotsPerMeterX() > 0 && source.dotsPerMeterY() > 0) {
+    QByteArray phys(9, '\0');
+    uchar *q = reinterpret_cast<uchar *>(phys.data());
+    qToBigEndian<quint32>(quint32(source.dotsPerMeterX()), q);
+    qToBigEndian<quint32>(quint32(source.dotsPerMeterY()), q + 4);
+    q[8] = 1;  // unit: meter
+    if (!writeChunk(device, "pHYs", phys)) return false;
+  }
+
+  for (int i = 0; i < bands.size(); ++i) {
+    QByteArray data;
+    if (i == 0) {
+      data.append(char(0x78));
+      data.append(char(0x9C));
+    }
+    data.append(bands[i].deflated);
+    bands[i].deflated.clear();
+    if (i == bands.size() - 1) {
+      uchar tail[4];
+      qToBigEndian<quint32>(quint32(adler), tail);
+      data.append(reinterpret_cast<const char *>(tail), 4);
+    }
+    // The zlib stream may be cut anywhere; decoders concatenate consecutive IDATs
+    for (qsizetype offset = 0; offset < data.size(); offset += kMaxIdatSize) {
+      qsizetype size = qMin(kMaxIdatSize, data.size() - offset);
+      if (!writeChunk(device, "IDAT", data.constData() + offset, size)) return false;
+    }
+  }
+
+  return writeChunk(device, "IEND", QByteArray());
+#else
+  QImageWriter writer(device, "png");
+  writer.setQuality(100 - m_compressionLevel * 11);
+  return writer.write(image);
+#endif
+}
+
+QByteArray PngEncoder::encode(const QImage &image) const {
+  QByteArray data;
+  QBuffer buffer(&data);
+  buffer.open(QIODevice::WriteOnly);
+  if (!encode(image, &buffer)) return QByteArray();
+  return data;
+}
+
+bool PngEncoder::save(const QImage &image, const QString &path) const {
+  QSaveFile file(path);
+  if (!file.open(QIODevice::WriteOnly)) {
+    qDebug() << "Failed to open" << path << file.errorString();
+    return false;
+  }
+  if (!encode(image, &file)) {
+    file.cancelWriting();
+    return false;
+  }
+  return file.commit();
+}
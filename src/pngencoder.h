@@ -0,0 +1,36 @@
+#pragma once
+
+#include <QByteArray>
+#include <QImage>
+#include <QString>
+
+class QIODevice;
+
+// Lossless PNG writer that filters and deflates horizontal row bands in parallel.
+// Each band is compressed as an independent, byte-aligned deflate segment and the
+// segments are stitched into a single zlib stream, so the output is a regular PNG.
+// Images with more than 8 bits per channel (16-bit and floating point formats) are
+// written with 16-bit samples. Without zlib at build time it falls back to QImageWriter.
+class PngEncoder {
+ public:
+  explicit PngEncoder(int threadCount = 0);
+
+  // 0 means QThread::idealThreadCount()
+  int threadCount() const { return m_threadCount; }
+  void setThreadCount(int count);
+
+  int compressionLevel() const { return m_compressionLevel; }
+  void setCompressionLevel(int level);
+
+  bool encode(const QImage &image, QIODevice *device) const;
+  QByteArray encode(const QImage &image) const;
+  bool save(const QImage &image, const QString &path) const;
+
+  static bool isParallelAvailable();
+
+ private:
+  int effectiveThreadCount() const;
+
+  int m_threadCount = 0;
+  int m_compressionLevel = 6;
+};
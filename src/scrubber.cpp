@@ -0,0 +1,157 @@
+#include "scrubber.h"
+
+#include <QtGlobal>
+
+#include <QCryptographicHash>
+#include <QDebug>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QSettings>
+#include <QStandardPaths>
+#include <QThread>
+#include <QThreadPool>
+#include <QtConcurrent>
+
+#if defined(Q_OS_LINUX)
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+const qint64 kChunkSize = 1024 * 1024;
+const qint64 kStateSaveIntervalMs = 5000;
+
+void lowerIoPriority() {
+#if defined(Q_OS_LINUX) && defined(SYS_ioprio_set)
+  // IOPRIO_WHO_PROCESS with id 0 targets the calling thread; class IDLE only gets disk
+  // time nobody else wants
+  const int kWhoProcess = 1;
+  const int kClassIdle = 3;
+  const int kClassShift = 13;
+  syscall(SYS_ioprio_set, kWhoProcess, 0, kClassIdle << kClassShift);
+#endif
+}
+
+}  // namespace
+
+Scrubber::Scrubber(QObject *parent) : QObject(parent), m_pool(new QThreadPool(this)) {
+  m_pool->setMaxThreadCount(1);
+  m_pool->setThreadPriority(QThread::IdlePriority);
+}
+
+Scrubber::~Scrubber() {
+  stop();
+  m_future.waitForFinished();
+}
+
+void Scrubber::start(const QString &dir, const QList<ChecksumIndex::Entry> &entries) {
+  if (isRunning() || dir.isEmpty()) return;
+  m_stop = false;
+  m_future = QtConcurrent::run(m_pool, [this, dir, entries]() { run(dir, entries); });
+}
+
+void Scrubber::stop() { m_stop = true; }
+
+QString Scrubber::stateFilePath(const QString &dir) {
+  QByteArray key = QCryptographicHash::hash(QDir::cleanPath(dir).toUtf8(), QCryptographicHash::Md5).toHex();
+  return QDir(QStandardPaths::writableLocation(QStandardPaths::AppDataLocation))
+      .filePath("scrub/" + QString::fromLatin1(key) + ".ini");
+}
+
+Scrubber::State Scrubber::loadState(const QString &dir) {
+  QSettings settings(stateFilePath(dir), QSettings::IniFormat);
+  State state;
+  state.cursor = settings.value("cursor").toString();
+  state.lastCompleted = settings.value("lastCompleted").toDateTime();
+  return state;
+}
+
+void Scrubber::saveState(const QString &dir, const State &state) {
+  QString path = stateFilePath(dir);
+  QDir().mkpath(QFileInfo(path).path());
+  QSettings settings(path, QSettings::IniFormat);
+  settings.setValue("cursor", state.cursor);
+  settings.setValue("lastCompleted", state.lastCompleted);
+  settings.sync();
+}
+
+void Scrubber::run(const QString &dir, QList<ChecksumIndex::Entry> entries) {
+  lowerIoPriority();
+
+  std::sort(entries.begin(), entries.end(),
+            [](const ChecksumIndex::Entry &a, const ChecksumIndex::Entry &b) { return a.path < b.path; });
+  State state = loadState(dir);
+  QDir root(dir);
+
+  int verified = 0;
+  int mismatches = 0;
+  qint64 bytesRead = 0;
+  QElapsedTimer timer;
+  timer.start();
+  QElapsedTimer sinceSave;
+  sinceSave.start();
+  QByteArray buffer(kChunkSize, Qt::Uninitialized);
+
+  for (const ChecksumIndex::Entry &entry : std::as_const(entries)) {
+    if (m_stop) break;
+    if (!state.cursor.isEmpty() && entry.path <= state.cursor) continue;
+
+    QFile file(root.filePath(entry.path));
+    // Deleted files are left for "Clean Checksums"
+    if (!file.exists()) {
+      state.cursor = entry.path;
+      continue;
+    }
+
+    QCryptographicHash hash(QCryptographicHash::Md5);
+    bool readOk = file.open(QIODevice::ReadOnly);
+    while (readOk && !file.atEnd() && !m_stop) {
+      qint64 n = file.read(buffer.data(), buffer.size());
+      if (n < 0) {
+        readOk = false;
+        break;
+      }
+      hash.addData(QByteArrayView(buffer.constData(), n));
+      bytesRead += n;
+
+      // Sleep off whatever is ahead of the budget
+      qint64 limit = m_bandwidthLimit;
+      if (limit > 0) {
+        qint64 ahead = bytesRead * 1000 / limit - timer.elapsed();
+        if (ahead > 0) QThread::msleep(qMin<qint64>(ahead, 1000));
+      }
+    }
+    if (m_stop) break;
+
+    QByteArray actual = readOk ? hash.result() : QByteArray();
+    // Removed while it was being read: skipped like any other deleted file, not an error
+    if (actual != entry.checksum && !file.exists()) {
+      state.cursor = entry.path;
+      continue;
+    }
+    if (actual != entry.checksum) {
+      mismatches++;
+      emit mismatch(dir, entry.path, entry.checksum, actual);
+    }
+    verified++;
+    state.cursor = entry.path;
+
+    if (sinceSave.elapsed() > kStateSaveIntervalMs) {
+      saveState(dir, state);
+      sinceSave.restart();
+    }
+  }
+
+  bool completed = !m_stop;
+  if (completed) {
+    state.cursor.clear();
+    state.lastCompleted = QDateTime::currentDateTime();
+  }
+  saveState(dir, state);
+  qDebug() << "Scrub of" << dir << (completed ? "completed:" : "paused:") << verified << "file(s)," << bytesRead
+           << "byte(s) in" << timer.elapsed() << "ms";
+  emit finished(dir, verified, mismatches, completed);
+}
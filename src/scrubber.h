@@ -0,0 +1,56 @@
+#pragma once
+
+#include <QByteArray>
+#include <QDateTime>
+#include <QFuture>
+#include <QList>
+#include <QObject>
+#include <QString>
+#include <atomic>
+
+#include "checksumindex.h"
+
+class QThreadPool;
+
+// Re-hashes archived files against checksums.txt in the background to catch silent
+// corruption. Runs on a single idle-priority thread under a read bandwidth budget and
+// keeps a cursor per directory in the app data location, so an interrupted pass resumes
+// where it stopped. Nothing is written into the archive, which is being watched.
+class Scrubber : public QObject {
+  Q_OBJECT
+
+ public:
+  struct State {
+    QString cursor;  // last verified path of the running pass; empty between passes
+    QDateTime lastCompleted;
+  };
+
+  explicit Scrubber(QObject *parent = nullptr);
+  ~Scrubber();
+
+  // Bytes per second; 0 means unlimited. Applies to a running pass as well.
+  void setBandwidthLimit(qint64 bytesPerSecond) { m_bandwidthLimit = bytesPerSecond; }
+
+  // Verifies `entries` of `dir`, continuing after the stored cursor
+  void start(const QString &dir, const QList<ChecksumIndex::Entry> &entries);
+  // The cursor is kept, so the next start() continues from there
+  void stop();
+  bool isRunning() const { return m_future.isRunning(); }
+
+  static State loadState(const QString &dir);
+  static void saveState(const QString &dir, const State &state);
+
+ signals:
+  // `actual` is empty when the file could not be read
+  void mismatch(const QString &dir, const QString &path, const QByteArray &expected, const QByteArray &actual);
+  void finished(const QString &dir, int verified, int mismatches, bool completed);
+
+ private:
+  void run(const QString &dir, QList<ChecksumIndex::Entry> entries);
+  static QString stateFilePath(const QString &dir);
+
+  QThreadPool *m_pool = nullptr;
+  QFuture<void> m_future;
+  std::atomic<qint64> m_bandwidthLimit{0};
+  std::atomic_bool m_stop{false};
+};
@@ -11,6 +11,23 @@ SettingsManager::SettingsManager(QObject *parent) : QObject(parent) {
   m_autoSavePath = settings.value("autoSavePath", "").toString();
   m_recentAutoSavePaths = settings.value("recentAutoSavePaths").toStringList();  // Added
   m_autoSaveMaxSizeMB = settings.value("autoSaveMaxSizeMB", 30).toInt();
+  m_autoSaveParanoidValidation = settings.value("autoSaveParanoidValidation", false).toBool();
+  m_autoSaveQuotaMB = settings.value("autoSaveQuotaMB", 0).toInt();
+  m_autoSaveQuotaFiles = settings.value("autoSaveQuotaFiles", 0).toInt();
+  m_autoSaveEvictionPolicy = archivequota::fromString(settings.value("autoSaveEvictionPolicy", "Oldest").toString());
+  m_autoSaveScrubEnabled = settings.value("autoSaveScrubEnabled", true).toBool();
+  m_autoSaveScrubBandwidthMB = settings.value("autoSaveScrubBandwidthMB", 16).toInt();
+  m_autoSaveBlobStore = settings.value("autoSaveBlobStore", false).toBool();
+  m_autoSaveLayout = archivelayout::fromString(settings.value("autoSaveLayout", "Flat").toString());
+  m_autoSaveDedupScope =
+      dedupscope::fromString(settings.value("autoSaveDedupScope", "CurrentDirectory").toString());
+  m_autoSaveWatchFolders = settings.value("autoSaveWatchFolders").toStringList();
+  m_downloadConcurrency = settings.value("downloadConcurrency", 4).toInt();
+  m_downloadsPerHost = settings.value("downloadsPerHost", 2).toInt();
+  m_downloadBandwidthKB = settings.value("downloadBandwidthKB", 0).toInt();
+  m_perDownloadBandwidthKB = settings.value("perDownloadBandwidthKB", 0).toInt();
+  m_downloadPauseOnForegroundTraffic = settings.value("downloadPauseOnForegroundTraffic", false).toBool();
+  m_pngEncoderThreads = settings.value("pngEncoderThreads", 0).toInt();
 
   int levelInt = settings.value("notificationLevel", (int)EventLevel::Info).toInt();
   m_notificationLevel = static_cast<EventLevel>(levelInt);
@@ -141,6 +158,198 @@ void SettingsManager::setAutoSaveMaxSizeMB(int sizeMB) {
   emit autoSaveMaxSizeMBChanged(sizeMB);
 }
 
+bool SettingsManager::autoSaveParanoidValidation() const { return m_autoSaveParanoidValidation; }
+
+void SettingsManager::setAutoSaveParanoidValidation(bool paranoid) {
+  if (m_autoSaveParanoidValidation == paranoid) {
+    return;
+  }
+  m_autoSaveParanoidValidation = paranoid;
+  QSettings settings = createSettings();
+  settings.setValue("autoSaveParanoidValidation", paranoid);
+  emit autoSaveParanoidValidationChanged(paranoid);
+}
+
+int SettingsManager::autoSaveQuotaMB() const { return m_autoSaveQuotaMB; }
+
+void SettingsManager::setAutoSaveQuotaMB(int quotaMB) {
+  if (m_autoSaveQuotaMB == quotaMB) {
+    return;
+  }
+  m_autoSaveQuotaMB = quotaMB;
+  QSettings settings = createSettings();
+  settings.setValue("autoSaveQuotaMB", quotaMB);
+  emit autoSaveQuotaMBChanged(quotaMB);
+}
+
+int SettingsManager::autoSaveQuotaFiles() const { return m_autoSaveQuotaFiles; }
+
+void SettingsManager::setAutoSaveQuotaFiles(int quotaFiles) {
+  if (m_autoSaveQuotaFiles == quotaFiles) {
+    return;
+  }
+  m_autoSaveQuotaFiles = quotaFiles;
+  QSettings settings = createSettings();
+  settings.setValue("autoSaveQuotaFiles", quotaFiles);
+  emit autoSaveQuotaFilesChanged(quotaFiles);
+}
+
+EvictionPolicy SettingsManager::autoSaveEvictionPolicy() const { return m_autoSaveEvictionPolicy; }
+
+void SettingsManager::setAutoSaveEvictionPolicy(EvictionPolicy policy) {
+  if (m_autoSaveEvictionPolicy == policy) {
+    return;
+  }
+  m_autoSaveEvictionPolicy = policy;
+  QSettings settings = createSettings();
+  settings.setValue("autoSaveEvictionPolicy", archivequota::toString(policy));
+  emit autoSaveEvictionPolicyChanged(policy);
+}
+
+bool SettingsManager::autoSaveScrubEnabled() const { return m_autoSaveScrubEnabled; }
+
+void SettingsManager::setAutoSaveScrubEnabled(bool enabled) {
+  if (m_autoSaveScrubEnabled == enabled) {
+    return;
+  }
+  m_autoSaveScrubEnabled = enabled;
+  QSettings settings = createSettings();
+  settings.setValue("autoSaveScrubEnabled", enabled);
+  emit autoSaveScrubEnabledChanged(enabled);
+}
+
+int SettingsManager::autoSaveScrubBandwidthMB() const { return m_autoSaveScrubBandwidthMB; }
+
+void SettingsManager::setAutoSaveScrubBandwidthMB(int bandwidthMB) {
+  if (m_autoSaveScrubBandwidthMB == bandwidthMB) {
+    return;
+  }
+  m_autoSaveScrubBandwidthMB = bandwidthMB;
+  QSettings settings = createSettings();
+  settings.setValue("autoSaveScrubBandwidthMB", bandwidthMB);
+  emit autoSaveScrubBandwidthMBChanged(bandwidthMB);
+}
+
+bool SettingsManager::autoSaveBlobStore() const { return m_autoSaveBlobStore; }
+
+void SettingsManager::setAutoSaveBlobStore(bool enabled) {
+  if (m_autoSaveBlobStore == enabled) {
+    return;
+  }
+  m_autoSaveBlobStore = enabled;
+  QSettings settings = createSettings();
+  settings.setValue("autoSaveBlobStore", enabled);
+  emit autoSaveBlobStoreChanged(enabled);
+}
+
+ArchiveLayout SettingsManager::autoSaveLayout() const { return m_autoSaveLayout; }
+
+void SettingsManager::setAutoSaveLayout(ArchiveLayout layout) {
+  if (m_autoSaveLayout == layout) {
+    return;
+  }
+  m_autoSaveLayout = layout;
+  QSettings settings = createSettings();
+  settings.setValue("autoSaveLayout", archivelayout::toString(layout));
+  emit autoSaveLayoutChanged(layout);
+}
+
+DedupScope SettingsManager::autoSaveDedupScope() const { return m_autoSaveDedupScope; }
+
+void SettingsManager::setAutoSaveDedupScope(DedupScope scope) {
+  if (m_autoSaveDedupScope == scope) {
+    return;
+  }
+  m_autoSaveDedupScope = scope;
+  QSettings settings = createSettings();
+  settings.setValue("autoSaveDedupScope", dedupscope::toString(scope));
+  emit autoSaveDedupScopeChanged(scope);
+}
+
+QStringList SettingsManager::autoSaveWatchFolders() const { return m_autoSaveWatchFolders; }
+
+void SettingsManager::setAutoSaveWatchFolders(const QStringList &folders) {
+  if (m_autoSaveWatchFolders == folders) {
+    return;
+  }
+  m_autoSaveWatchFolders = folders;
+  QSettings settings = createSettings();
+  settings.setValue("autoSaveWatchFolders", folders);
+  emit autoSaveWatchFoldersChanged(folders);
+}
+
+int SettingsManager::downloadConcurrency() const { return m_downloadConcurrency; }
+
+void SettingsManager::setDownloadConcurrency(int concurrency) {
+  if (m_downloadConcurrency == concurrency) {
+    return;
+  }
+  m_downloadConcurrency = concurrency;
+  QSettings settings = createSettings();
+  settings.setValue("downloadConcurrency", concurrency);
+  emit downloadConcurrencyChanged(concurrency);
+}
+
+int SettingsManager::downloadsPerHost() const { return m_downloadsPerHost; }
+
+void SettingsManager::setDownloadsPerHost(int perHost) {
+  if (m_downloadsPerHost == perHost) {
+    return;
+  }
+  m_downloadsPerHost = perHost;
+  QSettings settings = createSettings();
+  settings.setValue("downloadsPerHost", perHost);
+  emit downloadsPerHostChanged(perHost);
+}
+
+int SettingsManager::downloadBandwidthKB() const { return m_downloadBandwidthKB; }
+
+void SettingsManager::setDownloadBandwidthKB(int bandwidthKB) {
+  if (m_downloadBandwidthKB == bandwidthKB) {
+    return;
+  }
+  m_downloadBandwidthKB = bandwidthKB;
+  QSettings settings = createSettings();
+  settings.setValue("downloadBandwidthKB", bandwidthKB);
+  emit downloadBandwidthKBChanged(bandwidthKB);
+}
+
+int SettingsManager::perDownloadBandwidthKB() const { return m_perDownloadBandwidthKB; }
+
+void SettingsManager::setPerDownloadBandwidthKB(int bandwidthKB) {
+  if (m_perDownloadBandwidthKB == bandwidthKB) {
+    return;
+  }
+  m_perDownloadBandwidthKB = bandwidthKB;
+  QSettings settings = createSettings();
+  settings.setValue("perDownloadBandwidthKB", bandwidthKB);
+  emit perDownloadBandwidthKBChanged(bandwidthKB);
+}
+
+bool SettingsManager::downloadPauseOnForegroundTraffic() const { return m_downloadPauseOnForegroundTraffic; }
+
+void SettingsManager::setDownloadPauseOnForegroundTraffic(bool enabled) {
+  if (m_downloadPauseOnForegroundTraffic == enabled) {
+    return;
+  }
+  m_downloadPauseOnForegroundTraffic = enabled;
+  QSettings settings = createSettings();
+  settings.setValue("downloadPauseOnForegroundTraffic", enabled);
+  emit downloadPauseOnForegroundTrafficChanged(enabled);
+}
+
+int SettingsManager::pngEncoderThreads() const { return m_pngEncoderThreads; }
+
+void SettingsManager::setPngEncoderThreads(int threads) {
+  if (m_pngEncoderThreads == threads) {
+    return;
+  }
+  m_pngEncoderThreads = threads;
+  QSettings settings = createSettings();
+  settings.setValue("pngEncoderThreads", threads);
+  emit pngEncoderThreadsChanged(threads);
+}
+
 QSettings SettingsManager::createSettings() const {
   QString dataLocation = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
   QDir dir(dataLocation);
@@ -3,6 +3,9 @@
 #include <QObject>
 #include <QSettings>
 
+#include "archivelayout.h"
+#include "archivequota.h"
+#include "contentindex.h"
 #include "historymanager.h"
 
 class SettingsManager : public QObject {
@@ -35,6 +38,55 @@ class SettingsManager : public QObject {
   int autoSaveMaxSizeMB() const;
   void setAutoSaveMaxSizeMB(int sizeMB);
 
+  bool autoSaveParanoidValidation() const;
+  void setAutoSaveParanoidValidation(bool paranoid);
+
+  int autoSaveQuotaMB() const;
+  void setAutoSaveQuotaMB(int quotaMB);
+
+  int autoSaveQuotaFiles() const;
+  void setAutoSaveQuotaFiles(int quotaFiles);
+
+  EvictionPolicy autoSaveEvictionPolicy() const;
+  void setAutoSaveEvictionPolicy(EvictionPolicy policy);
+
+  bool autoSaveScrubEnabled() const;
+  void setAutoSaveScrubEnabled(bool enabled);
+
+  int autoSaveScrubBandwidthMB() const;
+  void setAutoSaveScrubBandwidthMB(int bandwidthMB);
+
+  bool autoSaveBlobStore() const;
+  void setAutoSaveBlobStore(bool enabled);
+
+  ArchiveLayout autoSaveLayout() const;
+  void setAutoSaveLayout(ArchiveLayout layout);
+
+  DedupScope autoSaveDedupScope() const;
+  void setAutoSaveDedupScope(DedupScope scope);
+
+  QStringList autoSaveWatchFolders() const;
+  void setAutoSaveWatchFolders(const QStringList &folders);
+
+  int downloadConcurrency() const;
+  void setDownloadConcurrency(int concurrency);
+
+  int downloadsPerHost() const;
+  void setDownloadsPerHost(int perHost);
+
+  // KB/s; 0 is unlimited
+  int downloadBandwidthKB() const;
+  void setDownloadBandwidthKB(int bandwidthKB);
+
+  int perDownloadBandwidthKB() const;
+  void setPerDownloadBandwidthKB(int bandwidthKB);
+
+  bool downloadPauseOnForegroundTraffic() const;
+  void setDownloadPauseOnForegroundTraffic(bool enabled);
+
+  int pngEncoderThreads() const;
+  void setPngEncoderThreads(int threads);
+
  signals:
   void notificationsEnabledChanged(bool enabled);
   void notificationLevelChanged(EventLevel level);
@@ -44,6 +96,22 @@ class SettingsManager : public QObject {
   void autoSavePathChanged(const QString &path);
   void recentAutoSavePathsChanged(const QStringList &paths);  // Added
   void autoSaveMaxSizeMBChanged(int sizeMB);
+  void autoSaveParanoidValidationChanged(bool paranoid);
+  void autoSaveQuotaMBChanged(int quotaMB);
+  void autoSaveQuotaFilesChanged(int quotaFiles);
+  void autoSaveEvictionPolicyChanged(EvictionPolicy policy);
+  void autoSaveScrubEnabledChanged(bool enabled);
+  void autoSaveScrubBandwidthMBChanged(int bandwidthMB);
+  void autoSaveBlobStoreChanged(bool enabled);
+  void autoSaveLayoutChanged(ArchiveLayout layout);
+  void autoSaveDedupScopeChanged(DedupScope scope);
+  void autoSaveWatchFoldersChanged(const QStringList &folders);
+  void downloadConcurrencyChanged(int concurrency);
+  void downloadsPerHostChanged(int perHost);
+  void downloadBandwidthKBChanged(int bandwidthKB);
+  void perDownloadBandwidthKBChanged(int bandwidthKB);
+  void downloadPauseOnForegroundTrafficChanged(bool enabled);
+  void pngEncoderThreadsChanged(int threads);
 
  private:
   QSettings createSettings() const;
@@ -58,4 +126,20 @@ class SettingsManager : public QObject {
   QString m_autoSavePath;
   QStringList m_recentAutoSavePaths;  // Added
   int m_autoSaveMaxSizeMB = 30;
+  bool m_autoSaveParanoidValidation = false;
+  int m_autoSaveQuotaMB = 0;
+  int m_autoSaveQuotaFiles = 0;
+  EvictionPolicy m_autoSaveEvictionPolicy = EvictionPolicy::Oldest;
+  bool m_autoSaveScrubEnabled = true;
+  int m_autoSaveScrubBandwidthMB = 16;
+  bool m_autoSaveBlobStore = false;
+  ArchiveLayout m_autoSaveLayout = ArchiveLayout::Flat;
+  DedupScope m_autoSaveDedupScope = DedupScope::CurrentDirectory;
+  QStringList m_autoSaveWatchFolders;
+  int m_downloadConcurrency = 4;
+  int m_downloadsPerHost = 2;
+  int m_downloadBandwidthKB = 0;
+  int m_perDownloadBandwidthKB = 0;
+  bool m_downloadPauseOnForegroundTraffic = false;
+  int m_pngEncoderThreads = 0;
 };
@@ -5,6 +5,8 @@
 #include <QGroupBox>
 #include <QHBoxLayout>
 #include <QLabel>
+#include <QSpinBox>
+#include <QThread>
 #include <QVBoxLayout>
 
 #include "clipboardmanager.h"
@@ -16,6 +18,7 @@ SettingsWidget::SettingsWidget(ClipboardManager *manager, QWidget *parent) : QWi
   updateNotificationLevel();
   updateCategoryToggles();
   updateExitOnCloseToggle();
+  updatePngEncoderThreads();
 
   connect(m_manager->settingsManager(), &SettingsManager::notificationsEnabledChanged, this,
           &SettingsWidget::updateNotificationToggle);
@@ -25,6 +28,8 @@ SettingsWidget::SettingsWidget(ClipboardManager *manager, QWidget *parent) : QWi
           &SettingsWidget::updateCategoryToggles);
   connect(m_manager->settingsManager(), &SettingsManager::exitOnCloseChanged, this,
           &SettingsWidget::updateExitOnCloseToggle);
+  connect(m_manager->settingsManager(), &SettingsManager::pngEncoderThreadsChanged, this,
+          &SettingsWidget::updatePngEncoderThreads);
 }
 
 void SettingsWidget::setupUi() {
@@ -69,6 +74,20 @@ void SettingsWidget::setupUi() {
 
   layout->addWidget(notificationGroup);
 
+  auto *performanceGroup = new QGroupBox("Performance");
+  auto *performanceLayout = new QHBoxLayout(performanceGroup);
+  performanceLayout->addWidget(new QLabel("PNG Encoder Threads:"));
+  m_pngThreadsSpinBox = new QSpinBox();
+  m_pngThreadsSpinBox->setRange(0, 64);
+  m_pngThreadsSpinBox->setSpecialValueText(QString("Auto (%1)").arg(QThread::idealThreadCount()));
+  m_pngThreadsSpinBox->setMinimumWidth(120);
+  performanceLayout->addWidget(m_pngThreadsSpinBox);
+  performanceLayout->addStretch();
+  layout->addWidget(performanceGroup);
+
+  connect(m_pngThreadsSpinBox, QOverload<int>::of(&QSpinBox::valueChanged), this,
+          [this](int value) { m_manager->settingsManager()->setPngEncoderThreads(value); });
+
   connect(m_notificationToggle, &QCheckBox::toggled, this,
           [this](bool checked) { m_manager->settingsManager()->setNotificationsEnabled(checked); });
 
@@ -127,3 +146,9 @@ void SettingsWidget::updateExitOnCloseToggle() {
   m_exitOnCloseToggle->setChecked(exit);
   m_exitOnCloseToggle->blockSignals(false);
 }
+
+void SettingsWidget::updatePngEncoderThreads() {
+  m_pngThreadsSpinBox->blockSignals(true);
+  m_pngThreadsSpinBox->setValue(m_manager->settingsManager()->pngEncoderThreads());
+  m_pngThreadsSpinBox->blockSignals(false);
+}
@@ -5,6 +5,7 @@
 class QCheckBox;
 class QComboBox;
 class QLabel;
+class QSpinBox;
 class ClipboardManager;
 
 class SettingsWidget : public QWidget {
@@ -19,6 +20,7 @@ class SettingsWidget : public QWidget {
   void updateNotificationLevel();
   void updateCategoryToggles();
   void updateExitOnCloseToggle();
+  void updatePngEncoderThreads();
 
   ClipboardManager *m_manager = nullptr;
   QCheckBox *m_notificationToggle = nullptr;
@@ -26,4 +28,5 @@ class SettingsWidget : public QWidget {
   QCheckBox *m_copyNotifyToggle = nullptr;
   QCheckBox *m_autoSaveNotifyToggle = nullptr;
   QCheckBox *m_exitOnCloseToggle = nullptr;
+  QSpinBox *m_pngThreadsSpinBox = nullptr;
 };
@@ -0,0 +1,200 @@
+#include "thumbnailcache.h"
+
+#include <QDebug>
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QImageReader>
+#include <QStandardPaths>
+#include <QThreadPool>
+#include <QtConcurrent>
+#include <algorithm>
+
+namespace {
+
+const int kMaxQueuedRequests = 512;
+// New thumbnails written between two trims of the disk cache
+const int kPruneEvery = 500;
+// Hits refresh a file's modification time, which orders the trim, at most this often
+const int kTouchIntervalSecs = 24 * 60 * 60;
+
+QString cacheFilePath(const QByteArray &checksum, const QSize &size, const QString &suffix) {
+  QString hex = QString::fromLatin1(checksum.toHex());
+  return QDir(ThumbnailCache::diskCacheDir())
+      .filePath(QString("%1/%2_%3.%4").arg(hex.left(2), hex).arg(size.width()).arg(suffix));
+}
+
+}  // namespace
+
+ThumbnailCache::ThumbnailCache(QObject *parent) : QObject(parent), m_pool(new QThreadPool(this)) {
+  m_pool->setMaxThreadCount(qMax(1, QThread::idealThreadCount() - 1));
+  setMemoryLimit(64 * 1024 * 1024);
+  // Whatever earlier runs left behind
+  QMetaObject::invokeMethod(this, &ThumbnailCache::pruneDisk, Qt::QueuedConnection);
+}
+
+ThumbnailCache::~ThumbnailCache() {
+  m_queue.clear();
+  m_pool->waitForDone();
+}
+
+void ThumbnailCache::setMemoryLimit(qint64 bytes) { m_memory.setMaxCost(bytes); }
+
+QString ThumbnailCache::diskCacheDir() {
+  return QDir(QStandardPaths::writableLocation(QStandardPaths::CacheLocation)).filePath("thumbnails");
+}
+
+QPixmap ThumbnailCache::thumbnail(const QByteArray &checksum, const QString &filePath) {
+  if (QPixmap *pixmap = m_memory.object(checksum)) {
+    return *pixmap;
+  }
+  auto failed = m_failed.constFind(checksum);
+  if (failed != m_failed.constEnd()) {
+    // Retried once the file has been replaced or repaired
+    if (QFileInfo(filePath).lastModified() == failed.value()) return QPixmap();
+    m_failed.erase(failed);
+  }
+
+  if (m_pending.contains(checksum)) {
+    // Still wanted: move it to the front of the line
+    for (int i = m_queue.size() - 1; i >= 0; --i) {
+      if (m_queue[i].checksum == checksum) {
+        m_queue.append(m_queue.takeAt(i));
+        break;
+      }
+    }
+    return QPixmap();
+  }
+
+  m_pending.insert(checksum);
+  m_queue.append({checksum, filePath});
+  while (m_queue.size() > kMaxQueuedRequests) {
+    m_pending.remove(m_queue.takeFirst().checksum);
+  }
+  dispatch();
+  return QPixmap();
+}
+
+void ThumbnailCache::clearQueue() {
+  for (const Request &request : std::as_const(m_queue)) {
+    m_pending.remove(request.checksum);
+  }
+  m_queue.clear();
+}
+
+void ThumbnailCache::dispatch() {
+  while (!m_queue.isEmpty() && m_inFlight < m_pool->maxThreadCount()) {
+    Request request = m_queue.takeLast();
+    m_inFlight++;
+    QSize size = m_size;
+    QtConcurrent::run(m_pool, [this, request, size]() {
+      QDateTime modified = QFileInfo(request.filePath).lastModified();
+      bool generated = false;
+      QImage image = load(request, size, &generated);
+      QMetaObject::invokeMethod(
+          this,
+          [this, checksum = request.checksum, image, modified, generated]() {
+            onLoaded(checksum, image, modified, generated);
+          },
+          Qt::QueuedConnection);
+    });
+  }
+}
+
+void ThumbnailCache::onLoaded(const QByteArray &checksum, const QImage &image, const QDateTime &modified,
+                              bool generated) {
+  m_inFlight--;
+  m_pending.remove(checksum);
+  if (generated && ++m_generatedSincePrune >= kPruneEvery) pruneDisk();
+  if (image.isNull()) {
+    m_failed.insert(checksum, modified);
+  } else {
+    auto pixmap = new QPixmap(QPixmap::fromImage(image));
+    m_memory.insert(checksum, pixmap, qMax<qint64>(1, qint64(image.sizeInBytes())));
+    emit thumbnailReady(checksum);
+  }
+  dispatch();
+}
+
+void ThumbnailCache::pruneDisk() {
+  if (m_pruning || m_diskLimit <= 0) return;
+  m_pruning = true;
+  m_generatedSincePrune = 0;
+  auto watcher = new QFutureWatcher<void>(this);
+  connect(watcher, &QFutureWatcher<void>::finished, this, [this, watcher]() {
+    m_pruning = false;
+    watcher->deleteLater();
+  });
+  watcher->setFuture(QtConcurrent::run(m_pool, &ThumbnailCache::prune, diskCacheDir(), m_diskLimit));
+}
+
+void ThumbnailCache::prune(const QString &dirPath, qint64 limit) {
+  QList<QFileInfo> files;
+  qint64 total = 0;
+  QDirIterator it(dirPath, QDir::Files | QDir::NoDotAndDotDot, QDirIterator::Subdirectories);
+  while (it.hasNext()) {
+    it.next();
+    files.append(it.fileInfo());
+    total += files.last().size();
+  }
+  if (total <= limit) return;
+
+  // Down to 90% of the limit, so the next few thumbnails do not trigger another pass
+  std::sort(files.begin(), files.end(),
+            [](const QFileInfo &a, const QFileInfo &b) { return a.lastModified() < b.lastModified(); });
+  qint64 target = limit / 10 * 9;
+  int removed = 0;
+  for (const QFileInfo &fi : std::as_const(files)) {
+    if (total <= target) break;
+    if (QFile::remove(fi.filePath())) {
+      total -= fi.size();
+      removed++;
+    }
+  }
+  qDebug() << "Thumbnail cache trimmed:" << removed << "file(s) removed," << total << "bytes left";
+}
+
+QImage ThumbnailCache::load(const Request &request, const QSize &size, bool *generated) {
+  for (const QString &suffix : {QStringLiteral("jpg"), QStringLiteral("png")}) {
+    QString path = cacheFilePath(request.checksum, size, suffix);
+    QImage cached(path);
+    if (cached.isNull()) continue;
+    // Marks the file as recently used for prune()
+    QFile file(path);
+    QDateTime now = QDateTime::currentDateTime();
+    if (QFileInfo(file).lastModified().secsTo(now) > kTouchIntervalSecs && file.open(QIODevice::ReadWrite)) {
+      file.setFileTime(now, QFileDevice::FileModificationTime);
+    }
+    return cached;
+  }
+
+  QImageReader reader(request.filePath);
+  reader.setAutoTransform(true);
+  QSize fullSize = reader.size();
+  if (fullSize.isValid() && (fullSize.width() > size.width() || fullSize.height() > size.height())) {
+    reader.setScaledSize(fullSize.scaled(size, Qt::KeepAspectRatio));
+  }
+  QImage image = reader.read();
+  if (image.isNull()) {
+    qDebug() << "Thumbnail failed for" << request.filePath << reader.errorString();
+    return image;
+  }
+  // Formats without scaled decoding come back full size
+  if (image.width() > size.width() || image.height() > size.height()) {
+    image = image.scaled(size, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+  }
+
+  QString suffix = image.hasAlphaChannel() ? "png" : "jpg";
+  QString path = cacheFilePath(request.checksum, size, suffix);
+  QDir().mkpath(QFileInfo(path).path());
+  QString temp = path + ".part";
+  if (image.save(temp, suffix == "png" ? "PNG" : "JPG", 85)) {
+    if (QFile::rename(temp, path)) {
+      *generated = true;
+    } else {
+      QFile::remove(temp);
+    }
+  }
+  return image;
+}
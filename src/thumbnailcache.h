@@ -0,0 +1,68 @@
+#pragma once
+
+#include <QByteArray>
+#include <QCache>
+#include <QDateTime>
+#include <QHash>
+#include <QImage>
+#include <QList>
+#include <QObject>
+#include <QPixmap>
+#include <QSet>
+#include <QSize>
+#include <QString>
+
+class QThreadPool;
+
+// Thumbnails of archived images, keyed by content checksum so they survive renames and
+// layout migrations. Generated with QImageReader::setScaledSize (decoders such as JPEG
+// then skip most of the work) on a worker pool, persisted in the app cache location and
+// kept in an LRU memory cache of pixmaps. The disk cache is trimmed to a size limit,
+// least recently used files first.
+class ThumbnailCache : public QObject {
+  Q_OBJECT
+
+ public:
+  explicit ThumbnailCache(QObject *parent = nullptr);
+  ~ThumbnailCache();
+
+  QSize thumbnailSize() const { return m_size; }
+  // Memory budget for decoded pixmaps
+  void setMemoryLimit(qint64 bytes);
+  // Size the thumbnails on disk are trimmed back to
+  void setDiskLimit(qint64 bytes) { m_diskLimit = bytes; }
+
+  // Returns the cached pixmap, or a null pixmap after queueing `filePath` for loading.
+  // The newest requests are served first, so rows scrolled past are not waited on.
+  QPixmap thumbnail(const QByteArray &checksum, const QString &filePath);
+  // Drops queued requests that have not started yet
+  void clearQueue();
+
+  static QString diskCacheDir();
+
+ signals:
+  void thumbnailReady(const QByteArray &checksum);
+
+ private:
+  struct Request {
+    QByteArray checksum;
+    QString filePath;
+  };
+
+  void dispatch();
+  void onLoaded(const QByteArray &checksum, const QImage &image, const QDateTime &modified, bool generated);
+  void pruneDisk();
+  static QImage load(const Request &request, const QSize &size, bool *generated);
+  static void prune(const QString &dirPath, qint64 limit);
+
+  QSize m_size{128, 128};
+  QThreadPool *m_pool = nullptr;
+  QCache<QByteArray, QPixmap> m_memory;
+  QList<Request> m_queue;
+  QSet<QByteArray> m_pending;  // queued or in flight
+  QHash<QByteArray, QDateTime> m_failed;  // source modification time at the failure
+  int m_inFlight = 0;
+  qint64 m_diskLimit = 256 * 1024 * 1024;
+  int m_generatedSincePrune = 0;
+  bool m_pruning = false;
+};
@@ -0,0 +1,96 @@
+#include "urlcache.h"
+
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QTextStream>
+
+const QString UrlCache::kFileName = "url_cache.txt";
+
+namespace {
+
+void writeEntry(QTextStream &out, const QUrl &url, const UrlCache::Entry &entry) {
+  out << entry.checksum.toHex() << '\t' << QString::fromLatin1(entry.etag) << '\t'
+      << QString::fromLatin1(entry.lastModified) << '\t' << QString::fromLatin1(url.toEncoded()) << '\n';
+}
+
+}  // namespace
+
+UrlCache::UrlCache(const QString &filePath) : m_filePath(filePath) {}
+
+QString UrlCache::defaultFilePath() {
+  return QDir(QStandardPaths::writableLocation(QStandardPaths::AppDataLocation)).filePath(kFileName);
+}
+
+bool UrlCache::load(QString *error) {
+  m_entries.clear();
+
+  QFile file(m_filePath);
+  if (!file.exists()) return true;
+  if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+    if (error) *error = file.errorString();
+    return false;
+  }
+
+  int lines = 0;
+  QTextStream in(&file);
+  while (!in.atEnd()) {
+    const QStringList fields = in.readLine().split('\t');
+    lines++;
+    if (fields.size() != 4) continue;
+    Entry entry{QByteArray::fromHex(fields[0].toLatin1()), fields[1].toLatin1(), fields[2].toLatin1()};
+    QUrl url = QUrl::fromEncoded(fields[3].toLatin1());
+    if (!entry.isValid() || !url.isValid()) continue;
+    m_entries.insert(url, entry);
+  }
+  file.close();
+  qDebug() << "Loaded" << m_entries.size() << "cached URLs from" << m_filePath;
+
+  if (lines > 2 * m_entries.size() + 64) {
+    return save(error);
+  }
+  return true;
+}
+
+bool UrlCache::save(QString *error) const {
+  QDir().mkpath(QFileInfo(m_filePath).path());
+  QSaveFile file(m_filePath);
+  if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
+    if (error) *error = file.errorString();
+    return false;
+  }
+  QTextStream out(&file);
+  for (auto it = m_entries.cbegin(); it != m_entries.cend(); ++it) {
+    writeEntry(out, it.key(), it.value());
+  }
+  out.flush();
+  if (!file.commit()) {
+    if (error) *error = file.errorString();
+    return false;
+  }
+  return true;
+}
+
+bool UrlCache::insert(const QUrl &url, const Entry &entry, QString *error) {
+  if (!entry.isValid()) return true;
+  QUrl key = url.adjusted(QUrl::RemoveFragment);
+  auto existing = m_entries.constFind(key);
+  if (existing != m_entries.constEnd() && existing->checksum == entry.checksum && existing->etag == entry.etag &&
+      existing->lastModified == entry.lastModified) {
+    return true;
+  }
+  m_entries.insert(key, entry);
+
+  QDir().mkpath(QFileInfo(m_filePath).path());
+  QFile file(m_filePath);
+  if (!file.open(QIODevice::WriteOnly | QIODevice::Append | QIODevice::Text)) {
+    if (error) *error = file.errorString();
+    return false;
+  }
+  QTextStream out(&file);
+  writeEntry(out, key, entry);
+  return true;
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <QByteArray>
+#include <QHash>
+#include <QString>
+#include <QUrl>
+
+// URL -> digest of the content last archived from it, plus the ETag/Last-Modified the
+// server sent with it, so copying the URL again can be answered by a conditional request.
+// Persisted as "<md5 hex>\t<etag>\t<last-modified>\t<url>" lines in the app data location;
+// entries are appended and a later line for the same URL wins.
+class UrlCache {
+ public:
+  struct Entry {
+    QByteArray checksum;
+    QByteArray etag;
+    QByteArray lastModified;
+
+    bool isValid() const { return !checksum.isEmpty() && (!etag.isEmpty() || !lastModified.isEmpty()); }
+  };
+
+  static const QString kFileName;
+
+  explicit UrlCache(const QString &filePath = defaultFilePath());
+  static QString defaultFilePath();
+
+  // Compacts the file when most of its lines are superseded
+  bool load(QString *error = nullptr);
+  // Atomically rewrites the whole file
+  bool save(QString *error = nullptr) const;
+
+  Entry find(const QUrl &url) const { return m_entries.value(url.adjusted(QUrl::RemoveFragment)); }
+  int size() const { return m_entries.size(); }
+
+  // In memory plus an append to the file; entries without a validator are not kept
+  bool insert(const QUrl &url, const Entry &entry, QString *error = nullptr);
+
+ private:
+  QString m_filePath;
+  QHash<QUrl, Entry> m_entries;
+};
@@ -0,0 +1,106 @@
+#include "watchfoldersource.h"
+
+#include <QDebug>
+#include <QDir>
+#include <QFileInfo>
+#include <QSet>
+#include <QTimer>
+
+#include "directorywatcher.h"
+
+namespace {
+
+// A file counts as written once it has not changed for this long
+const int kSettleMs = 1000;
+
+}  // namespace
+
+WatchFolderSource::WatchFolderSource(QObject *parent) : QObject(parent), m_settleTimer(new QTimer(this)) {
+  m_settleTimer->setInterval(kSettleMs);
+  connect(m_settleTimer, &QTimer::timeout, this, &WatchFolderSource::checkSettled);
+}
+
+void WatchFolderSource::setFolders(const QStringList &folders) {
+  QSet<QString> wanted;
+  for (const QString &folder : folders) {
+    if (!folder.isEmpty()) wanted.insert(QDir::cleanPath(folder));
+  }
+
+  for (auto it = m_watchers.begin(); it != m_watchers.end();) {
+    if (wanted.contains(it.key())) {
+      ++it;
+      continue;
+    }
+    // Files of a folder no longer watched are not ingested any more
+    QString prefix = it.key() + "/";
+    for (auto pending = m_pending.begin(); pending != m_pending.end();) {
+      pending = pending.key().startsWith(prefix) ? m_pending.erase(pending) : std::next(pending);
+    }
+    m_ready.removeIf([&prefix](const QString &path) { return path.startsWith(prefix); });
+    it.value()->deleteLater();
+    it = m_watchers.erase(it);
+  }
+
+  for (const QString &folder : std::as_const(wanted)) {
+    if (m_watchers.contains(folder)) continue;
+    auto watcher = new DirectoryWatcher(this);
+    connect(watcher, &DirectoryWatcher::changed, this,
+            [this, folder](const QStringList &added, const QStringList &removed) {
+              onChanged(folder, added, removed);
+            });
+    watcher->setRoot(folder);
+    m_watchers.insert(folder, watcher);
+  }
+  qDebug() << "Watching" << m_watchers.size() << "folder(s) for new images";
+}
+
+void WatchFolderSource::setPaused(bool paused) {
+  if (m_paused == paused) return;
+  m_paused = paused;
+  if (!m_paused) deliver();
+}
+
+void WatchFolderSource::onChanged(const QString &folder, const QStringList &added, const QStringList &removed) {
+  QDir root(folder);
+  for (const QString &path : removed) {
+    QString filePath = root.filePath(path);
+    m_pending.remove(filePath);
+    m_ready.removeOne(filePath);
+  }
+  for (const QString &path : added) {
+    m_pending.insert(root.filePath(path), Pending());
+  }
+  if (!m_pending.isEmpty() && !m_settleTimer->isActive()) {
+    m_settleTimer->start();
+  }
+}
+
+void WatchFolderSource::checkSettled() {
+  QDateTime settledBefore = QDateTime::currentDateTime().addMSecs(-kSettleMs);
+  for (auto it = m_pending.begin(); it != m_pending.end();) {
+    QFileInfo fi(it.key());
+    if (!fi.isFile()) {
+      it = m_pending.erase(it);
+      continue;
+    }
+    Pending current{fi.size(), fi.lastModified()};
+    if (current.size == it->size && current.lastModified == it->lastModified &&
+        current.lastModified < settledBefore) {
+      m_ready.append(it.key());
+      it = m_pending.erase(it);
+    } else {
+      *it = current;
+      ++it;
+    }
+  }
+
+  if (m_pending.isEmpty()) m_settleTimer->stop();
+  if (!m_paused) deliver();
+}
+
+void WatchFolderSource::deliver() {
+  if (m_ready.isEmpty()) return;
+  QStringList batch;
+  batch.swap(m_ready);
+  emit filesArrived(batch);
+}
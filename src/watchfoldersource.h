@@ -0,0 +1,48 @@
+#pragma once
+
+#include <QDateTime>
+#include <QHash>
+#include <QObject>
+#include <QString>
+#include <QStringList>
+
+class DirectoryWatcher;
+class QTimer;
+
+// Turns files that appear in watched folders (screenshot tools writing straight to disk)
+// into ingest batches. Each folder gets a DirectoryWatcher; a new file is only handed out
+// once its size and mtime have stopped changing, so files still being written are not
+// read half-way. Everything that settled since the last batch goes out together.
+class WatchFolderSource : public QObject {
+  Q_OBJECT
+
+ public:
+  explicit WatchFolderSource(QObject *parent = nullptr);
+
+  QStringList folders() const { return m_watchers.keys(); }
+  void setFolders(const QStringList &folders);
+
+  // While paused, settled files pile up and are delivered as one batch on resume
+  void setPaused(bool paused);
+  bool isPaused() const { return m_paused; }
+  int pendingCount() const { return m_pending.size() + m_ready.size(); }
+
+ signals:
+  void filesArrived(const QStringList &paths);  // absolute paths
+
+ private:
+  struct Pending {
+    qint64 size = -1;
+    QDateTime lastModified;
+  };
+
+  void onChanged(const QString &folder, const QStringList &added, const QStringList &removed);
+  void checkSettled();
+  void deliver();
+
+  QHash<QString, DirectoryWatcher *> m_watchers;  // keyed by clean folder path
+  QHash<QString, Pending> m_pending;               // absolute path -> last seen state
+  QStringList m_ready;
+  QTimer *m_settleTimer = nullptr;
+  bool m_paused = false;
+};
@@ -0,0 +1,83 @@
+#include "httpstandin.h"
+
+#include <QHostAddress>
+#include <QTcpSocket>
+#include <QTimer>
+
+HttpStandIn::HttpStandIn(Handler handler, QObject *parent) : QObject(parent), m_handler(std::move(handler)) {
+  connect(&m_server, &QTcpServer::newConnection, this, &HttpStandIn::onNewConnection);
+  m_server.listen(QHostAddress::LocalHost);
+}
+
+QUrl HttpStandIn::url(const QString &path) const {
+  return QUrl(QString("http://127.0.0.1:%1%2").arg(m_server.serverPort()).arg(path));
+}
+
+HttpStandIn::Response HttpStandIn::full(const QByteArray &body, const QByteArray &etag) {
+  Response response;
+  response.headers = {{"Accept-Ranges", "bytes"}, {"ETag", etag}, {"Content-Type", "application/octet-stream"}};
+  response.body = body;
+  return response;
+}
+
+HttpStandIn::Response HttpStandIn::partial(const QByteArray &body, qint64 first, const QByteArray &etag) {
+  Response response = full(body.mid(first), etag);
+  response.status = 206;
+  response.headers.append({"Content-Range", QString("bytes %1-%2/%3")
+                                                .arg(first)
+                                                .arg(body.size() - 1)
+                                                .arg(body.size())
+                                                .toLatin1()});
+  return response;
+}
+
+void HttpStandIn::onNewConnection() {
+  while (QTcpSocket *socket = m_server.nextPendingConnection()) {
+    connect(socket, &QTcpSocket::readyRead, this, [this, socket]() { onReadyRead(socket); });
+    connect(socket, &QTcpSocket::disconnected, this, [this, socket]() {
+      m_pending.remove(socket);
+      socket->deleteLater();
+    });
+  }
+}
+
+void HttpStandIn::onReadyRead(QTcpSocket *socket) {
+  QByteArray &buffer = m_pending[socket];
+  buffer.append(socket->readAll());
+  int end = buffer.indexOf("\r\n\r\n");
+  if (end < 0) return;
+
+  const QList<QByteArray> lines = buffer.left(end).split('\n');
+  buffer.clear();
+  Request request;
+  const QList<QByteArray> requestLine = lines.value(0).trimmed().split(' ');
+  request.method = requestLine.value(0);
+  request.path = requestLine.value(1);
+  for (int i = 1; i < lines.size(); ++i) {
+    int colon = lines[i].indexOf(':');
+    if (colon > 0) request.headers.insert(lines[i].left(colon).trimmed().toLower(), lines[i].mid(colon + 1).trimmed());
+  }
+
+  int index = m_requests.size();
+  m_requests.append(request);
+  Response response = m_handler(request, index);
+  if (response.delayMs > 0) {
+    // Dropped along with the socket if the client goes away first
+    QTimer::singleShot(response.delayMs, socket, [this, socket, response]() { respond(socket, response); });
+  } else {
+    respond(socket, response);
+  }
+}
+
+void HttpStandIn::respond(QTcpSocket *socket, const Response &response) {
+  QByteArray head = "HTTP/1.1 " + QByteArray::number(response.status) + " Stand-in\r\n";
+  for (const auto &[name, value] : response.headers) {
+    head += name + ": " + value + "\r\n";
+  }
+  head += "Content-Length: " + QByteArray::number(response.body.size()) + "\r\n";
+  head += "Connection: close\r\n\r\n";
+  socket->write(head);
+  socket->write(response.closeAfter < 0 ? response.body : response.body.left(response.closeAfter));
+  // Waits for the write buffer to drain, so a cut body still arrives up to `closeAfter`
+  socket->disconnectFromHost();
+}
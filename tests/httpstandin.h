@@ -0,0 +1,59 @@
+#pragma once
+
+#include <QByteArray>
+#include <QHash>
+#include <QList>
+#include <QObject>
+#include <QTcpServer>
+#include <QUrl>
+#include <functional>
+#include <utility>
+
+class QTcpSocket;
+
+// A scripted HTTP/1.1 server on 127.0.0.1 for exercising DownloadQueue against the ways
+// real servers fail. Every request is answered by the handler and then the connection is
+// closed; `closeAfter` makes it close in the middle of the body.
+class HttpStandIn : public QObject {
+  Q_OBJECT
+
+ public:
+  struct Request {
+    QByteArray method;
+    QByteArray path;
+    QHash<QByteArray, QByteArray> headers;  // lower-case names
+
+    QByteArray header(const QByteArray &name) const { return headers.value(name.toLower()); }
+  };
+  struct Response {
+    int status = 200;
+    QList<std::pair<QByteArray, QByteArray>> headers;
+    QByteArray body;
+    // Body bytes sent before the connection is closed; -1 sends all of it. Content-Length
+    // always announces the whole body.
+    qint64 closeAfter = -1;
+    int delayMs = 0;  // before anything is sent
+  };
+  // `index` counts the requests made so far, starting at 0
+  using Handler = std::function<Response(const Request &request, int index)>;
+
+  explicit HttpStandIn(Handler handler, QObject *parent = nullptr);
+
+  bool isListening() const { return m_server.isListening(); }
+  QUrl url(const QString &path = "/file") const;
+  QList<Request> requests() const { return m_requests; }
+
+  // Answers to a range request over `body`, as a server that supports them would
+  static Response partial(const QByteArray &body, qint64 first, const QByteArray &etag);
+  static Response full(const QByteArray &body, const QByteArray &etag);
+
+ private:
+  void onNewConnection();
+  void onReadyRead(QTcpSocket *socket);
+  void respond(QTcpSocket *socket, const Response &response);
+
+  Handler m_handler;
+  QTcpServer m_server;
+  QHash<QTcpSocket *, QByteArray> m_pending;  // request bytes until the header is complete
+  QList<Request> m_requests;
+};
@@ -0,0 +1,309 @@
+#include <QTemporaryDir>
+#include <QtTest>
+#include <atomic>
+#include <memory>
+
+#include "downloadqueue.h"
+#include "httpstandin.h"
+
+namespace {
+
+const QByteArray kEtag = "\"v1\"";
+const int kTimeoutMs = 20000;
+
+QByteArray makeBody(int size) {
+  QByteArray body(size, Qt::Uninitialized);
+  for (int i = 0; i < size; ++i) body[i] = char(i % 251);
+  return body;
+}
+
+struct Outcome {
+  qint64 bytesReceived = 0;
+  bool finished = false;
+  bool success = false;
+  QByteArray data;
+  QString errorString;
+};
+
+}  // namespace
+
+class TestDownloadQueue : public QObject {
+  Q_OBJECT
+
+ private slots:
+  void init();
+  void resumesAfterResetMidBody();
+  void retriesServerError();
+  void startsOverAfter416();
+  void startsOverWhenRangeIgnored();
+  void startsOverOnContentRangeMismatch();
+  void progressResetsAttempts();
+  void resumesRightVersionAfterRestart();
+  void pacesToRateLimit();
+  void holdsBackDuringForegroundTraffic();
+
+ private:
+  // Filled in when the download of `server` finishes
+  std::shared_ptr<Outcome> download(DownloadQueue &queue, const HttpStandIn &server);
+
+  DownloadQueue::RetryPolicy m_fastRetries;
+};
+
+void TestDownloadQueue::init() {
+  m_fastRetries.maxAttempts = 3;
+  m_fastRetries.baseDelayMs = 10;
+  m_fastRetries.maxDelayMs = 50;
+}
+
+std::shared_ptr<Outcome> TestDownloadQueue::download(DownloadQueue &queue, const HttpStandIn &server) {
+  auto outcome = std::make_shared<Outcome>();
+  queue.enqueue(
+      server.url(), nullptr, [outcome](qint64 bytesReceived, qint64) { outcome->bytesReceived = bytesReceived; },
+      [outcome](const QByteArray &data, bool success, const QString &errorString, const DownloadQueue::Response &) {
+        outcome->finished = true;
+        outcome->success = success;
+        outcome->data = data;
+        outcome->errorString = errorString;
+      });
+  return outcome;
+}
+
+void TestDownloadQueue::resumesAfterResetMidBody() {
+  const QByteArray body = makeBody(40000);
+  HttpStandIn server([&](const HttpStandIn::Request &, int index) {
+    if (index == 0) {
+      HttpStandIn::Response response = HttpStandIn::full(body, kEtag);
+      response.closeAfter = 10000;
+      return response;
+    }
+    return HttpStandIn::partial(body, 10000, kEtag);
+  });
+  QVERIFY(server.isListening());
+  DownloadQueue queue;
+  queue.setRetryPolicy(m_fastRetries);
+
+  std::shared_ptr<Outcome> outcome = download(queue, server);
+  QTRY_VERIFY_WITH_TIMEOUT(outcome->finished, kTimeoutMs);
+  QVERIFY2(outcome->success, qPrintable(outcome->errorString));
+  QCOMPARE(outcome->data, body);
+  QCOMPARE(server.requests().size(), 2);
+  QCOMPARE(server.requests()[1].header("Range"), QByteArray("bytes=10000-"));
+  QCOMPARE(server.requests()[1].header("If-Range"), kEtag);
+}
+
+void TestDownloadQueue::retriesServerError() {
+  const QByteArray body = makeBody(1000);
+  HttpStandIn server([&](const HttpStandIn::Request &, int index) {
+    if (index == 0) {
+      HttpStandIn::Response response;
+      response.status = 503;
+      response.body = "busy";
+      return response;
+    }
+    return HttpStandIn::full(body, kEtag);
+  });
+  DownloadQueue queue;
+  queue.setRetryPolicy(m_fastRetries);
+
+  std::shared_ptr<Outcome> outcome = download(queue, server);
+  QTRY_VERIFY_WITH_TIMEOUT(outcome->finished, kTimeoutMs);
+  QVERIFY2(outcome->success, qPrintable(outcome->errorString));
+  // The error page is not part of the file
+  QCOMPARE(outcome->data, body);
+  QCOMPARE(server.requests().size(), 2);
+}
+
+void TestDownloadQueue::startsOverAfter416() {
+  const QByteArray body = makeBody(40000);
+  HttpStandIn server([&](const HttpStandIn::Request &, int index) {
+    HttpStandIn::Response response = HttpStandIn::full(body, kEtag);
+    if (index == 0) {
+      response.closeAfter = 10000;
+    } else if (index == 1) {
+      response = HttpStandIn::Response();
+      response.status = 416;
+    }
+    return response;
+  });
+  DownloadQueue queue;
+  queue.setRetryPolicy(m_fastRetries);
+
+  std::shared_ptr<Outcome> outcome = download(queue, server);
+  QTRY_VERIFY_WITH_TIMEOUT(outcome->finished, kTimeoutMs);
+  QVERIFY2(outcome->success, qPrintable(outcome->errorString));
+  QCOMPARE(outcome->data, body);
+  QCOMPARE(server.requests().size(), 3);
+  QVERIFY(!server.requests()[1].header("Range").isEmpty());
+  QVERIFY(server.requests()[2].header("Range").isEmpty());
+}
+
+void TestDownloadQueue::startsOverWhenRangeIgnored() {
+  const QByteArray body = makeBody(40000);
+  HttpStandIn server([&](const HttpStandIn::Request &, int index) {
+    HttpStandIn::Response response = HttpStandIn::full(body, kEtag);
+    if (index == 0) response.closeAfter = 10000;
+    // Later requests ask for a range and get a 200 with everything
+    return response;
+  });
+  DownloadQueue queue;
+  queue.setRetryPolicy(m_fastRetries);
+
+  std::shared_ptr<Outcome> outcome = download(queue, server);
+  QTRY_VERIFY_WITH_TIMEOUT(outcome->finished, kTimeoutMs);
+  QVERIFY2(outcome->success, qPrintable(outcome->errorString));
+  QCOMPARE(outcome->data, body);
+  QCOMPARE(server.requests().size(), 2);
+  QCOMPARE(server.requests()[1].header("Range"), QByteArray("bytes=10000-"));
+}
+
+void TestDownloadQueue::startsOverOnContentRangeMismatch() {
+  const QByteArray body = makeBody(40000);
+  HttpStandIn server([&](const HttpStandIn::Request &request, int index) {
+    if (index == 0) {
+      HttpStandIn::Response response = HttpStandIn::full(body, kEtag);
+      response.closeAfter = 10000;
+      return response;
+    }
+    // A 206 for the wrong part of the file, then the whole file once no range is asked for
+    if (!request.header("Range").isEmpty()) return HttpStandIn::partial(body, 5000, kEtag);
+    return HttpStandIn::full(body, kEtag);
+  });
+  DownloadQueue queue;
+  queue.setRetryPolicy(m_fastRetries);
+
+  std::shared_ptr<Outcome> outcome = download(queue, server);
+  QTRY_VERIFY_WITH_TIMEOUT(outcome->finished, kTimeoutMs);
+  QVERIFY2(outcome->success, qPrintable(outcome->errorString));
+  QCOMPARE(outcome->data, body);
+  QCOMPARE(server.requests().size(), 3);
+  QVERIFY(server.requests()[2].header("Range").isEmpty());
+}
+
+void TestDownloadQueue::progressResetsAttempts() {
+  // Every response breaks off 10000 bytes in: more attempts than maxAttempts allows, but
+  // each of them gets further
+  const QByteArray body = makeBody(60000);
+  HttpStandIn server([&](const HttpStandIn::Request &request, int) {
+    QByteArray range = request.header("Range");
+    qint64 first = range.isEmpty() ? 0 : range.mid(6, range.indexOf('-') - 6).toLongLong();
+    HttpStandIn::Response response = first > 0 ? HttpStandIn::partial(body, first, kEtag)
+                                               : HttpStandIn::full(body, kEtag);
+    response.closeAfter = 10000;
+    return response;
+  });
+  DownloadQueue queue;
+  m_fastRetries.maxAttempts = 2;
+  queue.setRetryPolicy(m_fastRetries);
+
+  std::shared_ptr<Outcome> outcome = download(queue, server);
+  QTRY_VERIFY_WITH_TIMEOUT(outcome->finished, kTimeoutMs);
+  QVERIFY2(outcome->success, qPrintable(outcome->errorString));
+  QCOMPARE(outcome->data, body);
+  QCOMPARE(server.requests().size(), 6);
+}
+
+void TestDownloadQueue::resumesRightVersionAfterRestart() {
+  const QByteArray oldBody = makeBody(40000);
+  QByteArray newBody = makeBody(40000);
+  newBody.fill('x', 5000);
+  const QByteArray newEtag = "\"v2\"";
+  HttpStandIn server([&](const HttpStandIn::Request &request, int index) {
+    HttpStandIn::Response response;
+    if (index == 0) {
+      response = HttpStandIn::full(oldBody, kEtag);
+      response.closeAfter = 10000;
+    } else if (index == 1) {
+      // If-Range no longer matches: the new version from the start. Late enough for the old
+      // prefix to be in the journal
+      response = HttpStandIn::full(newBody, newEtag);
+      response.closeAfter = 20000;
+      response.delayMs = 1500;
+    } else if (index == 2) {
+      // Never answered; the app quits meanwhile
+      response = HttpStandIn::full(newBody, newEtag);
+      response.delayMs = 60000;
+    } else {
+      QByteArray range = request.header("Range");
+      response = HttpStandIn::partial(newBody, range.mid(6, range.indexOf('-') - 6).toLongLong(), newEtag);
+    }
+    return response;
+  });
+  QTemporaryDir journalDir;
+  QVERIFY(journalDir.isValid());
+  QString journalPath = journalDir.filePath(DownloadJournal::kFileName);
+
+  {
+    DownloadQueue queue;
+    queue.setRetryPolicy(m_fastRetries);
+    QVERIFY(queue.openJournal(journalPath).isEmpty());
+    std::shared_ptr<Outcome> outcome = download(queue, server);
+    QTRY_COMPARE_WITH_TIMEOUT(server.requests().size(), 3, kTimeoutMs);
+    QVERIFY(!outcome->finished);
+  }
+
+  DownloadQueue queue;
+  queue.setRetryPolicy(m_fastRetries);
+  QCOMPARE(queue.openJournal(journalPath).size(), 1);
+  std::shared_ptr<Outcome> outcome = download(queue, server);
+  QTRY_VERIFY_WITH_TIMEOUT(outcome->finished, kTimeoutMs);
+  QVERIFY2(outcome->success, qPrintable(outcome->errorString));
+  QCOMPARE(server.requests()[3].header("Range"), QByteArray("bytes=20000-"));
+  QCOMPARE(server.requests()[3].header("If-Range"), newEtag);
+  QCOMPARE(outcome->data, newBody);
+}
+
+void TestDownloadQueue::pacesToRateLimit() {
+  const QByteArray body = makeBody(768 * 1024);
+  HttpStandIn server([&](const HttpStandIn::Request &, int) { return HttpStandIn::full(body, kEtag); });
+  DownloadQueue queue;
+  queue.setRateLimit({256 * 1024, 0});
+
+  QElapsedTimer timer;
+  timer.start();
+  std::shared_ptr<Outcome> outcome = download(queue, server);
+  QTRY_VERIFY_WITH_TIMEOUT(outcome->finished, kTimeoutMs);
+  QVERIFY2(outcome->success, qPrintable(outcome->errorString));
+  QCOMPARE(outcome->data, body);
+  // Three seconds at the limit, less what the read buffer holds when the reply finishes
+  QVERIFY2(timer.elapsed() >= 2000, qPrintable(QString("took %1 ms").arg(timer.elapsed())));
+  QVERIFY2(timer.elapsed() < 8000, qPrintable(QString("took %1 ms").arg(timer.elapsed())));
+}
+
+void TestDownloadQueue::holdsBackDuringForegroundTraffic() {
+  const QByteArray body = makeBody(1024 * 1024);
+  HttpStandIn server([&](const HttpStandIn::Request &, int) { return HttpStandIn::full(body, kEtag); });
+  // Loopback is never counted, so the other traffic is made up: 10 MB per sample while busy
+  auto busy = std::make_shared<std::atomic_bool>(false);
+  auto systemBytes = std::make_shared<std::atomic<qint64>>(0);
+  DownloadQueue queue;
+  queue.setTrafficCounter([busy, systemBytes]() {
+    if (*busy) *systemBytes += 10 * 1024 * 1024;
+    return systemBytes->load();
+  });
+  queue.setRateLimit({128 * 1024, 0});
+  queue.setPauseOnForegroundTraffic(true);
+  QSignalSpy foreground(&queue, &DownloadQueue::foregroundTrafficChanged);
+
+  std::shared_ptr<Outcome> outcome = download(queue, server);
+  QTRY_VERIFY_WITH_TIMEOUT(outcome->bytesReceived > 0, kTimeoutMs);
+  *busy = true;
+  QTRY_COMPARE_WITH_TIMEOUT(foreground.count(), 1, 5000);
+  QCOMPARE(foreground[0][0].toBool(), true);
+
+  // What was already on its way fills the read buffer, then nothing moves
+  QTest::qWait(500);
+  qint64 held = outcome->bytesReceived;
+  QTest::qWait(1500);
+  QCOMPARE(outcome->bytesReceived, held);
+  QVERIFY(!outcome->finished);
+
+  *busy = false;
+  QTRY_COMPARE_WITH_TIMEOUT(foreground.count(), 2, 10000);
+  QCOMPARE(foreground[1][0].toBool(), false);
+  QTRY_VERIFY_WITH_TIMEOUT(outcome->finished, kTimeoutMs);
+  QVERIFY2(outcome->success, qPrintable(outcome->errorString));
+  QCOMPARE(outcome->data, body);
+}
+
+QTEST_GUILESS_MAIN(TestDownloadQueue)
+#include "tst_downloadqueue.moc"